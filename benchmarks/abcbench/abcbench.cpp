@@ -0,0 +1,887 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+//-*****************************************************************************
+//! abcbench writes synthetic archives with each backend, reads them back and
+//! prints one JSON object per workload and backend.
+//!
+//!     abcbench [--backend ogawa|hdf5]... [--workload name]...
+//!              [--frames n] [--scale s] [--dir path] [--out file]
+//!              [--ogawa-streams n] [--allocator default|pooled|arena]
+//!              [--keep]
+//!
+//! The workloads are xforms (a deep animated hierarchy), polymesh (a dense
+//! animated grid with indexed UVs and face-varying normals), points (a large
+//! particle set with ids and velocities), curves (a groom of cubic curves
+//! with varying widths) and layered (a stack of archives over one hierarchy,
+//! opened as a single layered archive).  By default every workload runs with
+//! every backend.
+//!
+//! --allocator picks where array samples are read into: the archive's sample
+//! cache (default), or a PooledArraySampleAllocator or an
+//! ArenaArraySampleAllocator, rewound after every frame, through
+//! IArrayProperty::getWithAllocator.  With an allocator the report also has
+//! its allocations per frame, and how many of those went to the system
+//! allocator; without one, every array sample that isn't in the cache costs
+//! at least one system allocation.
+//!
+//! Peak RSS is the high-water mark of the whole process, so it only isolates
+//! one case when a single --workload and --backend are given.
+//-*****************************************************************************
+
+#include <Alembic/AbcGeom/All.h>
+#include <Alembic/AbcCoreFactory/All.h>
+#include <Alembic/AbcCoreHDF5/All.h>
+#include <Alembic/AbcCoreOgawa/All.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Abc = Alembic::Abc;
+namespace AbcA = Alembic::AbcCoreAbstract;
+namespace AbcF = Alembic::AbcCoreFactory;
+namespace AbcG = Alembic::AbcGeom;
+
+namespace {
+
+//-*****************************************************************************
+struct Options
+{
+    Options()
+      : frames( 24 ), scale( 1.0 ), dir( "." ), ogawaStreams( 1 )
+      , allocator( "default" ), keep( false ) {}
+
+    std::vector<std::string> backends;
+    std::vector<std::string> workloads;
+    size_t frames;
+    double scale;
+    std::string dir;
+    std::string out;
+    size_t ogawaStreams;
+    std::string allocator;
+    bool keep;
+};
+
+//-*****************************************************************************
+typedef std::chrono::steady_clock Clock;
+
+double Seconds( Clock::time_point iStart )
+{
+    return std::chrono::duration<double>( Clock::now() - iStart ).count();
+}
+
+uint64_t PeakRSS()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters,
+                               sizeof( counters ) ) )
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>( usage.ru_maxrss ) * 1024;
+#endif
+#endif
+}
+
+uint64_t FileSize( const std::string &iPath )
+{
+    std::ifstream f( iPath.c_str(), std::ios::binary | std::ios::ate );
+    return f ? static_cast<uint64_t>( f.tellg() ) : 0;
+}
+
+size_t Scaled( size_t iBase, double iScale )
+{
+    return std::max( static_cast<size_t>( iBase * iScale ), ( size_t ) 1 );
+}
+
+//-*****************************************************************************
+//! One line of the report.  Fields that don't apply to a workload are left
+//! negative and aren't printed.
+struct Result
+{
+    Result()
+      : writeSeconds( -1 ), fileBytes( 0 ), openSeconds( -1 )
+      , traverseSeconds( -1 ), numObjects( 0 ), numProperties( 0 )
+      , readMean( -1 ), readMin( -1 ), readMax( -1 ), readBytesPerFrame( 0 )
+      , arraySamplesPerFrame( 0 ), allocationsPerFrame( -1 )
+      , systemAllocationsPerFrame( -1 ), expandedMean( -1 ), peakRSS( 0 ) {}
+
+    std::string workload;
+    std::string backend;
+    std::string allocator;
+    size_t frames;
+    double writeSeconds;
+    uint64_t fileBytes;
+    double openSeconds;
+    double traverseSeconds;
+    size_t numObjects;
+    size_t numProperties;
+    double readMean;
+    double readMin;
+    double readMax;
+    uint64_t readBytesPerFrame;
+    size_t arraySamplesPerFrame;
+    double allocationsPerFrame;
+    double systemAllocationsPerFrame;
+    double expandedMean;
+    uint64_t peakRSS;
+};
+
+void WriteJSON( std::ostream &oStream, const Result &iResult )
+{
+    oStream << "{\"workload\": \"" << iResult.workload << "\""
+            << ", \"backend\": \"" << iResult.backend << "\""
+            << ", \"allocator\": \"" << iResult.allocator << "\""
+            << ", \"frames\": " << iResult.frames;
+
+    if ( iResult.writeSeconds >= 0.0 )
+    {
+        double mb = static_cast<double>( iResult.fileBytes ) / 1048576.0;
+        oStream << ", \"write_seconds\": " << iResult.writeSeconds
+                << ", \"file_bytes\": " << iResult.fileBytes
+                << ", \"write_mb_per_second\": "
+                << ( iResult.writeSeconds > 0.0 ?
+                     mb / iResult.writeSeconds : 0.0 );
+    }
+
+    oStream << ", \"open_seconds\": " << iResult.openSeconds
+            << ", \"traverse_seconds\": " << iResult.traverseSeconds
+            << ", \"objects\": " << iResult.numObjects
+            << ", \"properties\": " << iResult.numProperties
+            << ", \"read_frame_seconds_mean\": " << iResult.readMean
+            << ", \"read_frame_seconds_min\": " << iResult.readMin
+            << ", \"read_frame_seconds_max\": " << iResult.readMax
+            << ", \"read_bytes_per_frame\": " << iResult.readBytesPerFrame
+            << ", \"array_samples_per_frame\": "
+            << iResult.arraySamplesPerFrame;
+
+    if ( iResult.allocationsPerFrame >= 0.0 )
+    {
+        oStream << ", \"allocations_per_frame\": "
+                << iResult.allocationsPerFrame
+                << ", \"system_allocations_per_frame\": "
+                << iResult.systemAllocationsPerFrame;
+    }
+
+    if ( iResult.expandedMean >= 0.0 )
+    {
+        oStream << ", \"expanded_frame_seconds_mean\": "
+                << iResult.expandedMean;
+    }
+
+    oStream << ", \"peak_rss_bytes\": " << iResult.peakRSS << "}";
+}
+
+//-*****************************************************************************
+Abc::OArchive CreateArchive( const std::string &iBackend,
+                             const std::string &iPath )
+{
+    if ( iBackend == "hdf5" )
+    {
+        return Abc::OArchive( Alembic::AbcCoreHDF5::WriteArchive(), iPath );
+    }
+    return Abc::OArchive( Alembic::AbcCoreOgawa::WriteArchive(), iPath );
+}
+
+uint32_t AddFrameSampling( Abc::OArchive &ioArchive )
+{
+    return ioArchive.addTimeSampling(
+        AbcA::TimeSampling( 1.0 / 24.0, 0.0 ) );
+}
+
+//-*****************************************************************************
+// Writers.  Every writer is deterministic, so both backends get the same
+// data.
+
+void WriteXformLevel( AbcG::OObject iParent, size_t iDepth,
+                      size_t iBranching, uint32_t iTsIdx,
+                      std::vector<AbcG::OXform> &oXforms )
+{
+    if ( iDepth == 0 ) { return; }
+
+    for ( size_t i = 0; i < iBranching; ++i )
+    {
+        std::ostringstream name;
+        name << "xf" << i;
+        AbcG::OXform xf( iParent, name.str(), iTsIdx );
+        oXforms.push_back( xf );
+        WriteXformLevel( xf, iDepth - 1, iBranching, iTsIdx, oXforms );
+    }
+}
+
+void WriteXforms( Abc::OArchive &ioArchive, const Options &iOpts,
+                  const std::string &iRootName )
+{
+    uint32_t tsIdx = AddFrameSampling( ioArchive );
+    size_t depth = std::max( static_cast<size_t>(
+        std::log( 5000.0 * iOpts.scale ) / std::log( 4.0 ) + 0.5 ),
+        ( size_t ) 2 );
+
+    std::vector<AbcG::OXform> xforms;
+    AbcG::OObject root( ioArchive.getTop(), iRootName );
+    WriteXformLevel( root, depth, 4, tsIdx, xforms );
+
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        for ( size_t i = 0; i < xforms.size(); ++i )
+        {
+            double t = static_cast<double>( f + i );
+            AbcG::XformSample samp;
+            samp.setTranslation( Abc::V3d( std::sin( t ), std::cos( t ),
+                                           0.01 * t ) );
+            samp.setRotation( Abc::V3d( 0.0, 1.0, 0.0 ), 0.5 * t );
+            xforms[i].getSchema().set( samp );
+        }
+    }
+}
+
+void WritePolyMesh( Abc::OArchive &ioArchive, const Options &iOpts )
+{
+    uint32_t tsIdx = AddFrameSampling( ioArchive );
+    size_t res = Scaled( 512, std::sqrt( iOpts.scale ) );
+    size_t numVerts = ( res + 1 ) * ( res + 1 );
+
+    std::vector<int32_t> counts( res * res, 4 );
+    std::vector<int32_t> indices;
+    indices.reserve( res * res * 4 );
+    for ( size_t y = 0; y < res; ++y )
+    {
+        for ( size_t x = 0; x < res; ++x )
+        {
+            int32_t v = static_cast<int32_t>( y * ( res + 1 ) + x );
+            indices.push_back( v );
+            indices.push_back( v + 1 );
+            indices.push_back( v + static_cast<int32_t>( res ) + 2 );
+            indices.push_back( v + static_cast<int32_t>( res ) + 1 );
+        }
+    }
+
+    // UVs are indexed per face-vertex into the per-vertex values.
+    std::vector<Abc::V2f> uvs( numVerts );
+    for ( size_t y = 0; y <= res; ++y )
+    {
+        for ( size_t x = 0; x <= res; ++x )
+        {
+            uvs[y * ( res + 1 ) + x] = Abc::V2f(
+                static_cast<float>( x ) / res,
+                static_cast<float>( y ) / res );
+        }
+    }
+    std::vector<uint32_t> uvIndices( indices.begin(), indices.end() );
+
+    AbcG::OPolyMesh mesh( ioArchive.getTop(), "mesh", tsIdx );
+    AbcG::OPolyMeshSchema &schema = mesh.getSchema();
+
+    std::vector<Abc::V3f> P( numVerts );
+    std::vector<Abc::N3f> N( indices.size() );
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        float phase = 0.25f * f;
+        for ( size_t i = 0; i < numVerts; ++i )
+        {
+            float x = static_cast<float>( i % ( res + 1 ) );
+            float y = static_cast<float>( i / ( res + 1 ) );
+            P[i] = Abc::V3f( x, 0.5f * std::sin( 0.1f * x + phase ), y );
+        }
+        for ( size_t i = 0; i < indices.size(); ++i )
+        {
+            N[i] = Abc::N3f( 0.0f, 1.0f, 0.0f );
+        }
+
+        AbcG::ON3fGeomParam::Sample nSamp(
+            Abc::N3fArraySample( N ), AbcG::kFacevaryingScope );
+        if ( f == 0 )
+        {
+            AbcG::OV2fGeomParam::Sample uvSamp(
+                Abc::V2fArraySample( uvs ), Abc::UInt32ArraySample( uvIndices ),
+                AbcG::kFacevaryingScope );
+            schema.set( AbcG::OPolyMeshSchema::Sample(
+                Abc::V3fArraySample( P ), Abc::Int32ArraySample( indices ),
+                Abc::Int32ArraySample( counts ), uvSamp, nSamp ) );
+        }
+        else
+        {
+            Abc::V3fArraySample positions( P );
+            AbcG::OPolyMeshSchema::Sample samp( positions );
+            samp.setNormals( nSamp );
+            schema.set( samp );
+        }
+    }
+}
+
+void WritePoints( Abc::OArchive &ioArchive, const Options &iOpts )
+{
+    uint32_t tsIdx = AddFrameSampling( ioArchive );
+    size_t numPoints = Scaled( 1000000, iOpts.scale );
+
+    AbcG::OPoints points( ioArchive.getTop(), "points", tsIdx );
+    std::vector<Abc::V3f> P( numPoints );
+    std::vector<Abc::V3f> V( numPoints );
+    std::vector<uint64_t> ids( numPoints );
+    for ( size_t i = 0; i < numPoints; ++i )
+    {
+        ids[i] = i;
+        V[i] = Abc::V3f( 0.0f, -1.0f, 0.001f * ( i % 1000 ) );
+    }
+
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        for ( size_t i = 0; i < numPoints; ++i )
+        {
+            float u = static_cast<float>( i % 1000 );
+            float v = static_cast<float>( i / 1000 );
+            P[i] = Abc::V3f( u, v, 0.0f ) + V[i] * static_cast<float>( f );
+        }
+        points.getSchema().set( AbcG::OPointsSchema::Sample(
+            Abc::V3fArraySample( P ), Abc::UInt64ArraySample( ids ),
+            Abc::V3fArraySample( V ) ) );
+    }
+}
+
+void WriteCurves( Abc::OArchive &ioArchive, const Options &iOpts )
+{
+    uint32_t tsIdx = AddFrameSampling( ioArchive );
+    size_t numCurves = Scaled( 100000, iOpts.scale );
+    const size_t numCVs = 8;
+
+    AbcG::OCurves curves( ioArchive.getTop(), "groom", tsIdx );
+    std::vector<int32_t> counts( numCurves, static_cast<int32_t>( numCVs ) );
+    std::vector<Abc::V3f> P( numCurves * numCVs );
+    std::vector<float> widths( P.size() );
+    for ( size_t i = 0; i < widths.size(); ++i )
+    {
+        widths[i] = 0.01f * ( 1.0f - static_cast<float>( i % numCVs ) /
+                              numCVs );
+    }
+
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        float sway = 0.05f * std::sin( 0.3f * f );
+        for ( size_t c = 0; c < numCurves; ++c )
+        {
+            float x = static_cast<float>( c % 1000 );
+            float z = static_cast<float>( c / 1000 );
+            for ( size_t k = 0; k < numCVs; ++k )
+            {
+                float h = static_cast<float>( k );
+                P[c * numCVs + k] = Abc::V3f( x + sway * h * h, h, z );
+            }
+        }
+
+        AbcG::OFloatGeomParam::Sample wSamp(
+            Abc::FloatArraySample( widths ), AbcG::kVertexScope );
+        curves.getSchema().set( AbcG::OCurvesSchema::Sample(
+            Abc::V3fArraySample( P ), Abc::Int32ArraySample( counts ),
+            AbcG::kCubic, AbcG::kNonPeriodic, wSamp ) );
+    }
+}
+
+//-*****************************************************************************
+// Readers.
+
+struct Traversal
+{
+    Traversal() : numObjects( 0 ), numProperties( 0 ) {}
+
+    size_t numObjects;
+    size_t numProperties;
+    std::vector<Abc::IArrayProperty> arrays;
+    std::vector<Abc::IScalarProperty> scalars;
+};
+
+void TraverseProperties( Abc::ICompoundProperty iProps, Traversal &ioTrav )
+{
+    for ( size_t i = 0; i < iProps.getNumProperties(); ++i )
+    {
+        const AbcA::PropertyHeader &header = iProps.getPropertyHeader( i );
+        ++ioTrav.numProperties;
+
+        if ( header.isCompound() )
+        {
+            TraverseProperties( Abc::ICompoundProperty(
+                iProps, header.getName() ), ioTrav );
+        }
+        else if ( header.isArray() )
+        {
+            ioTrav.arrays.push_back( Abc::IArrayProperty(
+                iProps, header.getName() ) );
+        }
+        else
+        {
+            ioTrav.scalars.push_back( Abc::IScalarProperty(
+                iProps, header.getName() ) );
+        }
+    }
+}
+
+void TraverseObject( Abc::IObject iObject, Traversal &ioTrav )
+{
+    ++ioTrav.numObjects;
+    TraverseProperties( iObject.getProperties(), ioTrav );
+
+    for ( size_t i = 0; i < iObject.getNumChildren(); ++i )
+    {
+        TraverseObject( iObject.getChild( i ), ioTrav );
+    }
+}
+
+//! Reads every property at frame iFrame, clamped to the property's samples,
+//! with array samples from iAllocator if there is one.  Returns the number
+//! of bytes read.
+uint64_t ReadFrame( Traversal &iTrav, size_t iFrame,
+                    const AbcA::ArraySampleAllocatorPtr &iAllocator )
+{
+    uint64_t bytes = 0;
+
+    for ( size_t i = 0; i < iTrav.arrays.size(); ++i )
+    {
+        Abc::IArrayProperty &prop = iTrav.arrays[i];
+        size_t numSamples = prop.getNumSamples();
+        if ( numSamples == 0 ) { continue; }
+
+        Abc::ISampleSelector ss( static_cast<AbcA::index_t>(
+            std::min( iFrame, numSamples - 1 ) ) );
+        AbcA::ArraySamplePtr samp;
+        if ( iAllocator ) { prop.getWithAllocator( samp, iAllocator, ss ); }
+        else { prop.get( samp, ss ); }
+        bytes += samp->size() * samp->getDataType().getNumBytes();
+    }
+
+    std::vector<char> buffer;
+    for ( size_t i = 0; i < iTrav.scalars.size(); ++i )
+    {
+        Abc::IScalarProperty &prop = iTrav.scalars[i];
+        const AbcA::DataType &dtype = prop.getDataType();
+        size_t numSamples = prop.getNumSamples();
+        if ( numSamples == 0 ||
+             dtype.getPod() == Alembic::Util::kStringPOD ||
+             dtype.getPod() == Alembic::Util::kWstringPOD )
+        {
+            continue;
+        }
+
+        buffer.resize( dtype.getNumBytes() );
+        prop.get( &buffer[0], Abc::ISampleSelector(
+            static_cast<AbcA::index_t>(
+                std::min( iFrame, numSamples - 1 ) ) ) );
+        bytes += buffer.size();
+    }
+
+    return bytes;
+}
+
+//! Expands the indexed and non-indexed geom params the workload has, so the
+//! cost of getExpanded can be compared with a plain read.
+double ExpandedFrameSeconds( Abc::IArchive &iArchive, const Options &iOpts,
+                             const std::string &iWorkload )
+{
+    if ( iWorkload != "polymesh" && iWorkload != "curves" ) { return -1.0; }
+
+    std::vector<AbcG::IV2fGeomParam> uvParams;
+    std::vector<AbcG::IN3fGeomParam> normalParams;
+    std::vector<AbcG::IFloatGeomParam> floatParams;
+    if ( iWorkload == "polymesh" )
+    {
+        AbcG::IPolyMesh mesh( iArchive.getTop(), "mesh" );
+        uvParams.push_back( mesh.getSchema().getUVsParam() );
+        normalParams.push_back( mesh.getSchema().getNormalsParam() );
+    }
+    else
+    {
+        AbcG::ICurves curves( iArchive.getTop(), "groom" );
+        floatParams.push_back( curves.getSchema().getWidthsParam() );
+    }
+
+    Clock::time_point start = Clock::now();
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        Abc::ISampleSelector ss( static_cast<AbcA::index_t>( f ) );
+        for ( size_t i = 0; i < uvParams.size(); ++i )
+        {
+            AbcG::IV2fGeomParam::Sample samp;
+            uvParams[i].getExpanded( samp, ss );
+        }
+        for ( size_t i = 0; i < normalParams.size(); ++i )
+        {
+            AbcG::IN3fGeomParam::Sample samp;
+            normalParams[i].getExpanded( samp, ss );
+        }
+        for ( size_t i = 0; i < floatParams.size(); ++i )
+        {
+            AbcG::IFloatGeomParam::Sample samp;
+            floatParams[i].getExpanded( samp, ss );
+        }
+    }
+    return Seconds( start ) / iOpts.frames;
+}
+
+void MeasureRead( Abc::IArchive &iArchive, const Options &iOpts,
+                  Result &ioResult )
+{
+    Clock::time_point start = Clock::now();
+    Traversal trav;
+    TraverseObject( iArchive.getTop(), trav );
+    ioResult.traverseSeconds = Seconds( start );
+    ioResult.numObjects = trav.numObjects;
+    ioResult.numProperties = trav.numProperties;
+    ioResult.arraySamplesPerFrame = trav.arrays.size();
+
+    AbcA::ArraySampleAllocatorPtr allocator;
+    Alembic::Util::shared_ptr<AbcA::ArenaArraySampleAllocator> arena;
+    if ( iOpts.allocator == "pooled" )
+    {
+        allocator.reset( new AbcA::PooledArraySampleAllocator() );
+    }
+    else if ( iOpts.allocator == "arena" )
+    {
+        arena.reset( new AbcA::ArenaArraySampleAllocator() );
+        allocator = arena;
+    }
+
+    double total = 0.0;
+    uint64_t bytes = 0;
+    for ( size_t f = 0; f < iOpts.frames; ++f )
+    {
+        start = Clock::now();
+        bytes += ReadFrame( trav, f, allocator );
+        if ( arena ) { arena->reset(); }
+        double s = Seconds( start );
+
+        total += s;
+        ioResult.readMin = f == 0 ? s : std::min( ioResult.readMin, s );
+        ioResult.readMax = std::max( ioResult.readMax, s );
+    }
+    ioResult.readMean = total / iOpts.frames;
+    ioResult.readBytesPerFrame = bytes / iOpts.frames;
+
+    if ( allocator )
+    {
+        AbcA::ArraySampleAllocator::Stats stats = allocator->getStats();
+        ioResult.allocationsPerFrame =
+            static_cast<double>( stats.allocations ) / iOpts.frames;
+        ioResult.systemAllocationsPerFrame =
+            static_cast<double>( stats.systemAllocations ) / iOpts.frames;
+    }
+
+    ioResult.expandedMean = ExpandedFrameSeconds( iArchive, iOpts,
+                                                  ioResult.workload );
+}
+
+//-*****************************************************************************
+std::string ArchivePath( const Options &iOpts, const std::string &iWorkload,
+                         const std::string &iBackend, size_t iLayer = 0 )
+{
+    std::ostringstream path;
+    path << iOpts.dir << "/abcbench_" << iWorkload << "_" << iBackend;
+    if ( iWorkload == "layered" ) { path << "_" << iLayer; }
+    path << ".abc";
+    return path.str();
+}
+
+AbcF::IFactory MakeFactory( const Options &iOpts )
+{
+    AbcF::IFactory factory;
+    factory.setPolicy( Abc::ErrorHandler::kThrowPolicy );
+    factory.setOgawaNumStreams( iOpts.ogawaStreams );
+    return factory;
+}
+
+Result RunCase( const Options &iOpts, const std::string &iWorkload,
+                const std::string &iBackend )
+{
+    Result result;
+    result.workload = iWorkload;
+    result.backend = iBackend;
+    result.allocator = iOpts.allocator;
+    result.frames = iOpts.frames;
+
+    const size_t numLayers = 8;
+    std::vector<std::string> paths;
+    if ( iWorkload == "layered" )
+    {
+        for ( size_t l = 0; l < numLayers; ++l )
+        {
+            paths.push_back( ArchivePath( iOpts, iWorkload, iBackend, l ) );
+        }
+    }
+    else
+    {
+        paths.push_back( ArchivePath( iOpts, iWorkload, iBackend ) );
+    }
+
+    // write, including the time to close the archive
+    Clock::time_point start = Clock::now();
+    for ( size_t l = 0; l < paths.size(); ++l )
+    {
+        Abc::OArchive archive = CreateArchive( iBackend, paths[l] );
+        if ( iWorkload == "xforms" )
+        {
+            WriteXforms( archive, iOpts, "root" );
+        }
+        else if ( iWorkload == "polymesh" )
+        {
+            WritePolyMesh( archive, iOpts );
+        }
+        else if ( iWorkload == "points" )
+        {
+            WritePoints( archive, iOpts );
+        }
+        else if ( iWorkload == "curves" )
+        {
+            WriteCurves( archive, iOpts );
+        }
+        else
+        {
+            // every layer overrides the same hierarchy and adds its own
+            // branch, so the layered archive has to merge at every level
+            Options layerOpts = iOpts;
+            layerOpts.scale = iOpts.scale / numLayers;
+            WriteXforms( archive, layerOpts, "root" );
+            std::ostringstream name;
+            name << "layer" << l;
+            WriteXforms( archive, layerOpts, name.str() );
+        }
+    }
+    result.writeSeconds = Seconds( start );
+    for ( size_t l = 0; l < paths.size(); ++l )
+    {
+        result.fileBytes += FileSize( paths[l] );
+    }
+
+    // read
+    {
+        AbcF::IFactory factory = MakeFactory( iOpts );
+        start = Clock::now();
+        Abc::IArchive archive = paths.size() == 1 ?
+            factory.getArchive( paths[0] ) : factory.getArchive( paths );
+        result.openSeconds = Seconds( start );
+
+        if ( !archive.valid() )
+        {
+            throw std::runtime_error( "Could not open " + paths[0] );
+        }
+
+        MeasureRead( archive, iOpts, result );
+    }
+
+    result.peakRSS = PeakRSS();
+
+    if ( !iOpts.keep )
+    {
+        for ( size_t l = 0; l < paths.size(); ++l )
+        {
+            std::remove( paths[l].c_str() );
+        }
+    }
+
+    return result;
+}
+
+//-*****************************************************************************
+void Usage()
+{
+    std::cerr << "usage: abcbench [--backend ogawa|hdf5]... "
+              << "[--workload xforms|polymesh|points|curves|layered]...\n"
+              << "                [--frames n] [--scale s] [--dir path] "
+              << "[--out file]\n"
+              << "                [--ogawa-streams n] "
+              << "[--allocator default|pooled|arena] [--keep]\n";
+}
+
+bool ParseArgs( int argc, char *argv[], Options &oOpts )
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ( arg == "--keep" )
+        {
+            oOpts.keep = true;
+        }
+        else if ( !hasValue )
+        {
+            return false;
+        }
+        else if ( arg == "--backend" )
+        {
+            oOpts.backends.push_back( argv[++i] );
+        }
+        else if ( arg == "--workload" )
+        {
+            oOpts.workloads.push_back( argv[++i] );
+        }
+        else if ( arg == "--frames" )
+        {
+            oOpts.frames = std::max( std::atoi( argv[++i] ), 1 );
+        }
+        else if ( arg == "--scale" )
+        {
+            oOpts.scale = std::atof( argv[++i] );
+        }
+        else if ( arg == "--dir" )
+        {
+            oOpts.dir = argv[++i];
+        }
+        else if ( arg == "--out" )
+        {
+            oOpts.out = argv[++i];
+        }
+        else if ( arg == "--ogawa-streams" )
+        {
+            oOpts.ogawaStreams = std::max( std::atoi( argv[++i] ), 1 );
+        }
+        else if ( arg == "--allocator" )
+        {
+            oOpts.allocator = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if ( oOpts.backends.empty() )
+    {
+        oOpts.backends.push_back( "ogawa" );
+        oOpts.backends.push_back( "hdf5" );
+    }
+    if ( oOpts.workloads.empty() )
+    {
+        const char *all[] = { "xforms", "polymesh", "points", "curves",
+                              "layered" };
+        oOpts.workloads.assign( all, all + 5 );
+    }
+
+    for ( size_t i = 0; i < oOpts.backends.size(); ++i )
+    {
+        if ( oOpts.backends[i] != "ogawa" && oOpts.backends[i] != "hdf5" )
+        {
+            return false;
+        }
+    }
+    for ( size_t i = 0; i < oOpts.workloads.size(); ++i )
+    {
+        const std::string &w = oOpts.workloads[i];
+        if ( w != "xforms" && w != "polymesh" && w != "points" &&
+             w != "curves" && w != "layered" )
+        {
+            return false;
+        }
+    }
+
+    if ( oOpts.allocator != "default" && oOpts.allocator != "pooled" &&
+         oOpts.allocator != "arena" )
+    {
+        return false;
+    }
+
+    return oOpts.scale > 0.0;
+}
+
+} // End anonymous namespace
+
+//-*****************************************************************************
+int main( int argc, char *argv[] )
+{
+    Options opts;
+    if ( !ParseArgs( argc, argv, opts ) )
+    {
+        Usage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if ( !opts.out.empty() )
+    {
+        file.open( opts.out.c_str() );
+        if ( !file )
+        {
+            std::cerr << "abcbench: can't write " << opts.out << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = opts.out.empty() ? std::cout : file;
+
+    try
+    {
+        out << "[\n";
+        bool first = true;
+        for ( size_t w = 0; w < opts.workloads.size(); ++w )
+        {
+            for ( size_t b = 0; b < opts.backends.size(); ++b )
+            {
+                Result result = RunCase( opts, opts.workloads[w],
+                                         opts.backends[b] );
+                out << ( first ? "  " : ",\n  " );
+                WriteJSON( out, result );
+                out.flush();
+                first = false;
+            }
+        }
+        out << "\n]\n";
+    }
+    catch ( std::exception &e )
+    {
+        std::cerr << "abcbench: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
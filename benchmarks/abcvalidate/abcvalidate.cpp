@@ -0,0 +1,263 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+//-*****************************************************************************
+//! abcvalidate scans archives with Abc::ArchiveValidator and prints one JSON
+//! object per archive.
+//!
+//!     abcvalidate [--threads n] [--max-bytes-per-second n] [--no-digests]
+//!                 [--max-issues n] [--out file] archive.abc...
+//!
+//! The exit status is 0 if every archive is valid, 2 if any has issues and
+//! 1 if the arguments are wrong or an archive can't be opened at all.
+//-*****************************************************************************
+
+#include <Alembic/Abc/All.h>
+#include <Alembic/Abc/ArchiveValidation.h>
+#include <Alembic/AbcCoreFactory/All.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Abc = Alembic::Abc;
+namespace AbcF = Alembic::AbcCoreFactory;
+
+namespace {
+
+//-*****************************************************************************
+struct Options
+{
+    std::vector<std::string> paths;
+    std::string out;
+    Abc::ArchiveValidationOptions validation;
+};
+
+//-*****************************************************************************
+void WriteString( std::ostream &oStream, const std::string &iStr )
+{
+    oStream << '"';
+    for ( size_t i = 0; i < iStr.size(); ++i )
+    {
+        unsigned char c = static_cast<unsigned char>( iStr[i] );
+        if ( c == '"' || c == '\\' )
+        {
+            oStream << '\\' << c;
+        }
+        else if ( c < 0x20 )
+        {
+            char buf[8];
+            std::snprintf( buf, sizeof( buf ), "\\u%04x", c );
+            oStream << buf;
+        }
+        else
+        {
+            oStream << c;
+        }
+    }
+    oStream << '"';
+}
+
+const char *KindName( Abc::ArchiveValidationIssue::Kind iKind )
+{
+    switch ( iKind )
+    {
+    case Abc::ArchiveValidationIssue::kHierarchyError:
+        return "hierarchy_error";
+    case Abc::ArchiveValidationIssue::kPropertyError:
+        return "property_error";
+    case Abc::ArchiveValidationIssue::kSampleError:
+        return "sample_error";
+    case Abc::ArchiveValidationIssue::kDigestMismatch:
+        return "digest_mismatch";
+    case Abc::ArchiveValidationIssue::kDimensionMismatch:
+        return "dimension_mismatch";
+    }
+    return "unknown";
+}
+
+void WriteJSON( std::ostream &oStream, const std::string &iPath,
+                const Abc::ArchiveValidationReport &iReport )
+{
+    oStream << "{\"archive\": ";
+    WriteString( oStream, iPath );
+    oStream << ", \"ok\": " << ( iReport.ok() ? "true" : "false" )
+            << ", \"objects\": " << iReport.objects
+            << ", \"properties\": " << iReport.properties
+            << ", \"samples\": " << iReport.samples
+            << ", \"bytes\": " << iReport.bytes
+            << ", \"cancelled\": " << ( iReport.cancelled ? "true" : "false" )
+            << ", \"num_issues\": " << iReport.numIssues
+            << ", \"issues\": [";
+
+    for ( size_t i = 0; i < iReport.issues.size(); ++i )
+    {
+        const Abc::ArchiveValidationIssue &issue = iReport.issues[i];
+        oStream << ( i ? ",\n    " : "\n    " )
+                << "{\"kind\": \"" << KindName( issue.kind ) << "\""
+                << ", \"object\": ";
+        WriteString( oStream, issue.objectPath );
+        oStream << ", \"property\": ";
+        WriteString( oStream, issue.propertyPath );
+        oStream << ", \"sample\": " << issue.sampleIndex
+                << ", \"message\": ";
+        WriteString( oStream, issue.message );
+        oStream << "}";
+    }
+
+    oStream << ( iReport.issues.empty() ? "]}" : "\n  ]}" );
+}
+
+//-*****************************************************************************
+void Usage()
+{
+    std::cerr << "usage: abcvalidate [--threads n] "
+              << "[--max-bytes-per-second n] [--no-digests]\n"
+              << "                   [--max-issues n] [--out file] "
+              << "archive.abc...\n";
+}
+
+bool ParseArgs( int argc, char *argv[], Options &oOpts )
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ( arg == "--no-digests" )
+        {
+            oOpts.validation.verifyDigests = false;
+        }
+        else if ( arg.compare( 0, 2, "--" ) != 0 )
+        {
+            oOpts.paths.push_back( arg );
+        }
+        else if ( !hasValue )
+        {
+            return false;
+        }
+        else if ( arg == "--threads" )
+        {
+            oOpts.validation.numThreads = std::max( std::atoi( argv[++i] ),
+                                                    0 );
+        }
+        else if ( arg == "--max-bytes-per-second" )
+        {
+            oOpts.validation.maxBytesPerSecond =
+                std::strtoull( argv[++i], NULL, 10 );
+        }
+        else if ( arg == "--max-issues" )
+        {
+            oOpts.validation.maxIssues = std::max( std::atoi( argv[++i] ),
+                                                   0 );
+        }
+        else if ( arg == "--out" )
+        {
+            oOpts.out = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return !oOpts.paths.empty();
+}
+
+} // End anonymous namespace
+
+//-*****************************************************************************
+int main( int argc, char *argv[] )
+{
+    Options opts;
+    if ( !ParseArgs( argc, argv, opts ) )
+    {
+        Usage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if ( !opts.out.empty() )
+    {
+        file.open( opts.out.c_str() );
+        if ( !file )
+        {
+            std::cerr << "abcvalidate: can't write " << opts.out << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = opts.out.empty() ? std::cout : file;
+
+    int status = 0;
+    size_t written = 0;
+    out << "[\n";
+    for ( size_t i = 0; i < opts.paths.size(); ++i )
+    {
+        Abc::IArchive archive;
+        try
+        {
+            AbcF::IFactory factory;
+            factory.setPolicy( Abc::ErrorHandler::kThrowPolicy );
+            archive = factory.getArchive( opts.paths[i] );
+        }
+        catch ( std::exception &e )
+        {
+            std::cerr << "abcvalidate: " << e.what() << "\n";
+        }
+
+        if ( !archive.valid() )
+        {
+            std::cerr << "abcvalidate: can't open " << opts.paths[i] << "\n";
+            status = 1;
+            continue;
+        }
+
+        Abc::ArchiveValidator validator( archive, opts.validation );
+        Abc::ArchiveValidationReport report = validator.run();
+
+        out << ( written++ ? ",\n  " : "  " );
+        WriteJSON( out, opts.paths[i], report );
+        out.flush();
+
+        if ( !report.ok() && status == 0 ) { status = 2; }
+    }
+    out << "\n]\n";
+
+    return status;
+}
@@ -43,6 +43,8 @@
 #include <Alembic/Abc/Foundation.h>
 
 #include <Alembic/Abc/ArchiveInfo.h>
+#include <Alembic/Abc/ArchiveCopy.h>
+#include <Alembic/Abc/ArchiveValidation.h>
 #include <Alembic/Abc/Argument.h>
 #include <Alembic/Abc/IArchive.h>
 #include <Alembic/Abc/IArrayProperty.h>
@@ -55,6 +57,7 @@
 #include <Alembic/Abc/ISchemaObject.h>
 #include <Alembic/Abc/ITypedArrayProperty.h>
 #include <Alembic/Abc/ITypedScalarProperty.h>
+#include <Alembic/Abc/ReadInstrumentation.h>
 
 #include <Alembic/Abc/OArchive.h>
 #include <Alembic/Abc/OArrayProperty.h>
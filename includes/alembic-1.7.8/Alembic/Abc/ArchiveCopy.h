@@ -0,0 +1,400 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_Abc_ArchiveCopy_h_
+#define _Alembic_Abc_ArchiveCopy_h_
+
+#include <Alembic/Abc/Foundation.h>
+#include <Alembic/Abc/IArchive.h>
+#include <Alembic/Abc/IObject.h>
+#include <Alembic/Abc/OArchive.h>
+#include <Alembic/Abc/OObject.h>
+#include <Alembic/Util/ParallelFor.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+namespace Alembic {
+namespace Abc {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Controls what ArchiveCopier copies and how.
+struct ArchiveCopyOptions
+{
+    ArchiveCopyOptions()
+      : numThreads( 0 ), batchSize( 32 ), minBytesPerThread( 1 << 20 ) {}
+
+    //! Return false to leave out an object and everything under it.  No
+    //! filter copies every object.
+    std::function<bool ( const AbcA::ObjectHeader & )> objectFilter;
+
+    //! Return false to leave out a property (and, for a compound,
+    //! everything in it).  Called with the full name of the owning object
+    //! and the property's header.  No filter copies every property.
+    std::function<bool ( const std::string &,
+                         const AbcA::PropertyHeader & )> propertyFilter;
+
+    //! Threads used to read samples ahead of the writer, 0 for the default.
+    size_t numThreads;
+
+    //! How many samples of an array property are read ahead at once.
+    size_t batchSize;
+
+    //! Extra threads are only started for a batch when each of them gets
+    //! about this many bytes of samples to read, so batches of small samples
+    //! are read on the calling thread.
+    size_t minBytesPerThread;
+};
+
+//-*****************************************************************************
+//! Totals of what an ArchiveCopier did.
+struct ArchiveCopyStats
+{
+    ArchiveCopyStats()
+      : objects( 0 ), properties( 0 ), samples( 0 ), repeatedSamples( 0 )
+      , bytesRead( 0 ) {}
+
+    size_t objects;
+    size_t properties;
+    size_t samples;
+
+    //! Samples that matched the one before them, and were written with
+    //! setFromPreviousSample, without being read at all.
+    size_t repeatedSamples;
+
+    uint64_t bytesRead;
+};
+
+//-*****************************************************************************
+//! Copies objects and properties from a reader to a writer, through the
+//! AbcCoreAbstract interfaces, so the samples go across exactly as they
+//! were stored: same PODs, extents, metadata and time sampling, with no
+//! typed property or schema in between, and no conversion.
+//!
+//! An array sample whose stored key (ArrayPropertyReader::getKey, which
+//! Ogawa keeps next to the data) matches the previous sample's is written
+//! with setFromPreviousSample, so constant or held data is neither read
+//! nor hashed again.  Other samples are read ahead in parallel batches
+//! while the single writer consumes them in order; the writer itself still
+//! hashes them, which is how it deduplicates.
+class ArchiveCopier
+{
+public:
+    ArchiveCopier( IArchive iIn, OArchive iOut,
+                   const ArchiveCopyOptions &iOptions = ArchiveCopyOptions() )
+      : m_in( iIn ), m_out( iOut ), m_options( iOptions )
+    {
+        ABCA_ASSERT( m_in.valid() && m_out.valid(),
+                     "ArchiveCopier needs a valid input and output archive" );
+    }
+
+    //! Copies the properties of the top object and all of its children.
+    void copyArchive()
+    {
+        IObject inTop = m_in.getTop();
+        OObject outTop = m_out.getTop();
+        copyProperties( inTop.getFullName(),
+                        inTop.getPtr()->getProperties(),
+                        outTop.getPtr()->getProperties() );
+        copyChildren( inTop, outTop );
+    }
+
+    //! Copies iObject, with its properties and subtree, as a new child of
+    //! iOutParent.  Returns false if the object filter left it out.
+    bool copyObject( IObject iObject, OObject iOutParent )
+    {
+        const AbcA::ObjectHeader &header = iObject.getHeader();
+        if ( m_options.objectFilter && !m_options.objectFilter( header ) )
+        {
+            return false;
+        }
+
+        AbcA::ObjectWriterPtr writer = iOutParent.getPtr()->createChild(
+            AbcA::ObjectHeader( header.getName(), header.getMetaData() ) );
+        ++m_stats.objects;
+
+        copyProperties( iObject.getFullName(),
+                        iObject.getPtr()->getProperties(),
+                        writer->getProperties() );
+
+        copyChildren( iObject, OObject( writer, kWrapExisting ) );
+        return true;
+    }
+
+    //! Copies the children of iObject under iOutObject.
+    void copyChildren( IObject iObject, OObject iOutObject )
+    {
+        size_t numChildren = iObject.getNumChildren();
+        for ( size_t i = 0; i < numChildren; ++i )
+        {
+            copyObject( iObject.getChild( i ), iOutObject );
+        }
+    }
+
+    const ArchiveCopyStats &getStats() const { return m_stats; }
+
+private:
+    uint32_t getTimeSamplingIndex( const AbcA::TimeSamplingPtr &iTs )
+    {
+        if ( !iTs )
+        {
+            return 0;
+        }
+
+        std::map<const AbcA::TimeSampling *, uint32_t>::const_iterator it =
+            m_timeSamplings.find( iTs.get() );
+        if ( it != m_timeSamplings.end() )
+        {
+            return it->second;
+        }
+
+        // the writer shares equal time samplings, including the default
+        uint32_t index = m_out.addTimeSampling( *iTs );
+        m_timeSamplings[iTs.get()] = index;
+        return index;
+    }
+
+    void copyProperties( const std::string &iObjectName,
+                         AbcA::CompoundPropertyReaderPtr iIn,
+                         AbcA::CompoundPropertyWriterPtr iOut )
+    {
+        size_t numProps = iIn->getNumProperties();
+        for ( size_t i = 0; i < numProps; ++i )
+        {
+            const AbcA::PropertyHeader &header = iIn->getPropertyHeader( i );
+            if ( m_options.propertyFilter &&
+                 !m_options.propertyFilter( iObjectName, header ) )
+            {
+                continue;
+            }
+
+            ++m_stats.properties;
+            const std::string &name = header.getName();
+
+            if ( header.isCompound() )
+            {
+                copyProperties( iObjectName,
+                                iIn->getCompoundProperty( name ),
+                                iOut->createCompoundProperty(
+                                    name, header.getMetaData() ) );
+                continue;
+            }
+
+            uint32_t tsIndex =
+                getTimeSamplingIndex( header.getTimeSampling() );
+
+            if ( header.isArray() )
+            {
+                copyArray( iIn->getArrayProperty( name ),
+                           iOut->createArrayProperty(
+                               name, header.getMetaData(),
+                               header.getDataType(), tsIndex ) );
+            }
+            else
+            {
+                copyScalar( iIn->getScalarProperty( name ),
+                            iOut->createScalarProperty(
+                                name, header.getMetaData(),
+                                header.getDataType(), tsIndex ) );
+            }
+        }
+    }
+
+    void copyArray( AbcA::ArrayPropertyReaderPtr iIn,
+                    AbcA::ArrayPropertyWriterPtr iOut )
+    {
+        size_t numSamples = iIn->getNumSamples();
+        size_t batchSize = std::max( m_options.batchSize, ( size_t ) 1 );
+
+        AbcA::ArraySampleKey prevKey;
+        bool hasPrevKey = false;
+
+        // bytes in the last sample read, to size the read ahead grain
+        size_t sampleBytes = 0;
+        bool hasSampleBytes = false;
+
+        std::vector<AbcA::ArraySamplePtr> samples;
+        std::vector<char> repeats;
+
+        for ( size_t begin = 0; begin < numSamples; begin += batchSize )
+        {
+            size_t end = std::min( begin + batchSize, numSamples );
+
+            // reading a stored key is cheap, and tells us which samples we
+            // don't need to read at all
+            repeats.assign( end - begin, 0 );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                AbcA::ArraySampleKey key;
+                bool hasKey = iIn->getKey( i, key );
+                repeats[i - begin] = hasKey && hasPrevKey && key == prevKey;
+                prevKey = key;
+                hasPrevKey = hasKey;
+            }
+
+            samples.assign( end - begin, AbcA::ArraySamplePtr() );
+
+            if ( !hasSampleBytes )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    if ( repeats[i - begin] ) { continue; }
+
+                    Util::Dimensions dims;
+                    iIn->getDimensions( i, dims );
+                    sampleBytes = dims.numPoints() *
+                        iIn->getHeader().getDataType().getNumBytes();
+                    hasSampleBytes = true;
+                    break;
+                }
+            }
+
+            size_t grain = std::max( m_options.minBytesPerThread /
+                                     std::max( sampleBytes, ( size_t ) 1 ),
+                                     ( size_t ) 1 );
+
+            Util::ParallelFor( begin, end, grain,
+                [&]( size_t iBegin, size_t iEnd )
+                {
+                    for ( size_t i = iBegin; i < iEnd; ++i )
+                    {
+                        if ( !repeats[i - begin] )
+                        {
+                            iIn->getSample( i, samples[i - begin] );
+                        }
+                    }
+                }, m_options.numThreads );
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                ++m_stats.samples;
+                if ( repeats[i - begin] )
+                {
+                    ++m_stats.repeatedSamples;
+                    iOut->setFromPreviousSample();
+                    continue;
+                }
+
+                const AbcA::ArraySamplePtr &sample = samples[i - begin];
+                sampleBytes = sample->size() *
+                    sample->getDataType().getNumBytes();
+                m_stats.bytesRead += sampleBytes;
+                iOut->setSample( *sample );
+            }
+        }
+    }
+
+    void copyScalar( AbcA::ScalarPropertyReaderPtr iIn,
+                     AbcA::ScalarPropertyWriterPtr iOut )
+    {
+        const AbcA::DataType &dtype = iIn->getHeader().getDataType();
+        size_t extent = dtype.getExtent();
+        size_t numSamples = iIn->getNumSamples();
+
+        if ( dtype.getPod() == kStringPOD )
+        {
+            copyScalarStrings<std::string>( iIn, iOut, extent, numSamples );
+            return;
+        }
+        else if ( dtype.getPod() == kWstringPOD )
+        {
+            copyScalarStrings<std::wstring>( iIn, iOut, extent, numSamples );
+            return;
+        }
+
+        std::vector<char> prev( dtype.getNumBytes() );
+        std::vector<char> cur( dtype.getNumBytes() );
+        for ( size_t i = 0; i < numSamples; ++i )
+        {
+            ++m_stats.samples;
+            iIn->getSample( i, cur.empty() ? NULL : &cur[0] );
+            m_stats.bytesRead += cur.size();
+
+            if ( i > 0 && cur == prev )
+            {
+                ++m_stats.repeatedSamples;
+                iOut->setFromPreviousSample();
+            }
+            else
+            {
+                iOut->setSample( cur.empty() ? NULL : &cur[0] );
+                prev.swap( cur );
+            }
+        }
+    }
+
+    template <class STRING>
+    void copyScalarStrings( AbcA::ScalarPropertyReaderPtr iIn,
+                            AbcA::ScalarPropertyWriterPtr iOut,
+                            size_t iExtent, size_t iNumSamples )
+    {
+        std::vector<STRING> prev( iExtent );
+        std::vector<STRING> cur( iExtent );
+        for ( size_t i = 0; i < iNumSamples; ++i )
+        {
+            ++m_stats.samples;
+            iIn->getSample( i, &cur[0] );
+
+            if ( i > 0 && cur == prev )
+            {
+                ++m_stats.repeatedSamples;
+                iOut->setFromPreviousSample();
+            }
+            else
+            {
+                iOut->setSample( &cur[0] );
+                prev.swap( cur );
+            }
+        }
+    }
+
+    IArchive m_in;
+    OArchive m_out;
+    ArchiveCopyOptions m_options;
+    ArchiveCopyStats m_stats;
+    std::map<const AbcA::TimeSampling *, uint32_t> m_timeSamplings;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace Abc
+} // End namespace Alembic
+
+#endif
@@ -0,0 +1,461 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_Abc_ArchiveValidation_h_
+#define _Alembic_Abc_ArchiveValidation_h_
+
+#include <Alembic/Abc/Foundation.h>
+#include <Alembic/Abc/IArchive.h>
+#include <Alembic/Util/ParallelFor.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+namespace Alembic {
+namespace Abc {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+struct ArchiveValidationOptions
+{
+    ArchiveValidationOptions()
+      : numThreads( 1 ), maxBytesPerSecond( 0 ), verifyDigests( true )
+      , maxIssues( 1000 ) {}
+
+    //! Threads reading samples, 0 for one per core.  The default of one
+    //! keeps a background scan from competing with foreground work.
+    size_t numThreads;
+
+    //! Caps the rate at which sample data is read, across all threads.
+    //! 0 means no cap.
+    uint64_t maxBytesPerSecond;
+
+    //! Whether to recompute the digest of every array sample and compare it
+    //! with the stored key.
+    bool verifyDigests;
+
+    //! Stop recording issues past this many (they are still counted).
+    size_t maxIssues;
+};
+
+//-*****************************************************************************
+struct ArchiveValidationIssue
+{
+    enum Kind
+    {
+        //! An object, its children or its properties couldn't be read.
+        kHierarchyError,
+
+        //! A property couldn't be opened.
+        kPropertyError,
+
+        //! Reading a sample threw, which is how truncated or damaged data
+        //! usually shows up.
+        kSampleError,
+
+        //! A sample's data doesn't hash to its stored key.
+        kDigestMismatch,
+
+        //! A sample's size doesn't match its stored dimensions.
+        kDimensionMismatch
+    };
+
+    Kind kind;
+    std::string objectPath;
+
+    //! The property path under the object, with '/' between compounds, or
+    //! empty for hierarchy errors.
+    std::string propertyPath;
+
+    //! The sample, or -1.
+    int64_t sampleIndex;
+
+    std::string message;
+};
+
+//-*****************************************************************************
+struct ArchiveValidationReport
+{
+    ArchiveValidationReport()
+      : numIssues( 0 ), objects( 0 ), properties( 0 ), samples( 0 )
+      , bytes( 0 ), cancelled( false ) {}
+
+    bool ok() const { return numIssues == 0 && !cancelled; }
+
+    std::vector<ArchiveValidationIssue> issues;
+
+    //! All issues found, including those past ArchiveValidationOptions::
+    //! maxIssues.
+    size_t numIssues;
+
+    size_t objects;
+    size_t properties;
+    size_t samples;
+    uint64_t bytes;
+    bool cancelled;
+};
+
+//-*****************************************************************************
+//! Reads every object, property and sample of an archive, and reports what
+//! can't be read or doesn't match its stored key, instead of throwing.
+//! Array samples are rehashed with the same MurmurHash3 digest the writers
+//! store (ArraySample::getKey) and compared against the stored key.
+//!
+//! Meant to be run ahead of time on caches, possibly on a background thread:
+//! reads can be rate limited, cancel() may be called from any thread, and
+//! getProgress() reports how far along the scan is.
+class ArchiveValidator : private Util::noncopyable
+{
+public:
+    ArchiveValidator( IArchive iArchive,
+                      const ArchiveValidationOptions &iOptions =
+                      ArchiveValidationOptions() )
+      : m_archive( iArchive ), m_options( iOptions ), m_cancelled( false )
+      , m_samplesDone( 0 ), m_samplesTotal( 0 ), m_bytesRead( 0 )
+      , m_report( NULL ) {}
+
+    //! Runs the scan.  Every run starts over, so a validator can be run
+    //! again; runs must not overlap.  Once cancel() has been called, runs
+    //! stop at once and report that they were cancelled.
+    ArchiveValidationReport run()
+    {
+        ArchiveValidationReport report;
+        m_report = &report;
+        m_start = std::chrono::steady_clock::now();
+        m_samplesDone = 0;
+        m_samplesTotal = 0;
+        m_bytesRead = 0;
+
+        // the hierarchy walk is cheap and serial, it gathers the properties
+        // whose samples are then read in parallel
+        std::vector<Job> jobs;
+        AbcA::ObjectReaderPtr top;
+        try
+        {
+            top = m_archive.getPtr()->getTop();
+        }
+        catch ( std::exception &exc )
+        {
+            addIssue( ArchiveValidationIssue::kHierarchyError, "/", "", -1,
+                      exc.what() );
+        }
+
+        if ( top )
+        {
+            walkObject( top, "/", jobs );
+        }
+
+        size_t total = 0;
+        for ( size_t i = 0; i < jobs.size(); ++i )
+        {
+            total += jobs[i].numSamples;
+        }
+        m_samplesTotal = total;
+
+        Util::ParallelFor( 0, jobs.size(), 1,
+            [&]( size_t iBegin, size_t iEnd )
+            {
+                for ( size_t i = iBegin; i < iEnd && !m_cancelled; ++i )
+                {
+                    runJob( jobs[i] );
+                }
+            }, m_options.numThreads );
+
+        report.properties += jobs.size();
+        report.samples = m_samplesDone;
+        report.bytes = m_bytesRead;
+        report.cancelled = m_cancelled;
+        m_report = NULL;
+        return report;
+    }
+
+    void cancel() { m_cancelled = true; }
+
+    //! The fraction of samples read so far, once the hierarchy is walked.
+    double getProgress() const
+    {
+        size_t total = m_samplesTotal;
+        return total ? double( m_samplesDone ) / double( total ) : 0.0;
+    }
+
+private:
+    struct Job
+    {
+        std::string objectPath;
+        std::string propertyPath;
+        AbcA::CompoundPropertyReaderPtr parent;
+        AbcA::PropertyHeader header;
+        size_t numSamples;
+    };
+
+    static std::string ChildPath( const std::string &iParent,
+                                  const std::string &iName )
+    {
+        return iParent.empty() ? iName : iParent + "/" + iName;
+    }
+
+    void addIssue( ArchiveValidationIssue::Kind iKind,
+                   const std::string &iObjectPath,
+                   const std::string &iPropertyPath,
+                   int64_t iSampleIndex, const std::string &iMessage )
+    {
+        Util::scoped_lock l( m_issuesMutex );
+        ++m_report->numIssues;
+        if ( m_report->issues.size() < m_options.maxIssues )
+        {
+            ArchiveValidationIssue issue;
+            issue.kind = iKind;
+            issue.objectPath = iObjectPath;
+            issue.propertyPath = iPropertyPath;
+            issue.sampleIndex = iSampleIndex;
+            issue.message = iMessage;
+            m_report->issues.push_back( issue );
+        }
+    }
+
+    void walkObject( AbcA::ObjectReaderPtr iObject, const std::string &iPath,
+                     std::vector<Job> &oJobs )
+    {
+        ++m_report->objects;
+
+        try
+        {
+            walkCompound( iObject->getProperties(), iPath, "", oJobs );
+        }
+        catch ( std::exception &exc )
+        {
+            addIssue( ArchiveValidationIssue::kHierarchyError, iPath, "", -1,
+                      exc.what() );
+        }
+
+        size_t numChildren = 0;
+        try
+        {
+            numChildren = iObject->getNumChildren();
+        }
+        catch ( std::exception &exc )
+        {
+            addIssue( ArchiveValidationIssue::kHierarchyError, iPath, "", -1,
+                      exc.what() );
+        }
+
+        for ( size_t i = 0; i < numChildren && !m_cancelled; ++i )
+        {
+            std::string childPath = iPath;
+            try
+            {
+                const std::string &name = iObject->getChildHeader( i ).getName();
+                childPath = iPath == "/" ? "/" + name : iPath + "/" + name;
+                walkObject( iObject->getChild( i ), childPath, oJobs );
+            }
+            catch ( std::exception &exc )
+            {
+                addIssue( ArchiveValidationIssue::kHierarchyError, childPath,
+                          "", -1, exc.what() );
+            }
+        }
+    }
+
+    void walkCompound( AbcA::CompoundPropertyReaderPtr iCompound,
+                       const std::string &iObjectPath,
+                       const std::string &iPath, std::vector<Job> &oJobs )
+    {
+        size_t numProps = iCompound->getNumProperties();
+        for ( size_t i = 0; i < numProps; ++i )
+        {
+            const AbcA::PropertyHeader &header =
+                iCompound->getPropertyHeader( i );
+            std::string path = ChildPath( iPath, header.getName() );
+
+            try
+            {
+                if ( header.isCompound() )
+                {
+                    ++m_report->properties;
+                    walkCompound( iCompound->getCompoundProperty(
+                                      header.getName() ),
+                                  iObjectPath, path, oJobs );
+                    continue;
+                }
+
+                Job job;
+                job.objectPath = iObjectPath;
+                job.propertyPath = path;
+                job.parent = iCompound;
+                job.header = header;
+                job.numSamples = header.isArray() ?
+                    iCompound->getArrayProperty(
+                        header.getName() )->getNumSamples() :
+                    iCompound->getScalarProperty(
+                        header.getName() )->getNumSamples();
+                oJobs.push_back( job );
+            }
+            catch ( std::exception &exc )
+            {
+                addIssue( ArchiveValidationIssue::kPropertyError, iObjectPath,
+                          path, -1, exc.what() );
+            }
+        }
+    }
+
+    //! Sleeps as long as needed to keep reads under maxBytesPerSecond.
+    void throttle( uint64_t iBytes )
+    {
+        uint64_t total = m_bytesRead.fetch_add( iBytes ) + iBytes;
+        if ( m_options.maxBytesPerSecond == 0 )
+        {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point due = m_start +
+            std::chrono::microseconds( static_cast<int64_t>(
+                double( total ) * 1e6 /
+                double( m_options.maxBytesPerSecond ) ) );
+        std::this_thread::sleep_until( due );
+    }
+
+    void runJob( const Job &iJob )
+    {
+        const std::string &name = iJob.header.getName();
+        size_t sample = 0;
+
+        try
+        {
+            if ( iJob.header.isArray() )
+            {
+                AbcA::ArrayPropertyReaderPtr reader =
+                    iJob.parent->getArrayProperty( name );
+                for ( ; sample < iJob.numSamples && !m_cancelled; ++sample )
+                {
+                    checkArraySample( iJob, reader, sample );
+                    ++m_samplesDone;
+                }
+            }
+            else
+            {
+                AbcA::ScalarPropertyReaderPtr reader =
+                    iJob.parent->getScalarProperty( name );
+                const AbcA::DataType &dtype = iJob.header.getDataType();
+                PlainOldDataType pod = dtype.getPod();
+
+                std::vector<char> bytes( dtype.getNumBytes() );
+                std::vector<std::string> strs( dtype.getExtent() );
+                std::vector<std::wstring> wstrs( dtype.getExtent() );
+                void *into = pod == kStringPOD ? ( void * ) &strs[0] :
+                    pod == kWstringPOD ? ( void * ) &wstrs[0] :
+                    ( void * ) &bytes[0];
+
+                for ( ; sample < iJob.numSamples && !m_cancelled; ++sample )
+                {
+                    reader->getSample( sample, into );
+                    throttle( bytes.size() );
+                    ++m_samplesDone;
+                }
+            }
+        }
+        catch ( std::exception &exc )
+        {
+            addIssue( ArchiveValidationIssue::kSampleError, iJob.objectPath,
+                      iJob.propertyPath, static_cast<int64_t>( sample ),
+                      exc.what() );
+
+            // the rest of this property counts as done for progress
+            m_samplesDone += iJob.numSamples - sample;
+        }
+    }
+
+    void checkArraySample( const Job &iJob,
+                           AbcA::ArrayPropertyReaderPtr iReader,
+                           size_t iSample )
+    {
+        AbcA::ArraySamplePtr sample;
+        iReader->getSample( iSample, sample );
+
+        const AbcA::DataType &dtype = iJob.header.getDataType();
+        throttle( sample->size() * dtype.getNumBytes() );
+
+        AbcA::Dimensions dims;
+        iReader->getDimensions( iSample, dims );
+        if ( dims.numPoints() != sample->size() )
+        {
+            std::ostringstream msg;
+            msg << "Stored dimensions have " << dims.numPoints()
+                << " points, but the sample has " << sample->size();
+            addIssue( ArchiveValidationIssue::kDimensionMismatch,
+                      iJob.objectPath, iJob.propertyPath,
+                      static_cast<int64_t>( iSample ), msg.str() );
+        }
+
+        AbcA::ArraySampleKey storedKey;
+        if ( m_options.verifyDigests && iReader->getKey( iSample, storedKey ) )
+        {
+            AbcA::ArraySampleKey key = sample->getKey();
+            if ( !( key.digest == storedKey.digest ) ||
+                 key.numBytes != storedKey.numBytes )
+            {
+                addIssue( ArchiveValidationIssue::kDigestMismatch,
+                          iJob.objectPath, iJob.propertyPath,
+                          static_cast<int64_t>( iSample ),
+                          "Sample data doesn't match its stored digest "
+                          + storedKey.digest.str() + ", it hashes to "
+                          + key.digest.str() );
+            }
+        }
+    }
+
+    IArchive m_archive;
+    ArchiveValidationOptions m_options;
+
+    std::atomic<bool> m_cancelled;
+    std::atomic<size_t> m_samplesDone;
+    std::atomic<size_t> m_samplesTotal;
+    std::atomic<uint64_t> m_bytesRead;
+    std::chrono::steady_clock::time_point m_start;
+
+    Util::mutex m_issuesMutex;
+    ArchiveValidationReport *m_report;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace Abc
+} // End namespace Alembic
+
+#endif
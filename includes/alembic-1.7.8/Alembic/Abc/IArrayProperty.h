@@ -43,6 +43,8 @@
 #include <Alembic/Abc/ISampleSelector.h>
 #include <Alembic/Abc/IBaseProperty.h>
 #include <Alembic/Abc/ICompoundProperty.h>
+#include <Alembic/AbcCoreAbstract/ArraySampleAllocator.h>
+#include <Alembic/AbcCoreAbstract/PODConversion.h>
 
 namespace Alembic {
 namespace Abc {
@@ -128,10 +130,95 @@ public:
     void get( AbcA::ArraySamplePtr& oSample,
               const ISampleSelector &iSS = ISampleSelector() ) const;
 
+    //! Get a sample into memory from iAllocator instead of memory owned by
+    //! the archive's sample cache.  The sample is a private copy, made with
+    //! a single allocation from iAllocator.  (This isn't a get() overload,
+    //! since get( sample, 0 ) would then be ambiguous.)
+    void getWithAllocator( AbcA::ArraySamplePtr& oSample,
+                           const AbcA::ArraySampleAllocatorPtr &iAllocator,
+                           const ISampleSelector &iSS = ISampleSelector() ) const
+    {
+        ALEMBIC_ABC_SAFE_CALL_BEGIN( "IArrayProperty::getWithAllocator()" );
+
+        AbcA::index_t index = iSS.getIndex( m_property->getTimeSampling(),
+                                            m_property->getNumSamples() );
+
+        Util::Dimensions dims;
+        m_property->getDimensions( index, dims );
+
+        oSample = AbcA::AllocateArraySample( m_property->getDataType(), dims,
+                                             iAllocator );
+        if ( oSample->getData() )
+        {
+            m_property->getAs( index,
+                               const_cast<void *>( oSample->getData() ),
+                               m_property->getDataType().getPod() );
+        }
+
+        ALEMBIC_ABC_SAFE_CALL_END();
+    }
+
     //! Get a sample into the address of a datum as a particular POD type.
     void getAs( void *oSample, AbcA::PlainOldDataType iPod,
                 const ISampleSelector &iSS = ISampleSelector() );
 
+    //! Like getAs, but converts with the kernels from
+    //! AbcA::GetPODConversionFunc.  The sample is read in its stored POD
+    //! type straight into oSample when iPod matches it, and otherwise into
+    //! ioScratch, which is grown as needed and can be reused across calls.
+    //! oSample must have room for getDimensions().numPoints() * extent values
+    //! of iPod.
+    void getConverted( void *oSample, AbcA::PlainOldDataType iPod,
+                       std::vector<char> &ioScratch,
+                       const ISampleSelector &iSS = ISampleSelector() ) const
+    {
+        ALEMBIC_ABC_SAFE_CALL_BEGIN( "IArrayProperty::getConverted()" );
+
+        AbcA::index_t index = iSS.getIndex( m_property->getTimeSampling(),
+                                            m_property->getNumSamples() );
+
+        const AbcA::DataType &dtype = m_property->getDataType();
+        AbcA::PlainOldDataType pod = dtype.getPod();
+
+        if ( pod == iPod )
+        {
+            m_property->getAs( index, oSample, iPod );
+        }
+        else
+        {
+            ABCA_ASSERT( AbcA::GetPODConversionFunc( pod, iPod ),
+                         "Can't convert from " << PODName( pod ) << " to "
+                         << PODName( iPod ) );
+
+            Util::Dimensions dims;
+            m_property->getDimensions( index, dims );
+            size_t numPODs = dims.numPoints() * dtype.getExtent();
+            size_t numBytes = numPODs * PODNumBytes( pod );
+
+            if ( numBytes > 0 )
+            {
+                if ( ioScratch.size() < numBytes )
+                {
+                    ioScratch.resize( numBytes );
+                }
+
+                m_property->getAs( index, &ioScratch[0], pod );
+                AbcA::ConvertPODArray( &ioScratch[0], pod, oSample, iPod,
+                                       numPODs );
+            }
+        }
+
+        ALEMBIC_ABC_SAFE_CALL_END();
+    }
+
+    //! getConverted with a scratch buffer that only lives for this call.
+    void getConverted( void *oSample, AbcA::PlainOldDataType iPod,
+                       const ISampleSelector &iSS = ISampleSelector() ) const
+    {
+        std::vector<char> scratch;
+        getConverted( oSample, iPod, scratch, iSS );
+    }
+
     //! Get a sample into the address of a datum as the POD type of this
     //! array property.
     void getAs( void *oSample,
@@ -88,7 +88,7 @@ public:
 
         if ( iMatching == kStrictMatching || iMatching == kSchemaTitleMatching )
         {
-            return iMetaData.get( "schema" ) == getSchemaTitle();
+            return iMetaData.matchesValue( "schema", getSchemaTitle() );
         }
 
         return false;
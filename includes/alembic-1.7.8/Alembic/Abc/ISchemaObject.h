@@ -93,13 +93,14 @@ public:
 
         if ( iMatching == kStrictMatching )
         {
-            return iMetaData.get( "schemaObjTitle" ) == getSchemaObjTitle() ||
-                iMetaData.get( "schema" ) == getSchemaObjTitle();
+            return iMetaData.matchesValue( "schemaObjTitle",
+                                           getSchemaObjTitle() ) ||
+                iMetaData.matchesValue( "schema", getSchemaObjTitle() );
         }
 
         if ( iMatching == kSchemaTitleMatching )
         {
-            return iMetaData.get( "schema" ) == getSchemaTitle();
+            return iMetaData.matchesValue( "schema", getSchemaTitle() );
         }
 
         return false;
@@ -74,8 +74,8 @@ public:
     {
         if ( iMatching == kStrictMatching )
         {
-            return ( iMetaData.get( "interpretation" ) ==
-                     getInterpretation() );
+            return iMetaData.matchesValue( "interpretation",
+                                           getInterpretation() );
         }
         return true;
     }
@@ -0,0 +1,816 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_Abc_ReadInstrumentation_h_
+#define _Alembic_Abc_ReadInstrumentation_h_
+
+#include <Alembic/Abc/Foundation.h>
+#include <Alembic/Abc/IArchive.h>
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <thread>
+
+namespace Alembic {
+namespace Abc {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Statistics gathered by an archive wrapped with InstrumentArchive.
+//! Counters are striped across threads, so that reader threads don't fight
+//! over the same cache lines, and are only added up when asked for.
+//! Timing covers the whole call into the backend (I/O and decoding
+//! together), since that is what a wrapper can observe.  arraySamplesRead
+//! and arrayBytesRead only count samples the backend read; samples served
+//! from the archive's sample cache count as arrayCacheHits instead.
+class ReadStats : private Util::noncopyable
+{
+public:
+    enum Counter
+    {
+        kObjectsOpened,
+        kPropertiesOpened,
+        kScalarSamplesRead,
+        kArraySamplesRead,
+        kArrayBytesRead,
+        kArrayCacheHits,
+        kArrayCacheMisses,
+        kKeysRead,
+        kDimensionsRead,
+        kReadNanoseconds,
+        kCacheFinds,
+        kCacheHits,
+        kCacheStores,
+        kNumCounters
+    };
+
+    //! Counts for one property, keyed by "objectFullName:propertyPath".
+    struct PropertyStats
+    {
+        PropertyStats() : samplesRead( 0 ), bytesRead( 0 ), nanoseconds( 0 ) {}
+
+        std::string path;
+        std::atomic<uint64_t> samplesRead;
+        std::atomic<uint64_t> bytesRead;
+        std::atomic<uint64_t> nanoseconds;
+    };
+
+    typedef Util::shared_ptr<PropertyStats> PropertyStatsPtr;
+
+    //! A copy of a PropertyStats that can be stored and sorted.
+    struct PropertySnapshot
+    {
+        std::string path;
+        uint64_t samplesRead;
+        uint64_t bytesRead;
+        uint64_t nanoseconds;
+    };
+
+    //! One sample read, for Chrome traces.
+    struct TraceEvent
+    {
+        const PropertyStats *property;
+        uint32_t thread;
+        uint64_t startNanoseconds;
+        uint64_t durationNanoseconds;
+    };
+
+    enum { kNumStripes = 16 };
+
+    //! When iMaxTraceEvents is above 0, every sample read is also recorded
+    //! as a trace event, until that many have been recorded.
+    explicit ReadStats( size_t iMaxTraceEvents = 0 )
+      : m_maxTraceEvents( iMaxTraceEvents )
+      , m_numTraceEvents( 0 )
+      , m_start( std::chrono::steady_clock::now() ) {}
+
+    void add( Counter iCounter, uint64_t iValue )
+    {
+        m_stripes[GetStripe()].counts[iCounter].fetch_add(
+            iValue, std::memory_order_relaxed );
+    }
+
+    uint64_t get( Counter iCounter ) const
+    {
+        uint64_t ret = 0;
+        for ( size_t i = 0; i < kNumStripes; ++i )
+        {
+            ret += m_stripes[i].counts[iCounter].load(
+                std::memory_order_relaxed );
+        }
+        return ret;
+    }
+
+    static const char *GetCounterName( Counter iCounter )
+    {
+        static const char *names[kNumCounters] =
+        {
+            "objectsOpened", "propertiesOpened", "scalarSamplesRead",
+            "arraySamplesRead", "arrayBytesRead", "arrayCacheHits",
+            "arrayCacheMisses", "keysRead",
+            "dimensionsRead", "readNanoseconds", "cacheFinds", "cacheHits",
+            "cacheStores"
+        };
+        return iCounter < kNumCounters ? names[iCounter] : "";
+    }
+
+    //! Returns the shared counts for the property at iPath, creating them
+    //! the first time.
+    PropertyStatsPtr getPropertyStats( const std::string &iPath )
+    {
+        Util::scoped_lock l( m_propertiesMutex );
+        PropertyStatsPtr &ret = m_properties[iPath];
+        if ( !ret )
+        {
+            ret.reset( new PropertyStats() );
+            ret->path = iPath;
+        }
+        return ret;
+    }
+
+    void getPropertySnapshots( std::vector<PropertySnapshot> &oSnapshots )
+    {
+        Util::scoped_lock l( m_propertiesMutex );
+        oSnapshots.clear();
+        oSnapshots.reserve( m_properties.size() );
+        for ( PropertyMap::const_iterator it = m_properties.begin();
+              it != m_properties.end(); ++it )
+        {
+            PropertySnapshot snap;
+            snap.path = it->first;
+            snap.samplesRead = it->second->samplesRead.load();
+            snap.bytesRead = it->second->bytesRead.load();
+            snap.nanoseconds = it->second->nanoseconds.load();
+            oSnapshots.push_back( snap );
+        }
+    }
+
+    //! Nanoseconds since these stats were created.
+    uint64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start ).count();
+    }
+
+    //! Records a sample read of iProperty that started at iStart (from
+    //! now()) and took iDuration nanoseconds.
+    void recordRead( PropertyStats &iProperty, uint64_t iBytes,
+                     uint64_t iStart, uint64_t iDuration )
+    {
+        iProperty.samplesRead.fetch_add( 1, std::memory_order_relaxed );
+        iProperty.bytesRead.fetch_add( iBytes, std::memory_order_relaxed );
+        iProperty.nanoseconds.fetch_add( iDuration, std::memory_order_relaxed );
+        add( kReadNanoseconds, iDuration );
+
+        if ( m_maxTraceEvents > 0 &&
+             m_numTraceEvents.fetch_add( 1, std::memory_order_relaxed ) <
+             m_maxTraceEvents )
+        {
+            size_t stripe = GetStripe();
+            TraceEvent event;
+            event.property = &iProperty;
+            event.thread = static_cast<uint32_t>( GetThreadHash() );
+            event.startNanoseconds = iStart;
+            event.durationNanoseconds = iDuration;
+
+            Util::scoped_lock l( m_stripes[stripe].traceMutex );
+            m_stripes[stripe].trace.push_back( event );
+        }
+    }
+
+    //! Writes the counters and the per property counts as JSON.
+    void writeJSON( std::ostream &oStream )
+    {
+        oStream << "{\n  \"counters\": {";
+        for ( size_t i = 0; i < kNumCounters; ++i )
+        {
+            oStream << ( i ? "," : "" ) << "\n    \""
+                    << GetCounterName( Counter( i ) ) << "\": "
+                    << get( Counter( i ) );
+        }
+        oStream << "\n  },\n  \"properties\": [";
+
+        std::vector<PropertySnapshot> props;
+        getPropertySnapshots( props );
+        for ( size_t i = 0; i < props.size(); ++i )
+        {
+            oStream << ( i ? "," : "" ) << "\n    { \"path\": ";
+            WriteJSONString( oStream, props[i].path );
+            oStream << ", \"samplesRead\": " << props[i].samplesRead
+                    << ", \"bytesRead\": " << props[i].bytesRead
+                    << ", \"nanoseconds\": " << props[i].nanoseconds << " }";
+        }
+        oStream << "\n  ]\n}\n";
+    }
+
+    //! Writes the recorded trace events in the Chrome trace event format,
+    //! for chrome://tracing or Perfetto.
+    void writeChromeTrace( std::ostream &oStream )
+    {
+        oStream << "{ \"traceEvents\": [";
+        bool first = true;
+        for ( size_t i = 0; i < kNumStripes; ++i )
+        {
+            Util::scoped_lock l( m_stripes[i].traceMutex );
+            const std::vector<TraceEvent> &trace = m_stripes[i].trace;
+            for ( size_t j = 0; j < trace.size(); ++j )
+            {
+                oStream << ( first ? "" : "," ) << "\n  { \"name\": ";
+                WriteJSONString( oStream, trace[j].property->path );
+                oStream << ", \"cat\": \"read\", \"ph\": \"X\", \"pid\": 1"
+                        << ", \"tid\": " << trace[j].thread
+                        << ", \"ts\": " << trace[j].startNanoseconds / 1000.0
+                        << ", \"dur\": "
+                        << trace[j].durationNanoseconds / 1000.0 << " }";
+                first = false;
+            }
+        }
+        oStream << "\n] }\n";
+    }
+
+    //! Zeroes every count and drops the recorded trace.
+    void reset()
+    {
+        for ( size_t i = 0; i < kNumStripes; ++i )
+        {
+            for ( size_t j = 0; j < kNumCounters; ++j )
+            {
+                m_stripes[i].counts[j].store( 0 );
+            }
+            Util::scoped_lock l( m_stripes[i].traceMutex );
+            m_stripes[i].trace.clear();
+        }
+        m_numTraceEvents.store( 0 );
+
+        Util::scoped_lock l( m_propertiesMutex );
+        for ( PropertyMap::iterator it = m_properties.begin();
+              it != m_properties.end(); ++it )
+        {
+            it->second->samplesRead.store( 0 );
+            it->second->bytesRead.store( 0 );
+            it->second->nanoseconds.store( 0 );
+        }
+    }
+
+private:
+    // padded so that counters of different stripes don't share a cache
+    // line; alignas would need C++17 aligned new to be honored on the heap
+    struct Stripe
+    {
+        Stripe()
+        {
+            for ( size_t i = 0; i < kNumCounters; ++i ) { counts[i] = 0; }
+        }
+
+        char pad[64];
+        std::atomic<uint64_t> counts[kNumCounters];
+        Util::mutex traceMutex;
+        std::vector<TraceEvent> trace;
+    };
+
+    typedef std::map<std::string, PropertyStatsPtr> PropertyMap;
+
+    static size_t GetThreadHash()
+    {
+        return std::hash<std::thread::id>()( std::this_thread::get_id() );
+    }
+
+    static size_t GetStripe() { return GetThreadHash() % kNumStripes; }
+
+    static void WriteJSONString( std::ostream &oStream,
+                                 const std::string &iStr )
+    {
+        static const char hex[] = "0123456789abcdef";
+        oStream << '"';
+        for ( size_t i = 0; i < iStr.size(); ++i )
+        {
+            unsigned char c = static_cast<unsigned char>( iStr[i] );
+            if ( c == '"' || c == '\\' ) { oStream << '\\' << c; }
+            else if ( c < 0x20 )
+            {
+                oStream << "\\u00" << hex[c >> 4] << hex[c & 15];
+            }
+            else { oStream << c; }
+        }
+        oStream << '"';
+    }
+
+    Stripe m_stripes[kNumStripes];
+
+    size_t m_maxTraceEvents;
+    std::atomic<size_t> m_numTraceEvents;
+    std::chrono::steady_clock::time_point m_start;
+
+    Util::mutex m_propertiesMutex;
+    PropertyMap m_properties;
+};
+
+typedef Util::shared_ptr<ReadStats> ReadStatsPtr;
+
+//-*****************************************************************************
+// The wrappers.  Each forwards to the reader it wraps, and wraps whatever it
+// hands out, so that everything reached from an instrumented archive is
+// instrumented too.
+namespace ReadInstrumentationDetail {
+
+class ArchiveWrapper;
+typedef Util::shared_ptr<ArchiveWrapper> ArchiveWrapperPtr;
+
+//-*****************************************************************************
+class SampleCacheWrapper : public AbcA::ReadArraySampleCache
+{
+public:
+    SampleCacheWrapper( AbcA::ReadArraySampleCachePtr iCache,
+                        ReadStatsPtr iStats )
+      : m_cache( iCache ), m_stats( iStats ) {}
+
+    virtual AbcA::ReadArraySampleID find( const AbcA::ArraySample::Key &iKey )
+    {
+        AbcA::ReadArraySampleID ret = m_cache->find( iKey );
+        m_stats->add( ReadStats::kCacheFinds, 1 );
+        if ( ret.valid() ) { m_stats->add( ReadStats::kCacheHits, 1 ); }
+        return ret;
+    }
+
+    virtual AbcA::ReadArraySampleID store( const AbcA::ArraySample::Key &iKey,
+                                           AbcA::ArraySamplePtr iSamp )
+    {
+        m_stats->add( ReadStats::kCacheStores, 1 );
+        return m_cache->store( iKey, iSamp );
+    }
+
+    AbcA::ReadArraySampleCachePtr getWrapped() const { return m_cache; }
+
+private:
+    AbcA::ReadArraySampleCachePtr m_cache;
+    ReadStatsPtr m_stats;
+};
+
+//-*****************************************************************************
+class ObjectWrapper;
+typedef Util::shared_ptr<ObjectWrapper> ObjectWrapperPtr;
+
+class CompoundWrapper;
+typedef Util::shared_ptr<CompoundWrapper> CompoundWrapperPtr;
+
+//-*****************************************************************************
+//! What every property wrapper knows: the wrapped archive's stats, its
+//! object, its parent compound and its path within the object.
+struct PropertyContext
+{
+    ReadStatsPtr stats;
+    AbcA::ObjectReaderPtr object;
+    AbcA::CompoundPropertyReaderPtr parent;
+    std::string path;
+};
+
+inline std::string ChildPath( const std::string &iParentPath,
+                              const std::string &iName )
+{
+    return iParentPath.empty() ? iName : iParentPath + "/" + iName;
+}
+
+//-*****************************************************************************
+class ScalarWrapper
+    : public AbcA::ScalarPropertyReader
+    , public Util::enable_shared_from_this<ScalarWrapper>
+{
+public:
+    ScalarWrapper( AbcA::ScalarPropertyReaderPtr iReader,
+                   const PropertyContext &iContext )
+      : m_reader( iReader ), m_context( iContext )
+      , m_propStats( iContext.stats->getPropertyStats(
+            iContext.object->getFullName() + ":" + iContext.path ) ) {}
+
+    virtual const AbcA::PropertyHeader &getHeader() const
+    { return m_reader->getHeader(); }
+    virtual AbcA::ObjectReaderPtr getObject() { return m_context.object; }
+    virtual AbcA::CompoundPropertyReaderPtr getParent()
+    { return m_context.parent; }
+    virtual AbcA::ScalarPropertyReaderPtr asScalarPtr()
+    { return shared_from_this(); }
+
+    virtual size_t getNumSamples() { return m_reader->getNumSamples(); }
+    virtual bool isConstant() { return m_reader->isConstant(); }
+
+    virtual void getSample( AbcA::index_t iSample, void *iIntoLocation )
+    {
+        uint64_t start = m_context.stats->now();
+        m_reader->getSample( iSample, iIntoLocation );
+        uint64_t end = m_context.stats->now();
+
+        const AbcA::DataType &dtype = m_reader->getHeader().getDataType();
+        m_context.stats->add( ReadStats::kScalarSamplesRead, 1 );
+        m_context.stats->recordRead( *m_propStats, dtype.getNumBytes(),
+                                     start, end - start );
+    }
+
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getFloorIndex( AbcA::chrono_t iTime )
+    { return m_reader->getFloorIndex( iTime ); }
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getCeilIndex( AbcA::chrono_t iTime )
+    { return m_reader->getCeilIndex( iTime ); }
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getNearIndex( AbcA::chrono_t iTime )
+    { return m_reader->getNearIndex( iTime ); }
+
+private:
+    AbcA::ScalarPropertyReaderPtr m_reader;
+    PropertyContext m_context;
+    ReadStats::PropertyStatsPtr m_propStats;
+};
+
+//-*****************************************************************************
+class ArrayWrapper
+    : public AbcA::ArrayPropertyReader
+    , public Util::enable_shared_from_this<ArrayWrapper>
+{
+public:
+    ArrayWrapper( AbcA::ArrayPropertyReaderPtr iReader,
+                  const PropertyContext &iContext )
+      : m_reader( iReader ), m_context( iContext )
+      , m_propStats( iContext.stats->getPropertyStats(
+            iContext.object->getFullName() + ":" + iContext.path ) ) {}
+
+    virtual const AbcA::PropertyHeader &getHeader() const
+    { return m_reader->getHeader(); }
+    virtual AbcA::ObjectReaderPtr getObject() { return m_context.object; }
+    virtual AbcA::CompoundPropertyReaderPtr getParent()
+    { return m_context.parent; }
+    virtual AbcA::ArrayPropertyReaderPtr asArrayPtr()
+    { return shared_from_this(); }
+
+    virtual size_t getNumSamples() { return m_reader->getNumSamples(); }
+    virtual bool isConstant() { return m_reader->isConstant(); }
+    virtual bool isScalarLike() { return m_reader->isScalarLike(); }
+
+    //! Reads through the wrapped reader, as an uninstrumented read would.
+    //! If the wrapped archive has a sample cache (the same cache the
+    //! instrumented archive hands out, unwrapped), the sample's key is read
+    //! first and looked up, so that hits and misses can be told apart; a
+    //! hit is returned from the cache, as the wrapped reader would return
+    //! it, and only a miss counts as a sample and bytes read.
+    virtual void getSample( AbcA::index_t iSampleIndex,
+                            AbcA::ArraySamplePtr &oSample )
+    {
+        uint64_t start = m_context.stats->now();
+
+        AbcA::ReadArraySampleCachePtr cache =
+            m_reader->getObject()->getArchive()->getReadArraySampleCachePtr();
+        AbcA::ArraySampleKey key;
+        if ( cache && m_reader->getKey( iSampleIndex, key ) )
+        {
+            AbcA::ReadArraySampleID found = cache->find( key );
+            if ( found )
+            {
+                oSample = found.getSample();
+                m_context.stats->add( ReadStats::kArrayCacheHits, 1 );
+                return;
+            }
+
+            m_context.stats->add( ReadStats::kArrayCacheMisses, 1 );
+        }
+
+        m_reader->getSample( iSampleIndex, oSample );
+
+        uint64_t end = m_context.stats->now();
+
+        uint64_t bytes = oSample ? oSample->size() *
+            oSample->getDataType().getNumBytes() : 0;
+        m_context.stats->add( ReadStats::kArraySamplesRead, 1 );
+        m_context.stats->add( ReadStats::kArrayBytesRead, bytes );
+        m_context.stats->recordRead( *m_propStats, bytes, start, end - start );
+    }
+
+    virtual void getAs( AbcA::index_t iSample, void *iIntoLocation,
+                        AbcA::PlainOldDataType iPod )
+    {
+        uint64_t start = m_context.stats->now();
+        m_reader->getAs( iSample, iIntoLocation, iPod );
+        uint64_t end = m_context.stats->now();
+
+        AbcA::Dimensions dims;
+        m_reader->getDimensions( iSample, dims );
+        uint64_t bytes = dims.numPoints() *
+            m_reader->getHeader().getDataType().getNumBytes();
+        m_context.stats->add( ReadStats::kArraySamplesRead, 1 );
+        m_context.stats->add( ReadStats::kArrayBytesRead, bytes );
+        m_context.stats->recordRead( *m_propStats, bytes, start, end - start );
+    }
+
+    virtual bool getKey( AbcA::index_t iSampleIndex,
+                         AbcA::ArraySampleKey &oKey )
+    {
+        m_context.stats->add( ReadStats::kKeysRead, 1 );
+        return m_reader->getKey( iSampleIndex, oKey );
+    }
+
+    virtual void getDimensions( AbcA::index_t iSampleIndex,
+                                AbcA::Dimensions &oDim )
+    {
+        m_context.stats->add( ReadStats::kDimensionsRead, 1 );
+        m_reader->getDimensions( iSampleIndex, oDim );
+    }
+
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getFloorIndex( AbcA::chrono_t iTime )
+    { return m_reader->getFloorIndex( iTime ); }
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getCeilIndex( AbcA::chrono_t iTime )
+    { return m_reader->getCeilIndex( iTime ); }
+    virtual std::pair<AbcA::index_t, AbcA::chrono_t>
+    getNearIndex( AbcA::chrono_t iTime )
+    { return m_reader->getNearIndex( iTime ); }
+
+private:
+    AbcA::ArrayPropertyReaderPtr m_reader;
+    PropertyContext m_context;
+    ReadStats::PropertyStatsPtr m_propStats;
+};
+
+//-*****************************************************************************
+class CompoundWrapper
+    : public AbcA::CompoundPropertyReader
+    , public Util::enable_shared_from_this<CompoundWrapper>
+{
+public:
+    CompoundWrapper( AbcA::CompoundPropertyReaderPtr iReader,
+                     const PropertyContext &iContext )
+      : m_reader( iReader ), m_context( iContext )
+    {
+        m_context.stats->add( ReadStats::kPropertiesOpened, 1 );
+    }
+
+    virtual const AbcA::PropertyHeader &getHeader() const
+    { return m_reader->getHeader(); }
+    virtual AbcA::ObjectReaderPtr getObject() { return m_context.object; }
+    virtual AbcA::CompoundPropertyReaderPtr getParent()
+    { return m_context.parent; }
+    virtual AbcA::CompoundPropertyReaderPtr asCompoundPtr()
+    { return shared_from_this(); }
+
+    virtual size_t getNumProperties() { return m_reader->getNumProperties(); }
+
+    virtual const AbcA::PropertyHeader &getPropertyHeader( size_t i )
+    { return m_reader->getPropertyHeader( i ); }
+
+    virtual const AbcA::PropertyHeader *
+    getPropertyHeader( const std::string &iName )
+    { return m_reader->getPropertyHeader( iName ); }
+
+    virtual AbcA::ScalarPropertyReaderPtr
+    getScalarProperty( const std::string &iName )
+    {
+        AbcA::ScalarPropertyReaderPtr reader =
+            m_reader->getScalarProperty( iName );
+        if ( !reader ) { return reader; }
+        m_context.stats->add( ReadStats::kPropertiesOpened, 1 );
+        return Util::shared_ptr<ScalarWrapper>(
+            new ScalarWrapper( reader, childContext( iName ) ) );
+    }
+
+    virtual AbcA::ArrayPropertyReaderPtr
+    getArrayProperty( const std::string &iName )
+    {
+        AbcA::ArrayPropertyReaderPtr reader =
+            m_reader->getArrayProperty( iName );
+        if ( !reader ) { return reader; }
+        m_context.stats->add( ReadStats::kPropertiesOpened, 1 );
+        return Util::shared_ptr<ArrayWrapper>(
+            new ArrayWrapper( reader, childContext( iName ) ) );
+    }
+
+    virtual AbcA::CompoundPropertyReaderPtr
+    getCompoundProperty( const std::string &iName )
+    {
+        AbcA::CompoundPropertyReaderPtr reader =
+            m_reader->getCompoundProperty( iName );
+        if ( !reader ) { return reader; }
+        return Util::shared_ptr<CompoundWrapper>(
+            new CompoundWrapper( reader, childContext( iName ) ) );
+    }
+
+private:
+    PropertyContext childContext( const std::string &iName )
+    {
+        PropertyContext ret = m_context;
+        ret.parent = shared_from_this();
+        ret.path = ChildPath( m_context.path, iName );
+        return ret;
+    }
+
+    AbcA::CompoundPropertyReaderPtr m_reader;
+    PropertyContext m_context;
+};
+
+//-*****************************************************************************
+class ObjectWrapper
+    : public AbcA::ObjectReader
+    , public Util::enable_shared_from_this<ObjectWrapper>
+{
+public:
+    ObjectWrapper( AbcA::ObjectReaderPtr iReader,
+                   AbcA::ArchiveReaderPtr iArchive,
+                   AbcA::ObjectReaderPtr iParent,
+                   ReadStatsPtr iStats )
+      : m_reader( iReader ), m_archive( iArchive ), m_parent( iParent )
+      , m_stats( iStats )
+    {
+        m_stats->add( ReadStats::kObjectsOpened, 1 );
+    }
+
+    virtual const AbcA::ObjectHeader &getHeader() const
+    { return m_reader->getHeader(); }
+    virtual AbcA::ArchiveReaderPtr getArchive() { return m_archive; }
+    virtual AbcA::ObjectReaderPtr getParent() { return m_parent; }
+
+    virtual AbcA::CompoundPropertyReaderPtr getProperties()
+    {
+        PropertyContext context;
+        context.stats = m_stats;
+        context.object = shared_from_this();
+        return Util::shared_ptr<CompoundWrapper>(
+            new CompoundWrapper( m_reader->getProperties(), context ) );
+    }
+
+    virtual size_t getNumChildren() { return m_reader->getNumChildren(); }
+
+    virtual const AbcA::ObjectHeader &getChildHeader( size_t i )
+    { return m_reader->getChildHeader( i ); }
+
+    virtual const AbcA::ObjectHeader *
+    getChildHeader( const std::string &iName )
+    { return m_reader->getChildHeader( iName ); }
+
+    virtual AbcA::ObjectReaderPtr getChild( const std::string &iName )
+    { return wrap( m_reader->getChild( iName ) ); }
+
+    virtual AbcA::ObjectReaderPtr getChild( size_t i )
+    { return wrap( m_reader->getChild( i ) ); }
+
+    virtual bool getPropertiesHash( Util::Digest &oDigest )
+    { return m_reader->getPropertiesHash( oDigest ); }
+
+    virtual bool getChildrenHash( Util::Digest &oDigest )
+    { return m_reader->getChildrenHash( oDigest ); }
+
+    virtual AbcA::ObjectReaderPtr asObjectPtr() { return shared_from_this(); }
+
+private:
+    AbcA::ObjectReaderPtr wrap( AbcA::ObjectReaderPtr iChild )
+    {
+        if ( !iChild ) { return iChild; }
+        return Util::shared_ptr<ObjectWrapper>(
+            new ObjectWrapper( iChild, m_archive, shared_from_this(),
+                               m_stats ) );
+    }
+
+    AbcA::ObjectReaderPtr m_reader;
+    AbcA::ArchiveReaderPtr m_archive;
+    AbcA::ObjectReaderPtr m_parent;
+    ReadStatsPtr m_stats;
+};
+
+//-*****************************************************************************
+class ArchiveWrapper
+    : public AbcA::ArchiveReader
+    , public Util::enable_shared_from_this<ArchiveWrapper>
+{
+public:
+    ArchiveWrapper( AbcA::ArchiveReaderPtr iReader, ReadStatsPtr iStats )
+      : m_reader( iReader ), m_stats( iStats )
+    {
+        setReadArraySampleCachePtr( m_reader->getReadArraySampleCachePtr() );
+    }
+
+    virtual const std::string &getName() const { return m_reader->getName(); }
+
+    virtual const AbcA::MetaData &getMetaData() const
+    { return m_reader->getMetaData(); }
+
+    virtual AbcA::ObjectReaderPtr getTop()
+    {
+        return Util::shared_ptr<ObjectWrapper>(
+            new ObjectWrapper( m_reader->getTop(), shared_from_this(),
+                               AbcA::ObjectReaderPtr(), m_stats ) );
+    }
+
+    //! The wrapped archive's cache, wrapped so that finds and stores made
+    //! through this archive count into its stats.  The wrapper is held here
+    //! and never handed to the wrapped archive, whose own lookups go to the
+    //! cache directly; sample reads count those as arrayCacheHits and
+    //! arrayCacheMisses instead.
+    virtual AbcA::ReadArraySampleCachePtr getReadArraySampleCachePtr()
+    { return m_cache; }
+
+    virtual void setReadArraySampleCachePtr( AbcA::ReadArraySampleCachePtr iPtr )
+    {
+        if ( iPtr && iPtr != m_cache )
+        {
+            iPtr.reset( new SampleCacheWrapper( iPtr, m_stats ) );
+        }
+        m_cache = iPtr;
+    }
+
+    virtual AbcA::TimeSamplingPtr getTimeSampling( uint32_t iIndex )
+    { return m_reader->getTimeSampling( iIndex ); }
+
+    virtual AbcA::index_t
+    getMaxNumSamplesForTimeSamplingIndex( uint32_t iIndex )
+    { return m_reader->getMaxNumSamplesForTimeSamplingIndex( iIndex ); }
+
+    virtual uint32_t getNumTimeSamplings()
+    { return m_reader->getNumTimeSamplings(); }
+
+    virtual int32_t getArchiveVersion()
+    { return m_reader->getArchiveVersion(); }
+
+    virtual AbcA::ArchiveReaderPtr asArchivePtr()
+    { return shared_from_this(); }
+
+    ReadStatsPtr getStats() const { return m_stats; }
+
+private:
+    AbcA::ArchiveReaderPtr m_reader;
+    ReadStatsPtr m_stats;
+    AbcA::ReadArraySampleCachePtr m_cache;
+};
+
+} // End namespace ReadInstrumentationDetail
+
+//-*****************************************************************************
+//! Returns an archive that reads through iArchive and records what it does
+//! in iStats.  Objects and properties reached through the returned archive
+//! are instrumented, those reached through iArchive are not, so the
+//! overhead is only paid where it is asked for.
+inline IArchive InstrumentArchive( IArchive iArchive,
+                                   ReadStatsPtr iStats = ReadStatsPtr() )
+{
+    ABCA_ASSERT( iArchive.valid(), "Can't instrument an invalid archive" );
+
+    if ( !iStats )
+    {
+        iStats.reset( new ReadStats() );
+    }
+
+    AbcA::ArchiveReaderPtr wrapped(
+        new ReadInstrumentationDetail::ArchiveWrapper( iArchive.getPtr(),
+                                                       iStats ) );
+    return IArchive( wrapped, kWrapExisting,
+                     iArchive.getErrorHandlerPolicy() );
+}
+
+//-*****************************************************************************
+//! Returns the stats of an archive made by InstrumentArchive, or an empty
+//! pointer for any other archive.
+inline ReadStatsPtr GetReadStats( IArchive iArchive )
+{
+    Util::shared_ptr<ReadInstrumentationDetail::ArchiveWrapper> wrapper =
+        Util::dynamic_pointer_cast<ReadInstrumentationDetail::ArchiveWrapper>(
+            iArchive.getPtr() );
+    return wrapper ? wrapper->getStats() : ReadStatsPtr();
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace Abc
+} // End namespace Alembic
+
+#endif
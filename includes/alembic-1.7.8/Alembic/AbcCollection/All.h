@@ -40,5 +40,6 @@
 #include <Alembic/Util/Export.h>
 #include <Alembic/AbcCollection/ICollections.h>
 #include <Alembic/AbcCollection/OCollections.h>
+#include <Alembic/AbcCollection/CollectionsIndex.h>
 
 #endif
@@ -0,0 +1,409 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcCollection_CollectionsIndex_h_
+#define _Alembic_AbcCollection_CollectionsIndex_h_
+
+#include <Alembic/AbcCollection/ICollections.h>
+
+#include <algorithm>
+
+namespace Alembic {
+namespace AbcCollection {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Answers membership questions about the collections of an
+//! ICollectionsSchema without rescanning the string arrays.
+//!
+//! Every distinct path in any collection gets a path id.  Ids follow the
+//! sorted order of the paths, so the paths under an object form one
+//! contiguous range of ids.  Each collection stores its members either as
+//! a bitset over the ids (when dense) or as a sorted id vector (when
+//! sparse).  A reverse table lists the collections containing each path.
+//!
+//! Trailing slashes are stripped from paths, both when indexing and when
+//! querying.  The index never changes once built, so it can be queried
+//! from multiple threads.
+class CollectionsIndex
+{
+public:
+    enum { kInvalidPathId = 0xffffffffU };
+
+    CollectionsIndex() {}
+
+    //! Indexes the collections of iSchema at iSS.
+    explicit CollectionsIndex( ICollectionsSchema iSchema,
+        const Abc::ISampleSelector &iSS = Abc::ISampleSelector() )
+    {
+        size_t numCollections = iSchema.getNumCollections();
+        std::vector<std::string> names( numCollections );
+        std::vector<Abc::StringArraySamplePtr> samples( numCollections );
+        std::vector<PathArray> paths( numCollections );
+
+        for ( size_t i = 0; i < numCollections; ++i )
+        {
+            names[i] = iSchema.getCollectionName( i );
+            Abc::IStringArrayProperty prop = iSchema.getCollection( i );
+            if ( prop.valid() )
+            {
+                samples[i] = prop.getValue( iSS );
+            }
+            if ( samples[i] && samples[i]->size() > 0 )
+            {
+                paths[i] = PathArray( samples[i]->get(), samples[i]->size() );
+            }
+        }
+
+        init( names, paths );
+    }
+
+    //! Indexes collections given as names and lists of paths, such as the
+    //! values that were written with OCollectionsSchema::createCollection.
+    CollectionsIndex( const std::vector<std::string> &iNames,
+                      const std::vector< std::vector<std::string> > &iPaths )
+    {
+        ABCA_ASSERT( iNames.size() == iPaths.size(),
+                     "Collection names and paths don't match." );
+
+        std::vector<PathArray> paths( iPaths.size() );
+        for ( size_t i = 0; i < iPaths.size(); ++i )
+        {
+            if ( !iPaths[i].empty() )
+            {
+                paths[i] = PathArray( &iPaths[i][0], iPaths[i].size() );
+            }
+        }
+
+        init( iNames, paths );
+    }
+
+    size_t getNumCollections() const { return m_collections.size(); }
+
+    const std::string &getCollectionName( size_t iCollection ) const
+    { return m_collections[iCollection].name; }
+
+    //! Returns the index of the collection called iName, or -1.
+    int getCollectionIndex( const std::string &iName ) const
+    {
+        for ( size_t i = 0; i < m_collections.size(); ++i )
+        {
+            if ( m_collections[i].name == iName )
+            {
+                return static_cast<int>( i );
+            }
+        }
+        return -1;
+    }
+
+    size_t getNumPaths() const { return m_paths.size(); }
+
+    const std::string &getPath( uint32_t iPathId ) const
+    { return m_paths[iPathId]; }
+
+    //! Returns the id of iPath, or kInvalidPathId if no collection has it.
+    uint32_t getPathId( const std::string &iPath ) const
+    {
+        PathIdMap::const_iterator it = m_pathIds.find( Normalize( iPath ) );
+        return it == m_pathIds.end() ?
+            static_cast<uint32_t>( kInvalidPathId ) : it->second;
+    }
+
+    //! Whether collection iCollection lists iPathId.
+    bool contains( size_t iCollection, uint32_t iPathId ) const
+    {
+        const Collection &coll = m_collections[iCollection];
+        if ( iPathId >= m_paths.size() )
+        {
+            return false;
+        }
+        if ( !coll.bits.empty() )
+        {
+            return ( coll.bits[iPathId >> 6] >> ( iPathId & 63 ) ) & 1;
+        }
+        return std::binary_search( coll.ids.begin(), coll.ids.end(), iPathId );
+    }
+
+    //! Whether collection iCollection lists iPath.
+    bool contains( size_t iCollection, const std::string &iPath ) const
+    {
+        return contains( iCollection, getPathId( iPath ) );
+    }
+
+    //! The collections that list iPathId, in ascending order.  The returned
+    //! range is [first, first + count).
+    const uint32_t *getCollections( uint32_t iPathId, size_t &oCount ) const
+    {
+        if ( iPathId >= m_paths.size() )
+        {
+            oCount = 0;
+            return NULL;
+        }
+        oCount = m_reverseOffsets[iPathId + 1] - m_reverseOffsets[iPathId];
+        return oCount ? &m_reverse[m_reverseOffsets[iPathId]] : NULL;
+    }
+
+    //! Fills oCollections with the collections that list iPath.
+    void getCollectionsContaining( const std::string &iPath,
+                                   std::vector<uint32_t> &oCollections ) const
+    {
+        size_t count = 0;
+        const uint32_t *colls = getCollections( getPathId( iPath ), count );
+        oCollections.assign( colls, colls + count );
+    }
+
+    //! Fills oCollections with the collections that list iPath or any of
+    //! its ancestors, which is the usual rule for light linking and
+    //! render layers.
+    void getCollectionsContainingOrAncestors(
+        const std::string &iPath, std::vector<uint32_t> &oCollections ) const
+    {
+        std::vector<char> seen( m_collections.size(), 0 );
+        std::string path = Normalize( iPath );
+
+        while ( !path.empty() )
+        {
+            size_t count = 0;
+            const uint32_t *colls = getCollections( getPathId( path ), count );
+            for ( size_t i = 0; i < count; ++i )
+            {
+                seen[colls[i]] = 1;
+            }
+
+            size_t slash = path.rfind( '/' );
+            if ( slash == std::string::npos || path == "/" )
+            {
+                break;
+            }
+            path.resize( slash > 0 ? slash : 1 );
+        }
+
+        gather( seen, oCollections );
+    }
+
+    //! Returns the range [oBegin, oEnd) of ids of the paths under iPath.
+    //! iPath itself isn't part of the range, since unrelated paths such as
+    //! "/a b" can sort between "/a" and "/a/x"; use getPathId for it.
+    void getSubtreeRange( const std::string &iPath,
+                          uint32_t &oBegin, uint32_t &oEnd ) const
+    {
+        std::string path = Normalize( iPath );
+
+        // everything under "/a" sorts between "/a/" and "/a0", '0' being the
+        // character after '/'
+        std::string lo = path == "/" ? path : path + "/";
+        std::string hi = lo;
+        hi[hi.size() - 1] = '/' + 1;
+
+        std::vector<std::string>::const_iterator begin =
+            std::lower_bound( m_paths.begin(), m_paths.end(), lo );
+
+        // "/" is its own lower bound, so step over it
+        if ( begin != m_paths.end() && *begin == path )
+        {
+            ++begin;
+        }
+
+        std::vector<std::string>::const_iterator end =
+            std::lower_bound( begin, m_paths.end(), hi );
+
+        oBegin = static_cast<uint32_t>( begin - m_paths.begin() );
+        oEnd = static_cast<uint32_t>( end - m_paths.begin() );
+    }
+
+    //! Fills oCollections with the collections that list iPath or anything
+    //! under it.
+    void getCollectionsContainingSubtree(
+        const std::string &iPath, std::vector<uint32_t> &oCollections ) const
+    {
+        std::vector<char> seen( m_collections.size(), 0 );
+
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        getSubtreeRange( iPath, begin, end );
+
+        for ( uint32_t id = begin; id < end; ++id )
+        {
+            size_t count = 0;
+            const uint32_t *colls = getCollections( id, count );
+            for ( size_t i = 0; i < count; ++i )
+            {
+                seen[colls[i]] = 1;
+            }
+        }
+
+        size_t count = 0;
+        const uint32_t *colls = getCollections( getPathId( iPath ), count );
+        for ( size_t i = 0; i < count; ++i )
+        {
+            seen[colls[i]] = 1;
+        }
+
+        gather( seen, oCollections );
+    }
+
+private:
+    typedef std::pair<const std::string *, size_t> PathArray;
+    typedef Util::unordered_map<std::string, uint32_t> PathIdMap;
+
+    struct Collection
+    {
+        std::string name;
+
+        //! Exactly one of these is used, depending on density.
+        std::vector<uint64_t> bits;
+        std::vector<uint32_t> ids;
+    };
+
+    static std::string Normalize( const std::string &iPath )
+    {
+        size_t end = iPath.size();
+        while ( end > 1 && iPath[end - 1] == '/' )
+        {
+            --end;
+        }
+        return iPath.substr( 0, end );
+    }
+
+    static void gather( const std::vector<char> &iSeen,
+                        std::vector<uint32_t> &oCollections )
+    {
+        oCollections.clear();
+        for ( size_t i = 0; i < iSeen.size(); ++i )
+        {
+            if ( iSeen[i] )
+            {
+                oCollections.push_back( static_cast<uint32_t>( i ) );
+            }
+        }
+    }
+
+    void init( const std::vector<std::string> &iNames,
+               const std::vector<PathArray> &iPaths )
+    {
+        // assign ids in sorted path order
+        for ( size_t i = 0; i < iPaths.size(); ++i )
+        {
+            for ( size_t j = 0; j < iPaths[i].second; ++j )
+            {
+                m_paths.push_back( Normalize( iPaths[i].first[j] ) );
+            }
+        }
+        std::sort( m_paths.begin(), m_paths.end() );
+        m_paths.erase( std::unique( m_paths.begin(), m_paths.end() ),
+                       m_paths.end() );
+
+        m_pathIds.reserve( m_paths.size() );
+        for ( size_t i = 0; i < m_paths.size(); ++i )
+        {
+            m_pathIds[m_paths[i]] = static_cast<uint32_t>( i );
+        }
+
+        std::vector<uint32_t> counts( m_paths.size() + 1, 0 );
+        m_collections.resize( iNames.size() );
+        for ( size_t i = 0; i < iNames.size(); ++i )
+        {
+            Collection &coll = m_collections[i];
+            coll.name = iNames[i];
+
+            std::vector<uint32_t> &ids = coll.ids;
+            ids.reserve( iPaths[i].second );
+            for ( size_t j = 0; j < iPaths[i].second; ++j )
+            {
+                ids.push_back( m_pathIds[Normalize( iPaths[i].first[j] )] );
+            }
+            std::sort( ids.begin(), ids.end() );
+            ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+
+            for ( size_t j = 0; j < ids.size(); ++j )
+            {
+                ++counts[ids[j]];
+            }
+
+            // a bitset costs one bit per path, a vector 32 bits per member
+            if ( ids.size() * 32 > m_paths.size() )
+            {
+                coll.bits.assign( ( m_paths.size() + 63 ) / 64, 0 );
+                for ( size_t j = 0; j < ids.size(); ++j )
+                {
+                    coll.bits[ids[j] >> 6] |= uint64_t( 1 ) << ( ids[j] & 63 );
+                }
+            }
+        }
+
+        // the reverse table, in compressed rows, filled in collection order
+        // so each row is sorted
+        m_reverseOffsets.assign( m_paths.size() + 1, 0 );
+        for ( size_t i = 0; i < m_paths.size(); ++i )
+        {
+            m_reverseOffsets[i + 1] = m_reverseOffsets[i] + counts[i];
+        }
+        m_reverse.resize( m_reverseOffsets.back() );
+        std::vector<uint32_t> cursor( m_reverseOffsets.begin(),
+                                      m_reverseOffsets.end() - 1 );
+        for ( size_t i = 0; i < m_collections.size(); ++i )
+        {
+            const std::vector<uint32_t> &ids = m_collections[i].ids;
+            for ( size_t j = 0; j < ids.size(); ++j )
+            {
+                m_reverse[cursor[ids[j]]++] = static_cast<uint32_t>( i );
+            }
+        }
+
+        for ( size_t i = 0; i < m_collections.size(); ++i )
+        {
+            if ( !m_collections[i].bits.empty() )
+            {
+                std::vector<uint32_t>().swap( m_collections[i].ids );
+            }
+        }
+    }
+
+    std::vector<std::string> m_paths;
+    PathIdMap m_pathIds;
+    std::vector<Collection> m_collections;
+    std::vector<uint32_t> m_reverseOffsets;
+    std::vector<uint32_t> m_reverse;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcCollection
+} // End namespace Alembic
+
+#endif
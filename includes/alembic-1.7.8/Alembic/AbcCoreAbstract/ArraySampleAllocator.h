@@ -0,0 +1,534 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcCoreAbstract_ArraySampleAllocator_h_
+#define _Alembic_AbcCoreAbstract_ArraySampleAllocator_h_
+
+#include <Alembic/AbcCoreAbstract/Foundation.h>
+#include <Alembic/AbcCoreAbstract/ArraySample.h>
+
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace Alembic {
+namespace AbcCoreAbstract {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Supplies the memory for array samples read with an allocator (see
+//! AllocateArraySample below and IArrayProperty::get).  Implementations
+//! must be safe to call from multiple threads, and must return memory
+//! aligned for any POD type, which is what ::operator new guarantees.
+class ArraySampleAllocator : private Alembic::Util::noncopyable
+{
+public:
+    //! Running totals, for measuring how much work an allocator saves.
+    struct Stats
+    {
+        Stats() : allocations( 0 ), systemAllocations( 0 ),
+                  bytesInUse( 0 ), bytesReserved( 0 ) {}
+
+        //! Blocks handed out.
+        uint64_t allocations;
+
+        //! Blocks that could not be served from memory already held and
+        //! went to the system allocator.
+        uint64_t systemAllocations;
+
+        //! Bytes in blocks that have been handed out and not returned.
+        uint64_t bytesInUse;
+
+        //! Bytes held by the allocator, in use or not.
+        uint64_t bytesReserved;
+    };
+
+    virtual ~ArraySampleAllocator() {}
+
+    virtual void *allocate( size_t iBytes ) = 0;
+
+    //! iBytes is the size that was passed to allocate.
+    virtual void deallocate( void *iMemory, size_t iBytes ) = 0;
+
+    virtual Stats getStats() const = 0;
+};
+
+typedef Alembic::Util::shared_ptr<ArraySampleAllocator> ArraySampleAllocatorPtr;
+
+//-*****************************************************************************
+//! Keeps freed blocks in power of two size classes, and hands them back out
+//! instead of going to the system allocator again.  Reading the same
+//! properties frame after frame asks for the same sizes, so after the first
+//! frame nearly every sample is served from the pools.
+//!
+//! The pools are split into shards picked by the calling thread, so reader
+//! threads rarely wait on each other.  A block freed on another thread goes
+//! to that thread's shard.  Blocks over iMaxPooledBytes, and blocks freed
+//! once a shard already holds iMaxCachedBytesPerShard of free memory, go
+//! straight back to the system.
+class PooledArraySampleAllocator : public ArraySampleAllocator
+{
+public:
+    enum
+    {
+        kMinClassShift = 6,
+        kNumShards = 16
+    };
+
+    explicit PooledArraySampleAllocator(
+        size_t iMaxPooledBytes = size_t( 1 ) << 26,
+        size_t iMaxCachedBytesPerShard = size_t( 1 ) << 28 )
+      : m_numClasses( 1 )
+      , m_maxCachedBytes( iMaxCachedBytesPerShard )
+    {
+        while ( ClassBytes( m_numClasses - 1 ) < iMaxPooledBytes )
+        {
+            ++m_numClasses;
+        }
+
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            m_shards[i].freeLists.resize( m_numClasses );
+        }
+    }
+
+    ~PooledArraySampleAllocator()
+    {
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            Shard &shard = m_shards[i];
+            for ( size_t c = 0; c < shard.freeLists.size(); ++c )
+            {
+                for ( size_t j = 0; j < shard.freeLists[c].size(); ++j )
+                {
+                    ::operator delete( shard.freeLists[c][j] );
+                }
+            }
+        }
+    }
+
+    virtual void *allocate( size_t iBytes )
+    {
+        size_t sizeClass = GetClass( iBytes );
+        Shard &shard = m_shards[GetShardIndex()];
+
+        if ( sizeClass < m_numClasses )
+        {
+            Alembic::Util::scoped_lock l( shard.mutex );
+            std::vector<void *> &freeList = shard.freeLists[sizeClass];
+            ++shard.stats.allocations;
+            shard.stats.bytesInUse += ClassBytes( sizeClass );
+            if ( !freeList.empty() )
+            {
+                void *ret = freeList.back();
+                freeList.pop_back();
+                shard.cachedBytes -= ClassBytes( sizeClass );
+                return ret;
+            }
+        }
+
+        size_t bytes = sizeClass < m_numClasses ?
+            ClassBytes( sizeClass ) : iBytes;
+        void *ret = ::operator new( bytes );
+
+        Alembic::Util::scoped_lock l( shard.mutex );
+        if ( sizeClass >= m_numClasses )
+        {
+            ++shard.stats.allocations;
+            shard.stats.bytesInUse += bytes;
+        }
+        ++shard.stats.systemAllocations;
+        shard.stats.bytesReserved += bytes;
+        return ret;
+    }
+
+    virtual void deallocate( void *iMemory, size_t iBytes )
+    {
+        if ( !iMemory )
+        {
+            return;
+        }
+
+        size_t sizeClass = GetClass( iBytes );
+        size_t bytes = sizeClass < m_numClasses ?
+            ClassBytes( sizeClass ) : iBytes;
+        Shard &shard = m_shards[GetShardIndex()];
+
+        {
+            Alembic::Util::scoped_lock l( shard.mutex );
+            shard.stats.bytesInUse -= bytes;
+            if ( sizeClass < m_numClasses &&
+                 shard.cachedBytes + bytes <= m_maxCachedBytes )
+            {
+                shard.freeLists[sizeClass].push_back( iMemory );
+                shard.cachedBytes += bytes;
+                return;
+            }
+            shard.stats.bytesReserved -= bytes;
+        }
+
+        ::operator delete( iMemory );
+    }
+
+    //! Per shard counts can wrap when blocks move between threads, but the
+    //! totals are exact.
+    virtual Stats getStats() const
+    {
+        Stats ret;
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            const Shard &shard = m_shards[i];
+            Alembic::Util::scoped_lock l( shard.mutex );
+            ret.allocations += shard.stats.allocations;
+            ret.systemAllocations += shard.stats.systemAllocations;
+            ret.bytesInUse += shard.stats.bytesInUse;
+            ret.bytesReserved += shard.stats.bytesReserved;
+        }
+        return ret;
+    }
+
+    //! Returns all free blocks to the system.
+    void trim()
+    {
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            Shard &shard = m_shards[i];
+            Alembic::Util::scoped_lock l( shard.mutex );
+            for ( size_t c = 0; c < shard.freeLists.size(); ++c )
+            {
+                std::vector<void *> &freeList = shard.freeLists[c];
+                for ( size_t j = 0; j < freeList.size(); ++j )
+                {
+                    ::operator delete( freeList[j] );
+                }
+                shard.stats.bytesReserved -= freeList.size() * ClassBytes( c );
+                freeList.clear();
+            }
+            shard.cachedBytes = 0;
+        }
+    }
+
+private:
+    struct Shard
+    {
+        Shard() : cachedBytes( 0 ) {}
+
+        mutable Alembic::Util::mutex mutex;
+        std::vector< std::vector<void *> > freeLists;
+        size_t cachedBytes;
+        Stats stats;
+    };
+
+    static size_t ClassBytes( size_t iClass )
+    {
+        return size_t( 1 ) << ( iClass + kMinClassShift );
+    }
+
+    static size_t GetClass( size_t iBytes )
+    {
+        size_t ret = 0;
+        while ( ClassBytes( ret ) < iBytes )
+        {
+            ++ret;
+        }
+        return ret;
+    }
+
+    static size_t GetShardIndex()
+    {
+        return std::hash<std::thread::id>()( std::this_thread::get_id() ) %
+            kNumShards;
+    }
+
+    size_t m_numClasses;
+    size_t m_maxCachedBytes;
+    Shard m_shards[kNumShards];
+};
+
+//-*****************************************************************************
+//! Hands out memory by bumping a pointer through large chunks, for samples
+//! that all die together, such as everything read for one frame.  Freeing a
+//! block does not make its memory reusable; once every sample from the
+//! arena has been released, reset() rewinds the arena and the chunks are
+//! reused for the next frame.
+class ArenaArraySampleAllocator : public ArraySampleAllocator
+{
+public:
+    explicit ArenaArraySampleAllocator( size_t iChunkBytes = size_t( 1 ) << 22 )
+      : m_chunkBytes( iChunkBytes )
+      , m_currentChunk( 0 )
+      , m_currentOffset( 0 ) {}
+
+    ~ArenaArraySampleAllocator()
+    {
+        for ( size_t i = 0; i < m_chunks.size(); ++i )
+        {
+            ::operator delete( m_chunks[i].memory );
+        }
+    }
+
+    virtual void *allocate( size_t iBytes )
+    {
+        size_t bytes = Align( iBytes );
+
+        Alembic::Util::scoped_lock l( m_mutex );
+        ++m_stats.allocations;
+        m_stats.bytesInUse += bytes;
+
+        // find room in the current chunk, or a later one left over from
+        // before the last reset
+        while ( m_currentChunk < m_chunks.size() )
+        {
+            Chunk &chunk = m_chunks[m_currentChunk];
+            if ( m_currentOffset + bytes <= chunk.bytes )
+            {
+                void *ret = chunk.memory + m_currentOffset;
+                m_currentOffset += bytes;
+                return ret;
+            }
+            ++m_currentChunk;
+            m_currentOffset = 0;
+        }
+
+        Chunk chunk;
+        chunk.bytes = std::max( bytes, m_chunkBytes );
+        chunk.memory = static_cast<char *>( ::operator new( chunk.bytes ) );
+        m_chunks.push_back( chunk );
+        m_currentChunk = m_chunks.size() - 1;
+        m_currentOffset = bytes;
+        ++m_stats.systemAllocations;
+        m_stats.bytesReserved += chunk.bytes;
+        return chunk.memory;
+    }
+
+    virtual void deallocate( void *iMemory, size_t iBytes )
+    {
+        if ( iMemory )
+        {
+            Alembic::Util::scoped_lock l( m_mutex );
+            m_stats.bytesInUse -= Align( iBytes );
+        }
+    }
+
+    virtual Stats getStats() const
+    {
+        Alembic::Util::scoped_lock l( m_mutex );
+        return m_stats;
+    }
+
+    //! Makes all of the arena's memory available again.  Throws if any
+    //! sample allocated from it is still alive.
+    void reset()
+    {
+        Alembic::Util::scoped_lock l( m_mutex );
+        ABCA_ASSERT( m_stats.bytesInUse == 0,
+                     "Can't reset an arena that still has "
+                     << m_stats.bytesInUse << " bytes in use." );
+        m_currentChunk = 0;
+        m_currentOffset = 0;
+    }
+
+private:
+    struct Chunk
+    {
+        char *memory;
+        size_t bytes;
+    };
+
+    static size_t Align( size_t iBytes )
+    {
+        return ( iBytes + 15 ) & ~size_t( 15 );
+    }
+
+    size_t m_chunkBytes;
+    mutable Alembic::Util::mutex m_mutex;
+    std::vector<Chunk> m_chunks;
+    size_t m_currentChunk;
+    size_t m_currentOffset;
+    Stats m_stats;
+};
+
+//-*****************************************************************************
+// HELPER STUFF!
+namespace ArraySampleAllocatorDetail {
+
+//-*****************************************************************************
+// The ArraySample and its data, which share one block with the shared_ptr
+// control block.  Only the string PODs need constructing and destroying.
+struct FusedArraySample
+{
+    FusedArraySample() {}
+
+    ~FusedArraySample()
+    {
+        size_t numPODs = sample.size() * sample.getDataType().getExtent();
+        void *data = const_cast<void *>( sample.getData() );
+        if ( !data )
+        {
+            return;
+        }
+
+        if ( sample.getDataType().getPod() == kStringPOD )
+        {
+            std::string *strs = static_cast<std::string *>( data );
+            for ( size_t i = 0; i < numPODs; ++i )
+            {
+                strs[i].~basic_string();
+            }
+        }
+        else if ( sample.getDataType().getPod() == kWstringPOD )
+        {
+            std::wstring *strs = static_cast<std::wstring *>( data );
+            for ( size_t i = 0; i < numPODs; ++i )
+            {
+                strs[i].~basic_string();
+            }
+        }
+    }
+
+    ArraySample sample;
+};
+
+//-*****************************************************************************
+// Used with allocate_shared, allocates iDataBytes past whatever the shared_ptr
+// implementation asks for, and reports where those bytes start.  The copy
+// the control block keeps holds on to the ArraySampleAllocator, so it lives
+// until the block has been given back.
+template <class T>
+struct FusedAllocator
+{
+    typedef T value_type;
+
+    FusedAllocator( const ArraySampleAllocatorPtr &iAllocator,
+                    size_t iDataBytes,
+                    void **oData )
+      : allocator( iAllocator ), dataBytes( iDataBytes ), data( oData ) {}
+
+    template <class U>
+    FusedAllocator( const FusedAllocator<U> &iCopy )
+      : allocator( iCopy.allocator ), dataBytes( iCopy.dataBytes )
+      , data( iCopy.data ) {}
+
+    static size_t HeaderBytes( size_t n )
+    {
+        return ( n * sizeof( T ) + 15 ) & ~size_t( 15 );
+    }
+
+    T *allocate( size_t n )
+    {
+        char *block = static_cast<char *>(
+            allocator->allocate( HeaderBytes( n ) + dataBytes ) );
+        if ( data )
+        {
+            *data = dataBytes ? block + HeaderBytes( n ) : NULL;
+        }
+        return reinterpret_cast<T *>( block );
+    }
+
+    void deallocate( T *p, size_t n )
+    {
+        allocator->deallocate( p, HeaderBytes( n ) + dataBytes );
+    }
+
+    template <class U>
+    bool operator==( const FusedAllocator<U> &iOther ) const
+    { return allocator == iOther.allocator && dataBytes == iOther.dataBytes; }
+
+    template <class U>
+    bool operator!=( const FusedAllocator<U> &iOther ) const
+    { return !( *this == iOther ); }
+
+    ArraySampleAllocatorPtr allocator;
+    size_t dataBytes;
+    void **data;
+};
+
+} // End namespace ArraySampleAllocatorDetail
+
+//-*****************************************************************************
+//! Like AllocateArraySample, but the ArraySample, its data and the
+//! shared_ptr bookkeeping all come from a single block of iAllocator.  The
+//! allocator is kept alive until the returned sample is released.  The data
+//! is left uninitialized, except for strings, which are constructed empty.
+inline ArraySamplePtr
+AllocateArraySample( const DataType &iDtype,
+                     const Dimensions &iDims,
+                     const ArraySampleAllocatorPtr &iAllocator )
+{
+    ABCA_ASSERT( iAllocator, "Invalid ArraySampleAllocator" );
+    ABCA_ASSERT( iDtype.getPod() != kUnknownPOD,
+                 "Can't allocate an array sample of unknown POD" );
+
+    using namespace ArraySampleAllocatorDetail;
+
+    size_t numPODs = iDims.numPoints() * iDtype.getExtent();
+    size_t dataBytes = numPODs * PODNumBytes( iDtype.getPod() );
+
+    void *data = NULL;
+    FusedAllocator<FusedArraySample> alloc( iAllocator, dataBytes, &data );
+    Alembic::Util::shared_ptr<FusedArraySample> fused =
+        std::allocate_shared<FusedArraySample>( alloc );
+
+    if ( iDtype.getPod() == kStringPOD )
+    {
+        std::string *strs = static_cast<std::string *>( data );
+        for ( size_t i = 0; i < numPODs; ++i )
+        {
+            new ( strs + i ) std::string();
+        }
+    }
+    else if ( iDtype.getPod() == kWstringPOD )
+    {
+        std::wstring *strs = static_cast<std::wstring *>( data );
+        for ( size_t i = 0; i < numPODs; ++i )
+        {
+            new ( strs + i ) std::wstring();
+        }
+    }
+
+    fused->sample = ArraySample( data, iDtype, iDims );
+    return ArraySamplePtr( fused, &fused->sample );
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcCoreAbstract
+} // End namespace Alembic
+
+#endif
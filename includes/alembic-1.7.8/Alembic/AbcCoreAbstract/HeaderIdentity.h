@@ -0,0 +1,192 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcCoreAbstract_HeaderIdentity_h_
+#define _Alembic_AbcCoreAbstract_HeaderIdentity_h_
+
+#include <Alembic/Util/InternedString.h>
+#include <Alembic/AbcCoreAbstract/Foundation.h>
+#include <Alembic/AbcCoreAbstract/MetaData.h>
+#include <Alembic/AbcCoreAbstract/ObjectHeader.h>
+#include <Alembic/AbcCoreAbstract/PropertyHeader.h>
+
+namespace Alembic {
+namespace AbcCoreAbstract {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! The parts of a header's MetaData that schema and geom param matching look
+//! at, decoded in a single pass.  Strings are stored as interned ids (see
+//! Util::InternString), so checking whether a header is of a given schema is
+//! an integer comparison.  A missing key has id 0, the id of "".
+struct HeaderIdentity
+{
+    uint32_t schema;
+    uint32_t schemaObjTitle;
+    uint32_t schemaBaseType;
+    uint32_t interpretation;
+    uint32_t geoScope;
+
+    //! The POD named by "podName", or kUnknownPOD.
+    PlainOldDataType podName;
+
+    //! "podExtent", or 0 if it is not set.
+    int32_t podExtent;
+
+    //! "arrayExtent", or 1 if it is not set.
+    int32_t arrayExtent;
+
+    HeaderIdentity()
+      : schema( 0 ), schemaObjTitle( 0 ), schemaBaseType( 0 )
+      , interpretation( 0 ), geoScope( 0 ), podName( kUnknownPOD )
+      , podExtent( 0 ), arrayExtent( 1 ) {}
+
+    explicit HeaderIdentity( const MetaData &iMetaData )
+      : schema( 0 ), schemaObjTitle( 0 ), schemaBaseType( 0 )
+      , interpretation( 0 ), geoScope( 0 ), podName( kUnknownPOD )
+      , podExtent( 0 ), arrayExtent( 1 )
+    {
+        Util::InternedStringTable &table = Util::InternedStringTable::get();
+
+        for ( MetaData::const_iterator it = iMetaData.begin();
+              it != iMetaData.end(); ++it )
+        {
+            const std::string &key = it->first;
+            const std::string &val = it->second;
+
+            if ( key == "schema" ) { schema = table.intern( val ); }
+            else if ( key == "schemaObjTitle" )
+            { schemaObjTitle = table.intern( val ); }
+            else if ( key == "schemaBaseType" )
+            { schemaBaseType = table.intern( val ); }
+            else if ( key == "interpretation" )
+            { interpretation = table.intern( val ); }
+            else if ( key == "geoScope" ) { geoScope = table.intern( val ); }
+            else if ( key == "podName" ) { podName = PODFromName( val ); }
+            else if ( key == "podExtent" ) { podExtent = atoi( val.c_str() ); }
+            else if ( key == "arrayExtent" && !val.empty() )
+            { arrayExtent = atoi( val.c_str() ); }
+        }
+    }
+
+    //! Whether this is the identity of a schema titled iTitleId, the way
+    //! ISchemaObject strictly matches: by schemaObjTitle or by schema.
+    bool isSchemaObject( uint32_t iTitleId ) const
+    {
+        return iTitleId != 0 &&
+            ( schemaObjTitle == iTitleId || schema == iTitleId );
+    }
+};
+
+//-*****************************************************************************
+//! Computes HeaderIdentities once per header and hands them back on every
+//! later visit, for code that repeatedly scans the headers of an archive.
+//! Entries are keyed by path rather than by header address, since readers
+//! (and so headers) are dropped and re-created while an archive is open, and
+//! a new header may land at an old one's address.  Objects are keyed by their
+//! full name; properties by the path of the compound property holding them,
+//! which the caller chooses (for example the object's full name followed by
+//! the names of the compounds leading to it), and their own name.  A path
+//! names the same header for as long as an archive is open, so a cache should
+//! be used with a single archive (or cleared between archives).
+//! It is safe to use from multiple threads.
+class HeaderIdentityCache : private Alembic::Util::noncopyable
+{
+public:
+    HeaderIdentityCache() {}
+
+    HeaderIdentity get( const ObjectHeader &iHeader )
+    {
+        return get( iHeader.getFullName(), iHeader.getMetaData() );
+    }
+
+    HeaderIdentity get( const std::string &iCompoundPath,
+                        const PropertyHeader &iHeader )
+    {
+        // Names don't contain '\0', so the first one in the key ends the
+        // compound path; this also keeps property keys apart from object
+        // full names.
+        std::string key;
+        key.reserve( iCompoundPath.size() + 1 + iHeader.getName().size() );
+        key += iCompoundPath;
+        key += '\0';
+        key += iHeader.getName();
+        return get( key, iHeader.getMetaData() );
+    }
+
+    size_t size()
+    {
+        Alembic::Util::scoped_lock l( m_mutex );
+        return m_identities.size();
+    }
+
+    void clear()
+    {
+        Alembic::Util::scoped_lock l( m_mutex );
+        m_identities.clear();
+    }
+
+private:
+    HeaderIdentity get( const std::string &iKey, const MetaData &iMetaData )
+    {
+        {
+            Alembic::Util::scoped_lock l( m_mutex );
+            IdentityMap::const_iterator it = m_identities.find( iKey );
+            if ( it != m_identities.end() ) { return it->second; }
+        }
+
+        HeaderIdentity identity( iMetaData );
+
+        Alembic::Util::scoped_lock l( m_mutex );
+        m_identities[iKey] = identity;
+        return identity;
+    }
+
+    typedef Alembic::Util::unordered_map< std::string, HeaderIdentity >
+    IdentityMap;
+
+    Alembic::Util::mutex m_mutex;
+    IdentityMap m_identities;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcCoreAbstract
+} // End namespace Alembic
+
+#endif
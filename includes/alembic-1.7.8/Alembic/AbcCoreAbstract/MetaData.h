@@ -194,6 +194,29 @@ public:
         return m_tokenMap.value( iKey );
     }
 
+    //! getPtr returns a pointer to the value, or NULL if it is not set.
+    //! Unlike get, it does not copy the value. The pointer remains valid
+    //! until this MetaData is modified.
+    const std::string *getPtr( const std::string &iKey ) const
+    {
+        return m_tokenMap.valuePtr( iKey );
+    }
+
+    //! matchesValue returns whether the value of iKey is iValue, without
+    //! copying it. Just like with get, a missing key has the value "".
+    bool matchesValue( const std::string &iKey, const char *iValue ) const
+    {
+        const std::string *found = m_tokenMap.valuePtr( iKey );
+        return found ? ( *found == iValue ) : ( iValue[0] == '\0' );
+    }
+
+    bool matchesValue( const std::string &iKey,
+                       const std::string &iValue ) const
+    {
+        const std::string *found = m_tokenMap.valuePtr( iKey );
+        return found ? ( *found == iValue ) : iValue.empty();
+    }
+
     //! getRequired returns the value, and throws an exception if it is
     //! not found.
     std::string getRequired( const std::string &iKey ) const
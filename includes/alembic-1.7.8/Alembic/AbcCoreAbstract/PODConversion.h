@@ -0,0 +1,269 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcCoreAbstract_PODConversion_h_
+#define _Alembic_AbcCoreAbstract_PODConversion_h_
+
+#include <Alembic/AbcCoreAbstract/Foundation.h>
+
+#include <cstring>
+
+namespace Alembic {
+namespace AbcCoreAbstract {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Converts iNumPODs values from the array at iFrom to the array at oTo.
+typedef void ( *PODConversionFunc )( const void *iFrom, void *oTo,
+                                     size_t iNumPODs );
+
+namespace PODConversionDetail {
+
+//-*****************************************************************************
+// The per element conversion.  Numbers convert with static_cast, like getAs,
+// booleans convert to 0 or 1 and from != 0, and halves go through float.
+template <class FROM, class TO>
+struct Converter
+{
+    static TO convert( FROM iValue ) { return static_cast<TO>( iValue ); }
+};
+
+template <class FROM>
+struct Converter<FROM, bool_t>
+{
+    static bool_t convert( FROM iValue ) { return bool_t( iValue != FROM( 0 ) ); }
+};
+
+template <class TO>
+struct Converter<bool_t, TO>
+{
+    static TO convert( bool_t iValue ) { return static_cast<TO>( iValue ? 1 : 0 ); }
+};
+
+template <>
+struct Converter<bool_t, bool_t>
+{
+    static bool_t convert( bool_t iValue ) { return iValue; }
+};
+
+template <class FROM>
+struct Converter<FROM, float16_t>
+{
+    static float16_t convert( FROM iValue )
+    { return float16_t( static_cast<float32_t>( iValue ) ); }
+};
+
+template <class TO>
+struct Converter<float16_t, TO>
+{
+    static TO convert( float16_t iValue )
+    { return static_cast<TO>( static_cast<float32_t>( iValue ) ); }
+};
+
+template <>
+struct Converter<float16_t, float16_t>
+{
+    static float16_t convert( float16_t iValue ) { return iValue; }
+};
+
+template <>
+struct Converter<float16_t, bool_t>
+{
+    static bool_t convert( float16_t iValue )
+    { return bool_t( static_cast<float32_t>( iValue ) != 0.0f ); }
+};
+
+template <>
+struct Converter<bool_t, float16_t>
+{
+    static float16_t convert( bool_t iValue )
+    { return float16_t( iValue ? 1.0f : 0.0f ); }
+};
+
+//-*****************************************************************************
+// Straight loops with no branches in the body, which compilers vectorize for
+// whatever instruction set the build targets.
+template <PlainOldDataType FROM, PlainOldDataType TO>
+void ConvertPODs( const void *iFrom, void *oTo, size_t iNumPODs )
+{
+    typedef typename PODTraitsFromEnum<FROM>::value_type from_type;
+    typedef typename PODTraitsFromEnum<TO>::value_type to_type;
+
+    const from_type *from = static_cast<const from_type *>( iFrom );
+    to_type *to = static_cast<to_type *>( oTo );
+
+    for ( size_t i = 0; i < iNumPODs; ++i )
+    {
+        to[i] = Converter<from_type, to_type>::convert( from[i] );
+    }
+}
+
+template <PlainOldDataType POD>
+void CopyPODs( const void *iFrom, void *oTo, size_t iNumPODs )
+{
+    if ( iNumPODs > 0 && iFrom != oTo )
+    {
+        memcpy( oTo, iFrom, iNumPODs * PODTraitsFromEnum<POD>::numBytes() );
+    }
+}
+
+template <PlainOldDataType POD>
+void CopyStrings( const void *iFrom, void *oTo, size_t iNumPODs )
+{
+    typedef typename PODTraitsFromEnum<POD>::value_type string_type;
+
+    const string_type *from = static_cast<const string_type *>( iFrom );
+    string_type *to = static_cast<string_type *>( oTo );
+
+    if ( from != to )
+    {
+        for ( size_t i = 0; i < iNumPODs; ++i )
+        {
+            to[i] = from[i];
+        }
+    }
+}
+
+template <PlainOldDataType FROM, PlainOldDataType TO>
+struct Kernel
+{
+    static PODConversionFunc get() { return &ConvertPODs<FROM, TO>; }
+};
+
+template <PlainOldDataType POD>
+struct Kernel<POD, POD>
+{
+    static PODConversionFunc get() { return &CopyPODs<POD>; }
+};
+
+#define ALEMBIC_POD_CONVERSION_ROW( FROM )                              \
+    {                                                                   \
+        Kernel<FROM, kBooleanPOD>::get(),                               \
+        Kernel<FROM, kUint8POD>::get(),                                 \
+        Kernel<FROM, kInt8POD>::get(),                                  \
+        Kernel<FROM, kUint16POD>::get(),                                \
+        Kernel<FROM, kInt16POD>::get(),                                 \
+        Kernel<FROM, kUint32POD>::get(),                                \
+        Kernel<FROM, kInt32POD>::get(),                                 \
+        Kernel<FROM, kUint64POD>::get(),                                \
+        Kernel<FROM, kInt64POD>::get(),                                 \
+        Kernel<FROM, kFloat16POD>::get(),                               \
+        Kernel<FROM, kFloat32POD>::get(),                               \
+        Kernel<FROM, kFloat64POD>::get(),                               \
+        NULL,                                                           \
+        NULL                                                            \
+    }
+
+struct Table
+{
+    Table()
+    {
+        const PODConversionFunc numeric[kStringPOD][kNumPlainOldDataTypes] =
+        {
+            ALEMBIC_POD_CONVERSION_ROW( kBooleanPOD ),
+            ALEMBIC_POD_CONVERSION_ROW( kUint8POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kInt8POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kUint16POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kInt16POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kUint32POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kInt32POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kUint64POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kInt64POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kFloat16POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kFloat32POD ),
+            ALEMBIC_POD_CONVERSION_ROW( kFloat64POD )
+        };
+
+        memset( funcs, 0, sizeof( funcs ) );
+        for ( size_t i = 0; i < kStringPOD; ++i )
+        {
+            for ( size_t j = 0; j < kNumPlainOldDataTypes; ++j )
+            {
+                funcs[i][j] = numeric[i][j];
+            }
+        }
+
+        funcs[kStringPOD][kStringPOD] = &CopyStrings<kStringPOD>;
+        funcs[kWstringPOD][kWstringPOD] = &CopyStrings<kWstringPOD>;
+    }
+
+    PODConversionFunc funcs[kNumPlainOldDataTypes][kNumPlainOldDataTypes];
+};
+
+#undef ALEMBIC_POD_CONVERSION_ROW
+
+} // End namespace PODConversionDetail
+
+//-*****************************************************************************
+//! Returns the kernel that converts arrays of iFrom to arrays of iTo, or NULL
+//! if there is none.  Every pair of numeric PODs (including booleans and
+//! halves) has one; strings only convert to the same string type.
+inline PODConversionFunc
+GetPODConversionFunc( PlainOldDataType iFrom, PlainOldDataType iTo )
+{
+    static const PODConversionDetail::Table table;
+
+    if ( iFrom >= kNumPlainOldDataTypes || iTo >= kNumPlainOldDataTypes )
+    {
+        return NULL;
+    }
+    return table.funcs[iFrom][iTo];
+}
+
+//-*****************************************************************************
+//! Converts iNumPODs values of type iFromPod at iFrom into the values of type
+//! iToPod at oTo.  The arrays must not overlap unless they are the same
+//! array of the same POD.  Throws if there is no conversion between the PODs.
+inline void ConvertPODArray( const void *iFrom, PlainOldDataType iFromPod,
+                             void *oTo, PlainOldDataType iToPod,
+                             size_t iNumPODs )
+{
+    PODConversionFunc func = GetPODConversionFunc( iFromPod, iToPod );
+
+    ABCA_ASSERT( func, "Can't convert from " << PODName( iFromPod )
+                 << " to " << PODName( iToPod ) );
+
+    func( iFrom, oTo, iNumPODs );
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcCoreAbstract
+} // End namespace Alembic
+
+#endif
@@ -0,0 +1,459 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcCoreLayer_LayerIndex_h_
+#define _Alembic_AbcCoreLayer_LayerIndex_h_
+
+#include <Alembic/AbcCoreAbstract/All.h>
+#include <Alembic/AbcCoreLayer/Foundation.h>
+#include <Alembic/Util/ParallelFor.h>
+
+#include <algorithm>
+
+namespace Alembic {
+namespace AbcCoreLayer {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! An immutable, flattened view of the hierarchy that layering a set of
+//! archives produces: every object and property path maps straight to the
+//! header that wins and the layer it comes from, so lookups cost one hash
+//! probe no matter how many layers there are.
+//!
+//! Layers are merged in order, later layers overriding earlier ones, with the
+//! same prune and replace rules as ReadArchive (see SetPrune and SetReplace).
+//! Each layer is walked on its own thread, and the walks are then merged in
+//! layer order.  The index holds copies of the headers and no readers, so
+//! it stays valid after the archives are closed.  It is safe to query from
+//! multiple threads.
+class LayerIndex
+{
+public:
+    struct PropertyEntry
+    {
+        //! The winning header.  The top compound of an object (path "") has
+        //! a default header.
+        AbcA::PropertyHeader header;
+
+        //! The layer the header comes from.
+        uint32_t layer;
+
+        //! The names of a compound property's children, in merged order.
+        std::vector<std::string> children;
+    };
+
+    typedef Alembic::Util::unordered_map<std::string, PropertyEntry>
+    PropertyMap;
+
+    struct ObjectEntry
+    {
+        //! The winning header.
+        AbcA::ObjectHeader header;
+
+        //! The layer the header comes from.
+        uint32_t layer;
+
+        //! Every layer that contributes to this object since it was last
+        //! replaced, in order.
+        std::vector<uint32_t> layers;
+
+        //! The names of the children, in merged order.
+        std::vector<std::string> children;
+
+        //! Keyed by the path of the property under the object's top
+        //! compound, with '/' between compound names; "" is the top compound.
+        PropertyMap properties;
+    };
+
+    LayerIndex() : m_numLayers( 0 ) {}
+
+    //! Indexes the layered hierarchy of iArchives, in the same order that
+    //! would be passed to ReadArchive.  iNumThreads of 0 uses one thread per
+    //! layer, up to the number of cores.
+    explicit LayerIndex( const ArchiveReaderPtrs &iArchives,
+                         size_t iNumThreads = 0 )
+      : m_numLayers( 0 )
+    {
+        build( iArchives, iNumThreads );
+    }
+
+    void build( const ArchiveReaderPtrs &iArchives, size_t iNumThreads = 0 );
+
+    size_t getNumLayers() const { return m_numLayers; }
+
+    size_t getNumObjects() const { return m_objects.size(); }
+
+    //! Returns the entry for the object at iFullName ("/" is the top), or
+    //! NULL if the layered hierarchy doesn't have it.
+    const ObjectEntry *findObject( const std::string &iFullName ) const
+    {
+        ObjectMap::const_iterator it = m_objects.find( iFullName );
+        return it == m_objects.end() ? NULL : &( it->second );
+    }
+
+    //! Returns the header of the child of iFullName called iChildName, or
+    //! NULL if there is none.
+    const AbcA::ObjectHeader *
+    getChildHeader( const std::string &iFullName,
+                    const std::string &iChildName ) const
+    {
+        const ObjectEntry *entry =
+            findObject( ChildFullName( iFullName, iChildName ) );
+        return entry ? &( entry->header ) : NULL;
+    }
+
+    //! Returns the property iPropertyPath of object iFullName, or NULL.
+    const PropertyEntry *
+    findProperty( const std::string &iFullName,
+                  const std::string &iPropertyPath ) const
+    {
+        const ObjectEntry *entry = findObject( iFullName );
+        if ( !entry )
+        {
+            return NULL;
+        }
+        PropertyMap::const_iterator it =
+            entry->properties.find( iPropertyPath );
+        return it == entry->properties.end() ? NULL : &( it->second );
+    }
+
+    //! Returns the header of property iPropertyPath on object iFullName, or
+    //! NULL if there is none.
+    const AbcA::PropertyHeader *
+    getPropertyHeader( const std::string &iFullName,
+                       const std::string &iPropertyPath ) const
+    {
+        const PropertyEntry *entry = findProperty( iFullName, iPropertyPath );
+        return entry && !iPropertyPath.empty() ? &( entry->header ) : NULL;
+    }
+
+    static std::string ChildFullName( const std::string &iParentFullName,
+                                      const std::string &iChildName )
+    {
+        if ( iParentFullName.empty() || iParentFullName == "/" )
+        {
+            return "/" + iChildName;
+        }
+        return iParentFullName + "/" + iChildName;
+    }
+
+    static std::string ChildPropertyPath( const std::string &iParentPath,
+                                          const std::string &iChildName )
+    {
+        return iParentPath.empty() ? iChildName :
+            iParentPath + "/" + iChildName;
+    }
+
+private:
+    struct PropertyRecord
+    {
+        std::string parentPath;
+        AbcA::PropertyHeader header;
+    };
+
+    struct ObjectRecord
+    {
+        std::string parentFullName;
+        AbcA::ObjectHeader header;
+        std::vector<PropertyRecord> properties;
+    };
+
+    typedef std::vector<ObjectRecord> LayerRecords;
+    typedef Alembic::Util::unordered_map<std::string, ObjectEntry> ObjectMap;
+
+    static bool IsPruned( const AbcA::MetaData &iMetaData )
+    {
+        return iMetaData.matchesValue( "prune", "1" );
+    }
+
+    static bool IsReplaced( const AbcA::MetaData &iMetaData )
+    {
+        return iMetaData.matchesValue( "replace", "1" );
+    }
+
+    static void WalkProperties( AbcA::CompoundPropertyReaderPtr iCompound,
+                                const std::string &iPath,
+                                std::vector<PropertyRecord> &oRecords );
+
+    static void WalkObjects( AbcA::ObjectReaderPtr iObject,
+                             const std::string &iParentFullName,
+                             LayerRecords &oRecords );
+
+    static void EraseProperties( PropertyMap &ioProperties,
+                                 const std::string &iPath );
+
+    void eraseObject( const std::string &iFullName );
+
+    void mergeLayer( uint32_t iLayer, const LayerRecords &iRecords );
+
+    void mergeProperties( uint32_t iLayer, ObjectEntry &ioEntry,
+                          const std::vector<PropertyRecord> &iRecords );
+
+    size_t m_numLayers;
+    ObjectMap m_objects;
+};
+
+//-*****************************************************************************
+inline void LayerIndex::build( const ArchiveReaderPtrs &iArchives,
+                               size_t iNumThreads )
+{
+    m_objects.clear();
+    m_numLayers = iArchives.size();
+
+    std::vector<LayerRecords> records( iArchives.size() );
+
+    Alembic::Util::ParallelFor( 0, iArchives.size(), 1,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t i = iBegin; i < iEnd; ++i )
+            {
+                ABCA_ASSERT( iArchives[i], "Invalid archive in layer " << i );
+                WalkObjects( iArchives[i]->getTop(), "", records[i] );
+            }
+        }, iNumThreads );
+
+    for ( size_t i = 0; i < records.size(); ++i )
+    {
+        mergeLayer( static_cast<uint32_t>( i ), records[i] );
+        LayerRecords().swap( records[i] );
+    }
+}
+
+//-*****************************************************************************
+inline void
+LayerIndex::WalkProperties( AbcA::CompoundPropertyReaderPtr iCompound,
+                            const std::string &iPath,
+                            std::vector<PropertyRecord> &oRecords )
+{
+    size_t numProps = iCompound->getNumProperties();
+    for ( size_t i = 0; i < numProps; ++i )
+    {
+        const AbcA::PropertyHeader &header = iCompound->getPropertyHeader( i );
+
+        oRecords.push_back( PropertyRecord() );
+        oRecords.back().parentPath = iPath;
+        oRecords.back().header = header;
+
+        if ( header.isCompound() )
+        {
+            WalkProperties( iCompound->getCompoundProperty( i ),
+                            ChildPropertyPath( iPath, header.getName() ),
+                            oRecords );
+        }
+    }
+}
+
+//-*****************************************************************************
+inline void LayerIndex::WalkObjects( AbcA::ObjectReaderPtr iObject,
+                                     const std::string &iParentFullName,
+                                     LayerRecords &oRecords )
+{
+    oRecords.push_back( ObjectRecord() );
+    ObjectRecord &record = oRecords.back();
+    record.parentFullName = iParentFullName;
+    record.header = iObject->getHeader();
+
+    WalkProperties( iObject->getProperties(), "", record.properties );
+
+    std::string fullName = iObject->getFullName();
+    size_t numChildren = iObject->getNumChildren();
+    for ( size_t i = 0; i < numChildren; ++i )
+    {
+        WalkObjects( iObject->getChild( i ), fullName, oRecords );
+    }
+}
+
+//-*****************************************************************************
+inline void LayerIndex::EraseProperties( PropertyMap &ioProperties,
+                                         const std::string &iPath )
+{
+    PropertyMap::iterator it = ioProperties.find( iPath );
+    if ( it == ioProperties.end() )
+    {
+        return;
+    }
+
+    std::vector<std::string> children;
+    children.swap( it->second.children );
+    ioProperties.erase( it );
+
+    for ( size_t i = 0; i < children.size(); ++i )
+    {
+        EraseProperties( ioProperties, ChildPropertyPath( iPath, children[i] ) );
+    }
+}
+
+//-*****************************************************************************
+inline void LayerIndex::eraseObject( const std::string &iFullName )
+{
+    ObjectMap::iterator it = m_objects.find( iFullName );
+    if ( it == m_objects.end() )
+    {
+        return;
+    }
+
+    std::vector<std::string> children;
+    children.swap( it->second.children );
+    m_objects.erase( it );
+
+    for ( size_t i = 0; i < children.size(); ++i )
+    {
+        eraseObject( ChildFullName( iFullName, children[i] ) );
+    }
+}
+
+//-*****************************************************************************
+inline void
+LayerIndex::mergeProperties( uint32_t iLayer, ObjectEntry &ioEntry,
+                             const std::vector<PropertyRecord> &iRecords )
+{
+    PropertyMap &props = ioEntry.properties;
+    if ( props.find( "" ) == props.end() )
+    {
+        props[""].layer = iLayer;
+    }
+
+    for ( size_t i = 0; i < iRecords.size(); ++i )
+    {
+        const PropertyRecord &record = iRecords[i];
+
+        // the parent was pruned
+        PropertyMap::iterator parent = props.find( record.parentPath );
+        if ( parent == props.end() )
+        {
+            continue;
+        }
+
+        const std::string &name = record.header.getName();
+        std::string path = ChildPropertyPath( record.parentPath, name );
+        std::vector<std::string> &siblings = parent->second.children;
+
+        if ( IsPruned( record.header.getMetaData() ) )
+        {
+            EraseProperties( props, path );
+            siblings.erase( std::remove( siblings.begin(), siblings.end(),
+                                         name ), siblings.end() );
+            continue;
+        }
+
+        PropertyMap::iterator found = props.find( path );
+        if ( found != props.end() && IsReplaced( record.header.getMetaData() ) )
+        {
+            std::vector<std::string> children;
+            children.swap( found->second.children );
+            for ( size_t j = 0; j < children.size(); ++j )
+            {
+                EraseProperties( props, ChildPropertyPath( path, children[j] ) );
+            }
+        }
+        else if ( found == props.end() )
+        {
+            siblings.push_back( name );
+        }
+
+        // this may rehash, so parent and found are not used past here
+        PropertyEntry &entry = props[path];
+        entry.header = record.header;
+        entry.layer = iLayer;
+    }
+}
+
+//-*****************************************************************************
+inline void LayerIndex::mergeLayer( uint32_t iLayer,
+                                    const LayerRecords &iRecords )
+{
+    for ( size_t i = 0; i < iRecords.size(); ++i )
+    {
+        const ObjectRecord &record = iRecords[i];
+        const std::string &fullName = record.header.getFullName();
+        const std::string &name = record.header.getName();
+
+        ObjectMap::iterator parent = m_objects.end();
+        if ( !record.parentFullName.empty() )
+        {
+            // the parent was pruned
+            parent = m_objects.find( record.parentFullName );
+            if ( parent == m_objects.end() )
+            {
+                continue;
+            }
+
+            if ( IsPruned( record.header.getMetaData() ) )
+            {
+                eraseObject( fullName );
+                std::vector<std::string> &siblings = parent->second.children;
+                siblings.erase( std::remove( siblings.begin(), siblings.end(),
+                                             name ), siblings.end() );
+                continue;
+            }
+        }
+
+        ObjectMap::iterator found = m_objects.find( fullName );
+        if ( found != m_objects.end() &&
+             IsReplaced( record.header.getMetaData() ) )
+        {
+            ObjectEntry &replaced = found->second;
+            std::vector<std::string> children;
+            children.swap( replaced.children );
+            for ( size_t j = 0; j < children.size(); ++j )
+            {
+                eraseObject( ChildFullName( fullName, children[j] ) );
+            }
+            replaced.properties.clear();
+            replaced.layers.clear();
+        }
+        else if ( found == m_objects.end() && parent != m_objects.end() )
+        {
+            parent->second.children.push_back( name );
+        }
+
+        // this may rehash, so parent and found are not used past here
+        ObjectEntry &entry = m_objects[fullName];
+        entry.header = record.header;
+        entry.layer = iLayer;
+        entry.layers.push_back( iLayer );
+        mergeProperties( iLayer, entry, record.properties );
+    }
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcCoreLayer
+} // End namespace Alembic
+
+#endif
@@ -45,6 +45,7 @@
 #include <Alembic/Util/Export.h>
 #include <Alembic/AbcGeom/OCurves.h>
 #include <Alembic/AbcGeom/ICurves.h>
+#include <Alembic/AbcGeom/CurveTessellation.h>
 
 #include <Alembic/AbcGeom/OFaceSet.h>
 #include <Alembic/AbcGeom/IFaceSet.h>
@@ -59,6 +60,7 @@
 #include <Alembic/AbcGeom/CameraSample.h>
 #include <Alembic/AbcGeom/OCamera.h>
 #include <Alembic/AbcGeom/ICamera.h>
+#include <Alembic/AbcGeom/CameraVisibility.h>
 
 #include <Alembic/AbcGeom/ILight.h>
 #include <Alembic/AbcGeom/OLight.h>
@@ -68,6 +70,7 @@
 
 #include <Alembic/AbcGeom/OPoints.h>
 #include <Alembic/AbcGeom/IPoints.h>
+#include <Alembic/AbcGeom/PointsIndex.h>
 
 #include <Alembic/AbcGeom/OPolyMesh.h>
 #include <Alembic/AbcGeom/IPolyMesh.h>
@@ -82,4 +85,6 @@
 
 #include <Alembic/AbcGeom/Visibility.h>
 
+#include <Alembic/AbcGeom/MeshWeld.h>
+
 #endif
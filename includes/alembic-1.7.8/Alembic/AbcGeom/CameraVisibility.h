@@ -0,0 +1,398 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcGeom_CameraVisibility_h_
+#define _Alembic_AbcGeom_CameraVisibility_h_
+
+#include <Alembic/AbcGeom/Foundation.h>
+#include <Alembic/AbcGeom/CameraSample.h>
+#include <Alembic/AbcGeom/ICamera.h>
+#include <Alembic/AbcGeom/IGeomBase.h>
+#include <Alembic/AbcGeom/IXform.h>
+#include <Alembic/Util/ParallelFor.h>
+
+#include <ImathBoxAlgo.h>
+#include <ImathFrustum.h>
+#include <ImathFrustumTest.h>
+
+namespace Alembic {
+namespace AbcGeom {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Builds the view frustum of a camera sample, in camera space (looking
+//! down -Z), from its field of view, screen window and clipping planes.
+inline Imath::Frustumd GetCameraFrustum( CameraSample iSample )
+{
+    double top, bottom, left, right;
+    iSample.getScreenWindow( top, bottom, left, right );
+
+    double nearPlane = iSample.getNearClippingPlane();
+    double farPlane = iSample.getFarClippingPlane();
+
+    // the screen window is in units where the film back spans [-1, 1]
+    // horizontally
+    double scale = nearPlane *
+        tan( DegreesToRadians( iSample.getFieldOfView() ) * 0.5 );
+
+    return Imath::Frustumd( nearPlane, farPlane, left * scale, right * scale,
+                            top * scale, bottom * scale );
+}
+
+//-*****************************************************************************
+//! Returns the local to world matrix of iObject at iSS, by concatenating
+//! the transforms of it and its IXform ancestors.
+inline Abc::M44d GetWorldMatrix( Abc::IObject iObject,
+                                 const Abc::ISampleSelector &iSS )
+{
+    Abc::M44d ret;
+    for ( Abc::IObject obj = iObject; obj.valid(); obj = obj.getParent() )
+    {
+        if ( !IXform::matches( obj.getHeader() ) )
+        {
+            continue;
+        }
+
+        IXformSchema xform = IXform( obj, kWrapExisting ).getSchema();
+        XformSample sample = xform.getValue( iSS );
+        ret *= sample.getMatrix();
+        if ( !sample.getInheritsXforms() )
+        {
+            break;
+        }
+    }
+    return ret;
+}
+
+//-*****************************************************************************
+//! One bit per object of a CameraVisibility, set when the object may be
+//! visible.
+struct VisibilityBits
+{
+    std::vector<uint64_t> words;
+
+    bool test( size_t i ) const
+    { return ( words[i >> 6] >> ( i & 63 ) ) & 1; }
+
+    size_t count() const
+    {
+        size_t ret = 0;
+        for ( size_t i = 0; i < words.size(); ++i )
+        {
+            uint64_t w = words[i];
+            for ( ; w; w &= w - 1 ) { ++ret; }
+        }
+        return ret;
+    }
+};
+
+//-*****************************************************************************
+//! Computes which objects under a root may be seen by a camera, frame by
+//! frame, reading only transforms and bounds.
+//!
+//! The hierarchy is indexed once, in depth first order.  For each frame it
+//! is then walked top down: an object whose child bounds fall outside the
+//! frustum has its whole subtree rejected without being looked at, and a
+//! geometric object is visible if its self bounds intersect the frustum.
+//! Objects with no bounds to test (such as cameras, or geometry written
+//! without bounds) count as visible when their ancestors are.  Child bounds
+//! of an IXform are taken to be in the space of its children, and the
+//! transforms above the root are applied to it.  The frames, and the
+//! subtrees under the root, are processed in parallel.
+class CameraVisibility
+{
+public:
+    explicit CameraVisibility( Abc::IObject iRoot )
+    {
+        ABCA_ASSERT( iRoot.valid(), "Invalid root for CameraVisibility" );
+        m_rootParent = iRoot.getParent();
+        addNode( iRoot, -1 );
+
+        // the root's children head the subtrees that are run in parallel
+        for ( uint32_t i = 1; i < m_nodes.size(); i = m_nodes[i].end )
+        {
+            m_subtrees.push_back( i );
+        }
+    }
+
+    size_t getNumObjects() const { return m_nodes.size(); }
+
+    //! Objects are numbered in depth first order, starting with the root.
+    const std::string &getObjectFullName( size_t i ) const
+    { return m_nodes[i].fullName; }
+
+    //! Fills oVisible with one VisibilityBits per time in iTimes, for
+    //! iCamera at those times.
+    void compute( ICamera iCamera, const std::vector<chrono_t> &iTimes,
+                  std::vector<VisibilityBits> &oVisible,
+                  size_t iNumThreads = 0 ) const
+    {
+        ICameraSchema camera = iCamera.getSchema();
+
+        std::vector<Abc::M44d> cameraMatrices( iTimes.size() );
+        std::vector<Imath::Frustumd> frustums( iTimes.size() );
+        for ( size_t i = 0; i < iTimes.size(); ++i )
+        {
+            Abc::ISampleSelector ss( iTimes[i] );
+            frustums[i] = GetCameraFrustum( camera.getValue( ss ) );
+            cameraMatrices[i] = GetWorldMatrix( iCamera, ss );
+        }
+
+        compute( frustums, cameraMatrices, iTimes, oVisible, iNumThreads );
+    }
+
+    //! Like the above, but with the camera given as frustums in camera space
+    //! and camera to world matrices, one per time.
+    void compute( const std::vector<Imath::Frustumd> &iFrustums,
+                  const std::vector<Abc::M44d> &iCameraMatrices,
+                  const std::vector<chrono_t> &iTimes,
+                  std::vector<VisibilityBits> &oVisible,
+                  size_t iNumThreads = 0 ) const
+    {
+        ABCA_ASSERT( iFrustums.size() == iTimes.size() &&
+                     iCameraMatrices.size() == iTimes.size(),
+                     "Need one frustum and camera matrix per time" );
+
+        size_t numFrames = iTimes.size();
+        size_t numNodes = m_nodes.size();
+        size_t numSubtrees = m_subtrees.size();
+
+        // the root is visible unless its child bounds say otherwise, and
+        // each subtree gets its own slice of a byte per object per frame
+        std::vector<Abc::M44d> parentMatrices( numFrames );
+        std::vector<Abc::M44d> rootMatrices( numFrames );
+        for ( size_t frame = 0; frame < numFrames; ++frame )
+        {
+            rootWorldMatrices( Abc::ISampleSelector( iTimes[frame] ),
+                               parentMatrices[frame], rootMatrices[frame] );
+        }
+        std::vector<char> bytes( numFrames * numNodes, 0 );
+
+        Util::ParallelFor( 0, numFrames * ( numSubtrees + 1 ), 1,
+            [&]( size_t iBegin, size_t iEnd )
+            {
+                for ( size_t item = iBegin; item < iEnd; ++item )
+                {
+                    size_t frame = item / ( numSubtrees + 1 );
+                    size_t subtree = item % ( numSubtrees + 1 );
+                    Imath::FrustumTestd test( iFrustums[frame],
+                                              iCameraMatrices[frame] );
+                    Abc::ISampleSelector ss( iTimes[frame] );
+                    char *visible = &bytes[frame * numNodes];
+
+                    if ( subtree == 0 )
+                    {
+                        walk( 0, 1, parentMatrices[frame], test, ss,
+                              visible );
+                    }
+                    else
+                    {
+                        uint32_t begin = m_subtrees[subtree - 1];
+                        walk( begin, m_nodes[begin].end,
+                              rootMatrices[frame], test, ss, visible );
+                    }
+                }
+            }, iNumThreads );
+
+        oVisible.resize( numFrames );
+        Util::ParallelFor( 0, numFrames, 1,
+            [&]( size_t iBegin, size_t iEnd )
+            {
+                for ( size_t frame = iBegin; frame < iEnd; ++frame )
+                {
+                    const char *visible = &bytes[frame * numNodes];
+                    std::vector<uint64_t> &words = oVisible[frame].words;
+                    words.assign( ( numNodes + 63 ) / 64, 0 );
+
+                    // children of a rejected root are rejected too
+                    bool rootChildren = visible[0] & 2;
+                    for ( size_t i = 0; i < numNodes; ++i )
+                    {
+                        if ( ( visible[i] & 1 ) && ( i == 0 || rootChildren ) )
+                        {
+                            words[i >> 6] |= uint64_t( 1 ) << ( i & 63 );
+                        }
+                    }
+                }
+            }, iNumThreads );
+    }
+
+private:
+    struct Node
+    {
+        Node() : parent( -1 ), end( 0 ), isXform( false ) {}
+
+        std::string fullName;
+        int32_t parent;
+
+        //! One past the last node of this node's subtree.
+        uint32_t end;
+
+        bool isXform;
+        IXformSchema xform;
+        Abc::IBox3dProperty selfBounds;
+        Abc::IBox3dProperty childBounds;
+    };
+
+    void addNode( Abc::IObject iObject, int32_t iParent )
+    {
+        uint32_t index = static_cast<uint32_t>( m_nodes.size() );
+        m_nodes.push_back( Node() );
+
+        Node &node = m_nodes.back();
+        node.fullName = iObject.getFullName();
+        node.parent = iParent;
+
+        const AbcA::ObjectHeader &header = iObject.getHeader();
+        if ( IXform::matches( header ) )
+        {
+            node.isXform = true;
+            node.xform = IXform( iObject, kWrapExisting ).getSchema();
+            node.childBounds = node.xform.getChildBoundsProperty();
+        }
+        else if ( IGeomBaseObject::matches( header ) )
+        {
+            IGeomBase geom = IGeomBaseObject( iObject,
+                                              kWrapExisting ).getSchema();
+            node.selfBounds = geom.getSelfBoundsProperty();
+            node.childBounds = geom.getChildBoundsProperty();
+        }
+
+        size_t numChildren = iObject.getNumChildren();
+        for ( size_t i = 0; i < numChildren; ++i )
+        {
+            addNode( iObject.getChild( i ), static_cast<int32_t>( index ) );
+        }
+
+        m_nodes[index].end = static_cast<uint32_t>( m_nodes.size() );
+    }
+
+    //! The world matrices of the root's parent and of the root itself.
+    void rootWorldMatrices( const Abc::ISampleSelector &iSS,
+                            Abc::M44d &oParentMatrix,
+                            Abc::M44d &oRootMatrix ) const
+    {
+        oParentMatrix = m_rootParent.valid() ?
+            GetWorldMatrix( m_rootParent, iSS ) : Abc::M44d();
+
+        const Node &root = m_nodes[0];
+        if ( root.isXform )
+        {
+            XformSample sample = root.xform.getValue( iSS );
+            oRootMatrix = sample.getInheritsXforms() ?
+                sample.getMatrix() * oParentMatrix : sample.getMatrix();
+        }
+        else
+        {
+            oRootMatrix = oParentMatrix;
+        }
+    }
+
+    //! Walks the nodes in [iBegin, iEnd), the subtree of iBegin (or just the
+    //! root), whose parent's world matrix is iParentMatrix.  Sets bit 1 of
+    //! the byte for each visible node, and bit 2 for the root when its
+    //! children aren't rejected.
+    void walk( uint32_t iBegin, uint32_t iEnd, const Abc::M44d &iParentMatrix,
+               const Imath::FrustumTestd &iTest,
+               const Abc::ISampleSelector &iSS, char *oVisible ) const
+    {
+        std::vector<Abc::M44d> matrices( iEnd - iBegin );
+
+        uint32_t i = iBegin;
+        while ( i < iEnd )
+        {
+            const Node &node = m_nodes[i];
+            const Abc::M44d &parentMatrix =
+                ( node.parent < static_cast<int32_t>( iBegin ) ) ?
+                iParentMatrix : matrices[node.parent - iBegin];
+
+            Abc::M44d &matrix = matrices[i - iBegin];
+            if ( node.isXform )
+            {
+                XformSample sample = node.xform.getValue( iSS );
+                matrix = sample.getInheritsXforms() ?
+                    sample.getMatrix() * parentMatrix : sample.getMatrix();
+            }
+            else
+            {
+                matrix = parentMatrix;
+            }
+
+            // empty child bounds usually mean they were never computed
+            bool childrenVisible = true;
+            if ( node.childBounds.valid() )
+            {
+                Abc::Box3d box = node.childBounds.getValue( iSS );
+                childrenVisible = box.isEmpty() ||
+                    iTest.isVisible( Imath::transform( box, matrix ) );
+            }
+
+            bool selfVisible = true;
+            if ( node.selfBounds.valid() )
+            {
+                Abc::Box3d box = node.selfBounds.getValue( iSS );
+                selfVisible = !box.isEmpty() &&
+                    iTest.isVisible( Imath::transform( box, matrix ) );
+            }
+
+            oVisible[i] = ( selfVisible ? 1 : 0 ) |
+                ( childrenVisible ? 2 : 0 );
+
+            // the root's children are walked as separate subtrees
+            if ( i == 0 || !childrenVisible )
+            {
+                i = ( i == 0 ) ? iEnd : node.end;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    Abc::IObject m_rootParent;
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_subtrees;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcGeom
+} // End namespace Alembic
+
+#endif
@@ -0,0 +1,641 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcGeom_CurveTessellation_h_
+#define _Alembic_AbcGeom_CurveTessellation_h_
+
+#include <Alembic/Util/Export.h>
+#include <Alembic/Util/ParallelFor.h>
+#include <Alembic/AbcGeom/Foundation.h>
+#include <Alembic/AbcGeom/ICurves.h>
+
+namespace Alembic {
+namespace AbcGeom {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! What TessellateCurves produces for every curve.
+enum CurveTessellationMode
+{
+    //! One polyline per curve.
+    kTessellatePolylines = 0,
+
+    //! One triangle strip per curve, two vertices per polyline vertex,
+    //! offset by half the width perpendicular to the curve and to
+    //! CurveTessellationSettings::ribbonFacing.
+    kTessellateRibbons = 1
+};
+
+//-*****************************************************************************
+struct CurveTessellationSettings
+{
+    //! Number of line segments each cubic or NURBS span is evaluated into.
+    //! Linear curves are passed through untouched.
+    size_t segmentsPerSpan;
+
+    CurveTessellationMode mode;
+
+    //! Direction the ribbons face, usually the direction towards the camera.
+    V3f ribbonFacing;
+
+    //! Width used when the curves have no widths.
+    float defaultWidth;
+
+    //! Threads used to tessellate, 0 means the hardware concurrency.
+    size_t numThreads;
+
+    CurveTessellationSettings()
+      : segmentsPerSpan( 4 )
+      , mode( kTessellatePolylines )
+      , ribbonFacing( 0.0f, 0.0f, 1.0f )
+      , defaultWidth( 1.0f )
+      , numThreads( 0 ) {}
+};
+
+//-*****************************************************************************
+//! The tessellated curves, numVertices[i] consecutive entries of positions
+//! and widths belong to curve i.
+struct TessellatedCurves
+{
+    std::vector<V3f> positions;
+    std::vector<float> widths;
+    std::vector<int32_t> numVertices;
+
+    void clear()
+    {
+        positions.clear();
+        widths.clear();
+        numVertices.clear();
+    }
+};
+
+namespace CurveTessellationDetail {
+
+//-*****************************************************************************
+// RenderMan style cubic basis matrices, rows are the t^3, t^2, t, 1
+// coefficients.
+inline bool GetCubicBasisMatrix( BasisType iBasis, float oM[4][4] )
+{
+    static const float bezier[4][4] = {
+        { -1.0f, 3.0f, -3.0f, 1.0f },
+        { 3.0f, -6.0f, 3.0f, 0.0f },
+        { -3.0f, 3.0f, 0.0f, 0.0f },
+        { 1.0f, 0.0f, 0.0f, 0.0f } };
+
+    static const float s = 1.0f / 6.0f;
+    static const float bspline[4][4] = {
+        { -s, 3.0f * s, -3.0f * s, s },
+        { 3.0f * s, -6.0f * s, 3.0f * s, 0.0f },
+        { -3.0f * s, 0.0f, 3.0f * s, 0.0f },
+        { s, 4.0f * s, s, 0.0f } };
+
+    static const float catmullrom[4][4] = {
+        { -0.5f, 1.5f, -1.5f, 0.5f },
+        { 1.0f, -2.5f, 2.0f, -0.5f },
+        { -0.5f, 0.0f, 0.5f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f } };
+
+    static const float hermite[4][4] = {
+        { 2.0f, 1.0f, -2.0f, 1.0f },
+        { -3.0f, -2.0f, 3.0f, -1.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 1.0f, 0.0f, 0.0f, 0.0f } };
+
+    static const float power[4][4] = {
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+    const float (*m)[4] = NULL;
+    switch ( iBasis )
+    {
+    case kBezierBasis: m = bezier; break;
+    case kBsplineBasis: m = bspline; break;
+    case kCatmullromBasis: m = catmullrom; break;
+    case kHermiteBasis: m = hermite; break;
+    case kPowerBasis: m = power; break;
+    default: return false;
+    }
+
+    memcpy( oM, m, sizeof( float ) * 16 );
+    return true;
+}
+
+//-*****************************************************************************
+inline size_t GetCubicStep( BasisType iBasis )
+{
+    switch ( iBasis )
+    {
+    case kBezierBasis: return 3;
+    case kHermiteBasis: return 2;
+    case kPowerBasis: return 4;
+    default: return 1;
+    }
+}
+
+//-*****************************************************************************
+// How a single curve is evaluated.
+enum CurveKind
+{
+    kLinearKind,
+    kCubicKind,
+    kNurbsKind
+};
+
+struct CurveInfo
+{
+    CurveKind kind;
+    size_t numCV;
+    size_t cvOffset;
+    size_t numSpans;
+    size_t order;
+    size_t knotOffset;
+    bool knotsValid;
+    size_t outOffset;
+    size_t numOut;
+    size_t varyingOffset;
+};
+
+//-*****************************************************************************
+// Cox-de Boor: the order non zero basis functions at t in knot span iSpan.
+inline void NurbsBasis( const float *iKnots, size_t iSpan, size_t iOrder,
+                        float iT, float *oN )
+{
+    float left[32];
+    float right[32];
+    oN[0] = 1.0f;
+    for ( size_t j = 1; j < iOrder; ++j )
+    {
+        left[j] = iT - iKnots[iSpan + 1 - j];
+        right[j] = iKnots[iSpan + j] - iT;
+        float saved = 0.0f;
+        for ( size_t r = 0; r < j; ++r )
+        {
+            float denom = right[r + 1] + left[j - r];
+            float tmp = denom != 0.0f ? oN[r] / denom : 0.0f;
+            oN[r] = saved + right[r + 1] * tmp;
+            saved = left[j - r] * tmp;
+        }
+        oN[j] = saved;
+    }
+}
+
+} // End namespace CurveTessellationDetail
+
+//-*****************************************************************************
+//! Tessellates every curve of iSample into polylines or ribbons.
+//!
+//! Linear curves, cubic curves in any of the AbcGeom bases, and
+//! kVariableOrder NURBS curves (with knots and position weights) are
+//! supported.  Cubic spans are evaluated against a weight table that is
+//! shared by every span of every curve, so the inner loops are a short
+//! weighted sum of four control points.  Curves are split across threads
+//! in contiguous ranges.
+//!
+//! iWidths may be NULL, otherwise it holds iNumWidths values of the given
+//! scope.  If the number of widths doesn't match the scope, the scope is
+//! inferred from the count.
+inline void TessellateCurves( ICurvesSchema::Sample &iSample,
+                              const float *iWidths,
+                              size_t iNumWidths,
+                              GeometryScope iWidthScope,
+                              const CurveTessellationSettings &iSettings,
+                              TessellatedCurves &oCurves )
+{
+    using namespace CurveTessellationDetail;
+
+    oCurves.clear();
+
+    Abc::P3fArraySamplePtr posSamp = iSample.getPositions();
+    Abc::Int32ArraySamplePtr nvSamp = iSample.getCurvesNumVertices();
+    if ( !posSamp || !nvSamp || nvSamp->size() == 0 ) { return; }
+
+    const V3f *P = posSamp->get();
+    const size_t numP = posSamp->size();
+    const int32_t *nv = nvSamp->get();
+    const size_t numCurves = nvSamp->size();
+
+    Abc::FloatArraySamplePtr weightSamp = iSample.getPositionWeights();
+    const float *weights = ( weightSamp && weightSamp->size() == numP ) ?
+        weightSamp->get() : NULL;
+
+    Abc::UcharArraySamplePtr orderSamp = iSample.getOrders();
+    const uint8_t *orders = ( orderSamp &&
+        orderSamp->size() == numCurves ) ? orderSamp->get() : NULL;
+
+    Abc::FloatArraySamplePtr knotSamp = iSample.getKnots();
+    const float *knots = ( knotSamp && knotSamp->size() ) ?
+        knotSamp->get() : NULL;
+    const size_t numKnots = knotSamp ? knotSamp->size() : 0;
+
+    const bool periodic = iSample.getWrap() == kPeriodic;
+    const size_t seg = std::max( iSettings.segmentsPerSpan, ( size_t ) 1 );
+
+    float basis[4][4];
+    bool hasCubicBasis = iSample.getType() == kCubic &&
+        GetCubicBasisMatrix( iSample.getBasis(), basis );
+    size_t step = GetCubicStep( iSample.getBasis() );
+
+    // Classify every curve and lay out the output.
+    std::vector<CurveInfo> infos( numCurves );
+    size_t cvOffset = 0;
+    size_t outOffset = 0;
+    size_t knotOffset = 0;
+    size_t varyingOffset = 0;
+    for ( size_t c = 0; c < numCurves; ++c )
+    {
+        CurveInfo &info = infos[c];
+        info.numCV = static_cast<size_t>( std::max( nv[c], 0 ) );
+        info.cvOffset = cvOffset;
+        info.kind = kLinearKind;
+        info.order = 2;
+        info.knotOffset = knotOffset;
+        info.knotsValid = false;
+
+        ABCA_ASSERT( cvOffset + info.numCV <= numP,
+                     "Curve vertex counts exceed the number of positions" );
+
+        if ( iSample.getType() == kVariableOrder && orders )
+        {
+            info.order = orders[c];
+            knotOffset += info.numCV + info.order;
+            if ( info.order > 2 && info.order <= 32 &&
+                 info.numCV >= info.order )
+            {
+                info.kind = kNurbsKind;
+                info.knotsValid = knots && knotOffset <= numKnots;
+            }
+        }
+        else if ( hasCubicBasis )
+        {
+            if ( periodic && info.numCV >= 4 && info.numCV % step == 0 )
+            {
+                info.kind = kCubicKind;
+            }
+            else if ( !periodic && info.numCV >= 4 &&
+                      ( info.numCV - 4 ) % step == 0 )
+            {
+                info.kind = kCubicKind;
+            }
+        }
+
+        switch ( info.kind )
+        {
+        case kCubicKind:
+            info.numSpans = periodic ? info.numCV / step :
+                ( info.numCV - 4 ) / step + 1;
+            info.numOut = info.numSpans * seg + 1;
+            break;
+        case kNurbsKind:
+            info.numSpans = info.numCV - info.order + 1;
+            info.numOut = info.numSpans * seg + 1;
+            break;
+        default:
+            info.numSpans = info.numCV > 0 ?
+                ( periodic ? info.numCV : info.numCV - 1 ) : 0;
+            info.numOut = info.numCV > 0 ?
+                ( periodic ? info.numCV + 1 : info.numCV ) : 0;
+            break;
+        }
+
+        info.outOffset = outOffset;
+        info.varyingOffset = varyingOffset;
+        outOffset += info.numOut;
+        cvOffset += info.numCV;
+        varyingOffset += periodic ? info.numSpans : info.numSpans + 1;
+    }
+
+    // Figure out how to read the widths.
+    GeometryScope widthScope = iWidths ? iWidthScope : kUnknownScope;
+    size_t expected = 0;
+    switch ( widthScope )
+    {
+    case kConstantScope: expected = 1; break;
+    case kUniformScope: expected = numCurves; break;
+    case kVaryingScope: expected = varyingOffset; break;
+    case kVertexScope:
+    case kFacevaryingScope: expected = cvOffset; break;
+    default: break;
+    }
+
+    if ( iWidths && expected != iNumWidths )
+    {
+        if ( iNumWidths == cvOffset ) { widthScope = kVertexScope; }
+        else if ( iNumWidths == varyingOffset ) { widthScope = kVaryingScope; }
+        else if ( iNumWidths == numCurves ) { widthScope = kUniformScope; }
+        else if ( iNumWidths >= 1 ) { widthScope = kConstantScope; }
+        else { widthScope = kUnknownScope; }
+    }
+    else if ( widthScope == kFacevaryingScope )
+    {
+        widthScope = kVertexScope;
+    }
+
+    const size_t numPolyVerts = outOffset;
+    std::vector<V3f> polyP( numPolyVerts );
+    std::vector<float> polyW( numPolyVerts );
+
+    // The cubic weight table, shared by every span of every curve.
+    std::vector<float> table( ( seg + 1 ) * 4, 0.0f );
+    for ( size_t k = 0; hasCubicBasis && k <= seg; ++k )
+    {
+        float t = static_cast<float>( k ) / static_cast<float>( seg );
+        float tv[4] = { t * t * t, t * t, t, 1.0f };
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            float w = 0.0f;
+            for ( size_t r = 0; r < 4; ++r )
+            {
+                w += tv[r] * basis[r][i];
+            }
+            table[k * 4 + i] = w;
+        }
+    }
+
+    const float defaultWidth = iSettings.defaultWidth;
+
+    Util::ParallelFor( 0, numCurves, 1024,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            float N[32];
+            for ( size_t c = iBegin; c < iEnd; ++c )
+            {
+                const CurveInfo &info = infos[c];
+                const V3f *cv = P + info.cvOffset;
+                const size_t n = info.numCV;
+                V3f *outP = polyP.empty() ? NULL : &polyP[info.outOffset];
+                float *outW = polyW.empty() ? NULL : &polyW[info.outOffset];
+
+                float uniformWidth = defaultWidth;
+                if ( widthScope == kConstantScope )
+                { uniformWidth = iWidths[0]; }
+                else if ( widthScope == kUniformScope )
+                { uniformWidth = iWidths[c]; }
+
+                const float *vtxW = widthScope == kVertexScope ?
+                    iWidths + info.cvOffset : NULL;
+                const float *varW = widthScope == kVaryingScope ?
+                    iWidths + info.varyingOffset : NULL;
+
+                if ( info.kind == kLinearKind )
+                {
+                    for ( size_t i = 0; i < info.numOut; ++i )
+                    {
+                        size_t j = i % n;
+                        outP[i] = cv[j];
+                        outW[i] = vtxW ? vtxW[j] :
+                            ( varW ? varW[j] : uniformWidth );
+                    }
+                }
+                else if ( info.kind == kCubicKind )
+                {
+                    size_t o = 0;
+                    for ( size_t s = 0; s < info.numSpans; ++s )
+                    {
+                        size_t base = s * step;
+                        size_t i0 = base % n;
+                        size_t i1 = ( base + 1 ) % n;
+                        size_t i2 = ( base + 2 ) % n;
+                        size_t i3 = ( base + 3 ) % n;
+                        const V3f &p0 = cv[i0];
+                        const V3f &p1 = cv[i1];
+                        const V3f &p2 = cv[i2];
+                        const V3f &p3 = cv[i3];
+
+                        // the last span also emits its end point
+                        size_t kEnd = ( s + 1 == info.numSpans ) ? seg + 1 : seg;
+                        for ( size_t k = 0; k < kEnd; ++k, ++o )
+                        {
+                            const float *w = &table[k * 4];
+                            outP[o] = p0 * w[0] + p1 * w[1] +
+                                p2 * w[2] + p3 * w[3];
+
+                            if ( vtxW )
+                            {
+                                outW[o] = vtxW[i0] * w[0] + vtxW[i1] * w[1] +
+                                    vtxW[i2] * w[2] + vtxW[i3] * w[3];
+                            }
+                            else if ( varW )
+                            {
+                                float t = static_cast<float>( k ) /
+                                    static_cast<float>( seg );
+                                size_t e = periodic ?
+                                    ( s + 1 ) % info.numSpans : s + 1;
+                                outW[o] = varW[s] * ( 1.0f - t ) +
+                                    varW[e] * t;
+                            }
+                            else
+                            {
+                                outW[o] = uniformWidth;
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    const size_t order = info.order;
+                    const size_t numKnots = n + order;
+
+                    std::vector<float> uniformKnots;
+                    const float *kn = NULL;
+                    if ( info.knotsValid )
+                    {
+                        kn = knots + info.knotOffset;
+                    }
+                    else
+                    {
+                        // clamped uniform knots
+                        uniformKnots.resize( numKnots );
+                        for ( size_t i = 0; i < numKnots; ++i )
+                        {
+                            size_t v = i < order ? 0 :
+                                ( i >= n ? n - order + 1 : i - order + 1 );
+                            uniformKnots[i] = static_cast<float>( v );
+                        }
+                        kn = &uniformKnots[0];
+                    }
+
+                    const float tMin = kn[order - 1];
+                    const float tMax = kn[n];
+                    const float *cvWeights = weights ?
+                        weights + info.cvOffset : NULL;
+
+                    size_t span = order - 1;
+                    for ( size_t o = 0; o < info.numOut; ++o )
+                    {
+                        float t = tMin + ( tMax - tMin ) *
+                            static_cast<float>( o ) /
+                            static_cast<float>( info.numOut - 1 );
+
+                        while ( span + 1 < n && t >= kn[span + 1] ) { ++span; }
+
+                        NurbsBasis( kn, span, order, t, N );
+
+                        V3f p( 0.0f );
+                        float denom = 0.0f;
+                        float width = 0.0f;
+                        for ( size_t j = 0; j < order; ++j )
+                        {
+                            size_t idx = span - order + 1 + j;
+                            float wj = cvWeights ? cvWeights[idx] : 1.0f;
+                            p += cv[idx] * ( N[j] * wj );
+                            denom += N[j] * wj;
+                            if ( vtxW ) { width += vtxW[idx] * N[j]; }
+                        }
+
+                        outP[o] = denom != 0.0f ? p / denom : p;
+
+                        if ( vtxW )
+                        {
+                            outW[o] = width;
+                        }
+                        else if ( varW )
+                        {
+                            float f = static_cast<float>( o ) /
+                                static_cast<float>( seg );
+                            size_t s = std::min( static_cast<size_t>( f ),
+                                                 info.numSpans - 1 );
+                            float u = f - static_cast<float>( s );
+                            size_t e = periodic ?
+                                ( s + 1 ) % info.numSpans : s + 1;
+                            outW[o] = varW[s] * ( 1.0f - u ) +
+                                varW[e] * u;
+                        }
+                        else
+                        {
+                            outW[o] = uniformWidth;
+                        }
+                    }
+                }
+            }
+        }, iSettings.numThreads );
+
+    oCurves.numVertices.resize( numCurves );
+
+    if ( iSettings.mode == kTessellatePolylines )
+    {
+        for ( size_t c = 0; c < numCurves; ++c )
+        {
+            oCurves.numVertices[c] = static_cast<int32_t>( infos[c].numOut );
+        }
+        oCurves.positions.swap( polyP );
+        oCurves.widths.swap( polyW );
+        return;
+    }
+
+    // Expand the polylines into ribbons.
+    oCurves.positions.resize( numPolyVerts * 2 );
+    oCurves.widths.resize( numPolyVerts * 2 );
+    const V3f facing = iSettings.ribbonFacing;
+
+    Util::ParallelFor( 0, numCurves, 1024,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t c = iBegin; c < iEnd; ++c )
+            {
+                const CurveInfo &info = infos[c];
+                const size_t n = info.numOut;
+                const V3f *p = n ? &polyP[info.outOffset] : NULL;
+                const float *w = n ? &polyW[info.outOffset] : NULL;
+                V3f *outP = n ? &oCurves.positions[info.outOffset * 2] : NULL;
+                float *outW = n ? &oCurves.widths[info.outOffset * 2] : NULL;
+
+                V3f lastSide( 1.0f, 0.0f, 0.0f );
+                for ( size_t i = 0; i < n; ++i )
+                {
+                    V3f tangent = p[ std::min( i + 1, n - 1 ) ] -
+                        p[ i > 0 ? i - 1 : 0 ];
+                    V3f side = tangent.cross( facing );
+                    float len = side.length();
+                    if ( len > 0.0f ) { side /= len; lastSide = side; }
+                    else { side = lastSide; }
+
+                    V3f offset = side * ( w[i] * 0.5f );
+                    outP[i * 2] = p[i] - offset;
+                    outP[i * 2 + 1] = p[i] + offset;
+                    outW[i * 2] = w[i];
+                    outW[i * 2 + 1] = w[i];
+                }
+            }
+        }, iSettings.numThreads );
+
+    for ( size_t c = 0; c < numCurves; ++c )
+    {
+        oCurves.numVertices[c] = static_cast<int32_t>( infos[c].numOut * 2 );
+    }
+}
+
+//-*****************************************************************************
+//! Reads the given sample of iSchema, including its widths, and tessellates
+//! it.
+inline void TessellateCurves( const ICurvesSchema &iSchema,
+                              const CurveTessellationSettings &iSettings,
+                              TessellatedCurves &oCurves,
+                              const Abc::ISampleSelector &iSS =
+                              Abc::ISampleSelector() )
+{
+    ICurvesSchema::Sample sample;
+    iSchema.get( sample, iSS );
+
+    IFloatGeomParam widthsParam = iSchema.getWidthsParam();
+    IFloatGeomParam::Sample widths;
+    if ( widthsParam.valid() && widthsParam.getNumSamples() > 0 )
+    {
+        widthsParam.getExpanded( widths, iSS );
+    }
+
+    const float *w = NULL;
+    size_t numW = 0;
+    if ( widths.valid() && widths.getVals()->size() > 0 )
+    {
+        w = widths.getVals()->get();
+        numW = widths.getVals()->size();
+    }
+
+    TessellateCurves( sample, w, numW,
+                      widths.valid() ? widths.getScope() : kUnknownScope,
+                      iSettings, oCurves );
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcGeom
+} // End namespace Alembic
+
+#endif
@@ -89,6 +89,58 @@ enum FilmBackXformOperationType
     kMatrixFilmBackOperation = 2
 };
 
+//-*****************************************************************************
+//! \brief Bit flags that select which fields the masked get() overloads of
+//! the IPolyMeshSchema, ISubDSchema and ICurvesSchema read into a sample.
+//! Fields that are not selected are left in their reset state and cost no
+//! I/O or decoding.  Flags that don't apply to a schema are ignored.
+//! Note that a sample missing its positions or topology reports itself as
+//! not valid().
+enum SampleFields
+{
+    kPositionsField = 1 << 0,
+    kVelocitiesField = 1 << 1,
+    kSelfBoundsField = 1 << 2,
+
+    // poly meshes and subds
+    kFaceIndicesField = 1 << 3,
+    kFaceCountsField = 1 << 4,
+
+    // subds: crease indices, lengths and sharpnesses
+    kCreasesField = 1 << 5,
+
+    // subds: corner indices and sharpnesses
+    kCornersField = 1 << 6,
+    kHolesField = 1 << 7,
+
+    // subds: scheme, interpolate boundary, face varying interpolate boundary
+    // and face varying propagate corners
+    kSubDSchemeField = 1 << 8,
+
+    // curves: type, wrap and basis
+    kCurveTypeField = 1 << 9,
+    kCurveNumVerticesField = 1 << 10,
+    kPositionWeightsField = 1 << 11,
+    kOrdersField = 1 << 12,
+    kKnotsField = 1 << 13,
+
+    kTopologyFields = kFaceIndicesField | kFaceCountsField |
+        kCurveTypeField | kCurveNumVerticesField | kOrdersField | kKnotsField,
+    kAllFields = 0x7fffffff
+};
+
+inline SampleFields operator|( SampleFields iA, SampleFields iB )
+{
+    return static_cast<SampleFields>( static_cast<int>( iA ) |
+                                      static_cast<int>( iB ) );
+}
+
+inline SampleFields operator&( SampleFields iA, SampleFields iB )
+{
+    return static_cast<SampleFields>( static_cast<int>( iA ) &
+                                      static_cast<int>( iB ) );
+}
+
 //-*****************************************************************************
 //! This utility function sets an array prorperty sample using "set" if
 //! the sample is non-null, otherwise calls setFromPrevious.
@@ -166,8 +218,8 @@ inline double RadiansToDegrees( double iRadians )
 inline bool IsGeomParam( const AbcA::PropertyHeader &iHeader )
 {
     return iHeader.isArray() || ( iHeader.isCompound() &&
-        iHeader.getMetaData().get( "podName" ) != "" &&
-        iHeader.getMetaData().get( "podExtent" ) != "" );
+        !iHeader.getMetaData().matchesValue( "podName", "" ) &&
+        !iHeader.getMetaData().matchesValue( "podExtent", "" ) );
 }
 
 } // End namespace ALEMBIC_VERSION_NS
@@ -127,7 +127,10 @@ inline void SetGeometryScope( AbcA::MetaData &ioMetaData, GeometryScope iScope )
 //-*****************************************************************************
 inline GeometryScope GetGeometryScope( const AbcA::MetaData &iMetaData )
 {
-    const std::string val = iMetaData.get( "geoScope" );
+    const std::string *found = iMetaData.getPtr( "geoScope" );
+    if ( !found ) { return kConstantScope; }
+
+    const std::string &val = *found;
     if ( val == "con" || val == "" ) { return kConstantScope; }
     else if ( val == "uni" ) { return kUniformScope; }
     else if ( val == "var" ) { return kVaryingScope; }
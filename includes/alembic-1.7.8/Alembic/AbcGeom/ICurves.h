@@ -214,6 +214,76 @@ public:
         return smp;
     }
 
+    //! Like get(), but only reads the fields selected by iFields.  Knots,
+    //! orders and position weights are skipped unless asked for.
+    void get( sample_type &oSample, SampleFields iFields,
+              const Abc::ISampleSelector &iSS = Abc::ISampleSelector() ) const
+    {
+        ALEMBIC_ABC_SAFE_CALL_BEGIN( "ICurvesSchema::get( fields )" );
+
+        oSample.reset();
+
+        if ( !valid() ) { return; }
+
+        if ( ( iFields & kCurveTypeField ) && m_basisAndTypeProperty )
+        {
+            // type, wrap, ubasis and vbasis
+            Alembic::Util::uint8_t basisAndType[4];
+            m_basisAndTypeProperty.get( basisAndType, iSS );
+
+            oSample.m_type = static_cast<CurveType>( basisAndType[0] );
+            oSample.m_wrap = static_cast<CurvePeriodicity>( basisAndType[1] );
+            oSample.m_basis = static_cast<BasisType>( basisAndType[2] );
+        }
+
+        if ( ( iFields & kSelfBoundsField ) && m_selfBoundsProperty )
+        {
+            m_selfBoundsProperty.get( oSample.m_selfBounds, iSS );
+        }
+
+        if ( iFields & kPositionsField )
+        {
+            m_positionsProperty.get( oSample.m_positions, iSS );
+        }
+
+        if ( iFields & kCurveNumVerticesField )
+        {
+            m_nVerticesProperty.get( oSample.m_nVertices, iSS );
+        }
+
+        if ( ( iFields & kPositionWeightsField ) && m_positionWeightsProperty )
+        {
+            m_positionWeightsProperty.get( oSample.m_positionWeights, iSS );
+        }
+
+        if ( ( iFields & kOrdersField ) && m_ordersProperty )
+        {
+            m_ordersProperty.get( oSample.m_orders, iSS );
+        }
+
+        if ( ( iFields & kKnotsField ) && m_knotsProperty )
+        {
+            m_knotsProperty.get( oSample.m_knots, iSS );
+        }
+
+        if ( ( iFields & kVelocitiesField ) && m_velocitiesProperty &&
+             m_velocitiesProperty.getNumSamples() > 0 )
+        {
+            m_velocitiesProperty.get( oSample.m_velocities, iSS );
+        }
+
+        ALEMBIC_ABC_SAFE_CALL_END();
+    }
+
+    sample_type getValue( SampleFields iFields,
+                          const Abc::ISampleSelector &iSS =
+                          Abc::ISampleSelector() ) const
+    {
+        sample_type smp;
+        get( smp, iFields, iSS );
+        return smp;
+    }
+
     Abc::IV3fArrayProperty getVelocitiesProperty() const
     {
         return m_velocitiesProperty;
@@ -367,8 +367,8 @@ public:
 
         if ( iMatching == kStrictMatching || iMatching == kSchemaTitleMatching )
         {
-            return iMetaData.get( "schemaBaseType" ) ==
-                GeomBaseSchemaInfo::title();
+            return iMetaData.matchesValue( "schemaBaseType",
+                                           GeomBaseSchemaInfo::title() );
         }
 
         return false;
@@ -100,13 +100,24 @@ public:
     {
         if ( iHeader.isCompound() )
         {
-            return ( iHeader.getMetaData().get( "podName" ) ==
-                    Alembic::Util::PODName( TRAITS::dataType().getPod() ) &&
-                    ( std::string() == getInterpretation() ||
-                      atoi(
-                        iHeader.getMetaData().get( "podExtent" ).c_str() ) ==
-                     TRAITS::dataType().getExtent() ) ) &&
-                    prop_type::matches( iHeader.getMetaData(), iMatching );
+            const AbcA::MetaData &md = iHeader.getMetaData();
+            if ( !md.matchesValue( "podName", Alembic::Util::PODName(
+                     TRAITS::dataType().getPod() ) ) )
+            {
+                return false;
+            }
+
+            if ( std::string() != getInterpretation() )
+            {
+                const std::string *extent = md.getPtr( "podExtent" );
+                if ( atoi( extent ? extent->c_str() : "" ) !=
+                     TRAITS::dataType().getExtent() )
+                {
+                    return false;
+                }
+            }
+
+            return prop_type::matches( md, iMatching );
         }
         else if ( iHeader.isArray() )
         {
@@ -158,9 +169,9 @@ public:
 
     size_t getArrayExtent() const
     {
-        std::string e = m_valProp.getMetaData().get( "arrayExtent" );
-        if ( e == "" ) { return 1; }
-        else { return atoi( e.c_str() ); }
+        const std::string *e = m_valProp.getMetaData().getPtr( "arrayExtent" );
+        if ( !e || e->empty() ) { return 1; }
+        else { return atoi( e->c_str() ); }
     }
 
     bool isIndexed() const { return m_isIndexed; }
@@ -204,6 +204,52 @@ public:
         return smp;
     }
 
+    //! Like get(), but only reads the fields selected by iFields, for
+    //! example kSelfBoundsField for a bounds only pass.
+    void get( Sample &oSample, SampleFields iFields,
+              const Abc::ISampleSelector &iSS = Abc::ISampleSelector() ) const
+    {
+        ALEMBIC_ABC_SAFE_CALL_BEGIN( "IPolyMeshSchema::get( fields )" );
+
+        oSample.reset();
+
+        if ( iFields & kPositionsField )
+        {
+            m_positionsProperty.get( oSample.m_positions, iSS );
+        }
+
+        if ( iFields & kFaceIndicesField )
+        {
+            m_indicesProperty.get( oSample.m_indices, iSS );
+        }
+
+        if ( iFields & kFaceCountsField )
+        {
+            m_countsProperty.get( oSample.m_counts, iSS );
+        }
+
+        if ( ( iFields & kSelfBoundsField ) && m_selfBoundsProperty )
+        {
+            m_selfBoundsProperty.get( oSample.m_selfBounds, iSS );
+        }
+
+        if ( ( iFields & kVelocitiesField ) && m_velocitiesProperty &&
+             m_velocitiesProperty.getNumSamples() > 0 )
+        {
+            m_velocitiesProperty.get( oSample.m_velocities, iSS );
+        }
+
+        ALEMBIC_ABC_SAFE_CALL_END();
+    }
+
+    Sample getValue( SampleFields iFields,
+                     const Abc::ISampleSelector &iSS = Abc::ISampleSelector() ) const
+    {
+        Sample smp;
+        get( smp, iFields, iSS );
+        return smp;
+    }
+
     IV2fGeomParam getUVsParam() const
     {
         return m_uvsParam;
@@ -261,6 +261,120 @@ public:
         return smp;
     }
 
+    //! Like get(), but only reads the fields selected by iFields.  Creases,
+    //! corners, holes and the subdivision scheme are often not needed by
+    //! tools that only look at the cage.
+    void get( Sample &oSample, SampleFields iFields,
+              const Abc::ISampleSelector &iSS = Abc::ISampleSelector() ) const
+    {
+        ALEMBIC_ABC_SAFE_CALL_BEGIN( "ISubDSchema::get( fields )" );
+
+        oSample.reset();
+
+        if ( !valid() ) { return; }
+
+        if ( iFields & kPositionsField )
+        {
+            m_positionsProperty.get( oSample.m_positions, iSS );
+        }
+
+        if ( iFields & kFaceIndicesField )
+        {
+            m_faceIndicesProperty.get( oSample.m_faceIndices, iSS );
+        }
+
+        if ( iFields & kFaceCountsField )
+        {
+            m_faceCountsProperty.get( oSample.m_faceCounts, iSS );
+        }
+
+        if ( ( iFields & kSelfBoundsField ) && m_selfBoundsProperty )
+        {
+            m_selfBoundsProperty.get( oSample.m_selfBounds, iSS );
+        }
+
+        if ( ( iFields & kVelocitiesField ) && m_velocitiesProperty &&
+             m_velocitiesProperty.getNumSamples() > 0 )
+        {
+            m_velocitiesProperty.get( oSample.m_velocities, iSS );
+        }
+
+        if ( iFields & kSubDSchemeField )
+        {
+            if ( m_subdSchemeProperty &&
+                 m_subdSchemeProperty.getNumSamples() > 0 )
+            {
+                m_subdSchemeProperty.get( oSample.m_subdScheme, iSS );
+            }
+
+            if ( m_faceVaryingInterpolateBoundaryProperty )
+            {
+                m_faceVaryingInterpolateBoundaryProperty.get(
+                    oSample.m_faceVaryingInterpolateBoundary, iSS );
+            }
+
+            if ( m_faceVaryingPropagateCornersProperty )
+            {
+                m_faceVaryingPropagateCornersProperty.get(
+                    oSample.m_faceVaryingPropagateCorners, iSS );
+            }
+
+            if ( m_interpolateBoundaryProperty )
+            {
+                m_interpolateBoundaryProperty.get(
+                    oSample.m_interpolateBoundary, iSS );
+            }
+        }
+
+        if ( iFields & kCreasesField )
+        {
+            if ( m_creaseIndicesProperty )
+            {
+                m_creaseIndicesProperty.get( oSample.m_creaseIndices, iSS );
+            }
+
+            if ( m_creaseLengthsProperty )
+            {
+                m_creaseLengthsProperty.get( oSample.m_creaseLengths, iSS );
+            }
+
+            if ( m_creaseSharpnessesProperty )
+            {
+                m_creaseSharpnessesProperty.get( oSample.m_creaseSharpnesses,
+                                                 iSS );
+            }
+        }
+
+        if ( iFields & kCornersField )
+        {
+            if ( m_cornerIndicesProperty )
+            {
+                m_cornerIndicesProperty.get( oSample.m_cornerIndices, iSS );
+            }
+
+            if ( m_cornerSharpnessesProperty )
+            {
+                m_cornerSharpnessesProperty.get( oSample.m_cornerSharpnesses,
+                                                 iSS );
+            }
+        }
+
+        if ( ( iFields & kHolesField ) && m_holesProperty )
+        {
+            m_holesProperty.get( oSample.m_holes, iSS );
+        }
+
+        ALEMBIC_ABC_SAFE_CALL_END();
+    }
+
+    Sample getValue( SampleFields iFields,
+                     const Abc::ISampleSelector &iSS = Abc::ISampleSelector() ) const
+    {
+        Sample smp;
+        get( smp, iFields, iSS );
+        return smp;
+    }
+
     Abc::IInt32ArrayProperty getFaceCountsProperty() const
     { return m_faceCountsProperty; }
     Abc::IInt32ArrayProperty getFaceIndicesProperty() const
@@ -0,0 +1,635 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcGeom_MeshWeld_h_
+#define _Alembic_AbcGeom_MeshWeld_h_
+
+#include <Alembic/Util/Export.h>
+#include <Alembic/Util/ParallelFor.h>
+#include <Alembic/AbcGeom/Foundation.h>
+#include <Alembic/AbcGeom/IPolyMesh.h>
+
+namespace Alembic {
+namespace AbcGeom {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Poly meshes index their positions, uvs and normals independently, while
+//! renderers want a single index per vertex.  Welding finds every distinct
+//! (position, uv, normal) index triple used by a face-vertex and turns it
+//! into one output vertex.
+//!
+//! The result of a weld only depends on the topology: face counts, face
+//! indices and the uv and normal indices and scopes.  It is captured in a
+//! MeshWeldRemap, which can then be replayed as a plain gather on every frame
+//! that shares the same topology digest.
+struct MeshWeldRemap
+{
+    //! Digest of the topology this remap was built from.
+    Util::Digest topologyDigest;
+
+    //! Per output vertex, the index into the positions array.
+    std::vector<uint32_t> positionIndices;
+
+    //! Per output vertex, the index into the uv values array.
+    //! Empty if the weld was built without uvs.
+    std::vector<uint32_t> uvIndices;
+
+    //! Per output vertex, the index into the normal values array.
+    //! Empty if the weld was built without normals.
+    std::vector<uint32_t> normalIndices;
+
+    //! Per face-vertex, in the order of the face indices, the output vertex
+    //! it was welded to.
+    std::vector<uint32_t> faceVertexIndices;
+
+    //! Fan triangulation of every face, as output vertex indices.  The
+    //! winding order of the source mesh is preserved.
+    std::vector<uint32_t> triangleIndices;
+
+    size_t getNumVertices() const { return positionIndices.size(); }
+    bool hasUVs() const { return !uvIndices.empty(); }
+    bool hasNormals() const { return !normalIndices.empty(); }
+};
+
+typedef Util::shared_ptr< const MeshWeldRemap > MeshWeldRemapConstPtr;
+
+//-*****************************************************************************
+//! Expands the indices of a geom param into one index per face-vertex,
+//! according to its scope.  iParamIndices may be NULL for a param without
+//! indices, in which case the value index is used directly.
+inline void GetFaceVertexParamIndices( const int32_t *iFaceCounts,
+                                       size_t iNumFaces,
+                                       const int32_t *iFaceIndices,
+                                       size_t iNumFaceVertices,
+                                       const uint32_t *iParamIndices,
+                                       size_t iNumParamIndices,
+                                       GeometryScope iScope,
+                                       std::vector<uint32_t> &oIndices )
+{
+    oIndices.resize( iNumFaceVertices );
+
+    if ( iScope == kUnknownScope )
+    {
+        iScope = iNumParamIndices == iNumFaceVertices ?
+            kFacevaryingScope : kVertexScope;
+    }
+
+    size_t fv = 0;
+    for ( size_t f = 0; f < iNumFaces && fv < iNumFaceVertices; ++f )
+    {
+        int32_t count = iFaceCounts[f];
+        for ( int32_t j = 0; j < count && fv < iNumFaceVertices; ++j, ++fv )
+        {
+            size_t src = 0;
+            switch ( iScope )
+            {
+            case kConstantScope: src = 0; break;
+            case kUniformScope: src = f; break;
+            case kVaryingScope:
+            case kVertexScope: src = ( size_t ) iFaceIndices[fv]; break;
+            default: src = fv; break;
+            }
+
+            ABCA_ASSERT( iParamIndices == NULL || src < iNumParamIndices,
+                         "Geom param index out of range while welding" );
+
+            oIndices[fv] = iParamIndices ? iParamIndices[src] :
+                static_cast<uint32_t>( src );
+        }
+    }
+}
+
+//-*****************************************************************************
+//! Builds a MeshWeldRemap from per face-vertex position, uv and normal
+//! indices.  iUVIndices and iNormalIndices may be NULL.
+//!
+//! Deduplication is sharded by hash across iNumThreads threads (0 means the
+//! hardware concurrency).  Output vertices are numbered in order of first use
+//! regardless of the thread count, so the result is deterministic.
+inline MeshWeldRemapConstPtr
+BuildMeshWeldRemap( const int32_t *iFaceCounts,
+                    size_t iNumFaces,
+                    const int32_t *iFaceIndices,
+                    size_t iNumFaceVertices,
+                    const uint32_t *iUVIndices,
+                    const uint32_t *iNormalIndices,
+                    const Util::Digest &iTopologyDigest = Util::Digest(),
+                    size_t iNumThreads = 0 )
+{
+    Util::shared_ptr< MeshWeldRemap > remap( new MeshWeldRemap() );
+    remap->topologyDigest = iTopologyDigest;
+
+    struct Corner
+    {
+        uint32_t p, uv, n;
+        bool operator==( const Corner &iRhs ) const
+        { return p == iRhs.p && uv == iRhs.uv && n == iRhs.n; }
+    };
+
+    struct CornerHash
+    {
+        size_t operator()( const Corner &iC ) const
+        {
+            uint64_t h = ( uint64_t ) iC.p * 0x9E3779B97F4A7C15ULL;
+            h ^= ( ( uint64_t ) iC.uv + 0x632BE59BD9B4E019ULL ) *
+                0xC2B2AE3D27D4EB4FULL;
+            h ^= ( ( uint64_t ) iC.n + 0x165667B19E3779F9ULL ) *
+                0x94D049BB133111EBULL;
+            return ( size_t ) ( h ^ ( h >> 29 ) );
+        }
+    };
+
+    const uint32_t none = 0;
+    std::vector<Corner> corners( iNumFaceVertices );
+    for ( size_t i = 0; i < iNumFaceVertices; ++i )
+    {
+        corners[i].p = static_cast<uint32_t>( iFaceIndices[i] );
+        corners[i].uv = iUVIndices ? iUVIndices[i] : none;
+        corners[i].n = iNormalIndices ? iNormalIndices[i] : none;
+    }
+
+    // For every face-vertex, find the first face-vertex with the same corner.
+    // Each shard owns the corners whose hash falls into it, so shards never
+    // write to the same slot.
+    std::vector<uint32_t> first( iNumFaceVertices );
+    size_t numShards = iNumThreads > 0 ? iNumThreads :
+        Util::GetDefaultNumThreads();
+    numShards = std::max( std::min( numShards,
+                                    iNumFaceVertices / 65536 + 1 ),
+                          ( size_t ) 1 );
+
+    // Bucket the face-vertices by shard once, in increasing order, so each
+    // shard only visits its own corners.
+    std::vector<uint32_t> shardOf( iNumFaceVertices );
+    Util::ParallelFor( 0, iNumFaceVertices, 1 << 16,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            CornerHash hasher;
+            for ( size_t i = iBegin; i < iEnd; ++i )
+            {
+                shardOf[i] = static_cast<uint32_t>(
+                    hasher( corners[i] ) % numShards );
+            }
+        }, iNumThreads );
+
+    std::vector<size_t> shardStart( numShards + 1, 0 );
+    for ( size_t i = 0; i < iNumFaceVertices; ++i )
+    {
+        ++shardStart[ shardOf[i] + 1 ];
+    }
+    for ( size_t s = 0; s < numShards; ++s )
+    {
+        shardStart[s + 1] += shardStart[s];
+    }
+
+    std::vector<uint32_t> byShard( iNumFaceVertices );
+    {
+        std::vector<size_t> fill( shardStart.begin(), shardStart.end() - 1 );
+        for ( size_t i = 0; i < iNumFaceVertices; ++i )
+        {
+            byShard[ fill[ shardOf[i] ]++ ] = static_cast<uint32_t>( i );
+        }
+    }
+
+    Util::ParallelFor( 0, numShards, 1,
+        [&]( size_t iShardBegin, size_t iShardEnd )
+        {
+            for ( size_t s = iShardBegin; s < iShardEnd; ++s )
+            {
+                Util::unordered_map<Corner, uint32_t, CornerHash> seen;
+                seen.reserve( shardStart[s + 1] - shardStart[s] );
+                for ( size_t k = shardStart[s]; k < shardStart[s + 1]; ++k )
+                {
+                    uint32_t i = byShard[k];
+                    first[i] = seen.insert( std::make_pair( corners[i],
+                        i ) ).first->second;
+                }
+            }
+        }, numShards );
+
+    // number the output vertices in order of first use
+    remap->faceVertexIndices.resize( iNumFaceVertices );
+    remap->positionIndices.reserve( iNumFaceVertices );
+    if ( iUVIndices ) { remap->uvIndices.reserve( iNumFaceVertices ); }
+    if ( iNormalIndices ) { remap->normalIndices.reserve( iNumFaceVertices ); }
+
+    for ( size_t i = 0; i < iNumFaceVertices; ++i )
+    {
+        if ( first[i] == i )
+        {
+            uint32_t v = static_cast<uint32_t>(
+                remap->positionIndices.size() );
+            remap->faceVertexIndices[i] = v;
+            remap->positionIndices.push_back( corners[i].p );
+            if ( iUVIndices ) { remap->uvIndices.push_back( corners[i].uv ); }
+            if ( iNormalIndices )
+            { remap->normalIndices.push_back( corners[i].n ); }
+        }
+        else
+        {
+            remap->faceVertexIndices[i] = remap->faceVertexIndices[first[i]];
+        }
+    }
+
+    // fan triangulate
+    size_t fv = 0;
+    for ( size_t f = 0; f < iNumFaces; ++f )
+    {
+        size_t count = static_cast<size_t>( std::max( iFaceCounts[f], 0 ) );
+        if ( fv + count > iNumFaceVertices ) { break; }
+
+        for ( size_t j = 2; j < count; ++j )
+        {
+            remap->triangleIndices.push_back(
+                remap->faceVertexIndices[fv] );
+            remap->triangleIndices.push_back(
+                remap->faceVertexIndices[fv + j - 1] );
+            remap->triangleIndices.push_back(
+                remap->faceVertexIndices[fv + j] );
+        }
+        fv += count;
+    }
+
+    return remap;
+}
+
+//-*****************************************************************************
+//! Gathers welded vertices into an interleaved float buffer.  Each output
+//! vertex occupies iStride floats: position (3), then uv (2) if the remap
+//! has uvs, then normal (3) if it has normals.  iStride of 0 means tightly
+//! packed.  oBuffer must hold getNumVertices() * stride floats.
+//! The gather is split into chunks over iNumThreads threads for large
+//! meshes.
+inline void GatherWeldedInterleaved( const MeshWeldRemap &iRemap,
+                                     const V3f *iPositions,
+                                     const V2f *iUVs,
+                                     const N3f *iNormals,
+                                     float *oBuffer,
+                                     size_t iStride = 0,
+                                     size_t iNumThreads = 0 )
+{
+    const bool uvs = iRemap.hasUVs() && iUVs;
+    const bool normals = iRemap.hasNormals() && iNormals;
+    const size_t packed = 3 + ( uvs ? 2 : 0 ) + ( normals ? 3 : 0 );
+    const size_t stride = iStride > 0 ? iStride : packed;
+
+    ABCA_ASSERT( stride >= packed, "Stride too small for welded vertex" );
+
+    const uint32_t *pIdx = iRemap.positionIndices.empty() ? NULL :
+        &iRemap.positionIndices.front();
+    const uint32_t *uvIdx = uvs ? &iRemap.uvIndices.front() : NULL;
+    const uint32_t *nIdx = normals ? &iRemap.normalIndices.front() : NULL;
+
+    Util::ParallelFor( 0, iRemap.getNumVertices(), 1 << 16,
+        [=]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t v = iBegin; v < iEnd; ++v )
+            {
+                float *dst = oBuffer + v * stride;
+                const V3f &p = iPositions[ pIdx[v] ];
+                dst[0] = p.x; dst[1] = p.y; dst[2] = p.z;
+                dst += 3;
+                if ( uvIdx )
+                {
+                    const V2f &uv = iUVs[ uvIdx[v] ];
+                    dst[0] = uv.x; dst[1] = uv.y;
+                    dst += 2;
+                }
+                if ( nIdx )
+                {
+                    const N3f &n = iNormals[ nIdx[v] ];
+                    dst[0] = n.x; dst[1] = n.y; dst[2] = n.z;
+                }
+            }
+        }, iNumThreads );
+}
+
+//-*****************************************************************************
+//! Gathers welded vertices into separate position, uv and normal arrays,
+//! each holding getNumVertices() elements.  oUVs and oNormals may be NULL.
+inline void GatherWeldedSoA( const MeshWeldRemap &iRemap,
+                             const V3f *iPositions,
+                             const V2f *iUVs,
+                             const N3f *iNormals,
+                             V3f *oPositions,
+                             V2f *oUVs,
+                             N3f *oNormals,
+                             size_t iNumThreads = 0 )
+{
+    const uint32_t *pIdx = iRemap.positionIndices.empty() ? NULL :
+        &iRemap.positionIndices.front();
+    const uint32_t *uvIdx = ( iRemap.hasUVs() && iUVs && oUVs ) ?
+        &iRemap.uvIndices.front() : NULL;
+    const uint32_t *nIdx = ( iRemap.hasNormals() && iNormals && oNormals ) ?
+        &iRemap.normalIndices.front() : NULL;
+
+    Util::ParallelFor( 0, iRemap.getNumVertices(), 1 << 16,
+        [=]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t v = iBegin; v < iEnd; ++v )
+            {
+                oPositions[v] = iPositions[ pIdx[v] ];
+            }
+            if ( uvIdx )
+            {
+                for ( size_t v = iBegin; v < iEnd; ++v )
+                {
+                    oUVs[v] = iUVs[ uvIdx[v] ];
+                }
+            }
+            if ( nIdx )
+            {
+                for ( size_t v = iBegin; v < iEnd; ++v )
+                {
+                    oNormals[v] = iNormals[ nIdx[v] ];
+                }
+            }
+        }, iNumThreads );
+}
+
+//-*****************************************************************************
+//! Welded, renderer ready vertex data for one sample of a poly mesh.
+struct WeldedMeshSample
+{
+    MeshWeldRemapConstPtr remap;
+
+    //! Interleaved position, uv and normal floats, see
+    //! GatherWeldedInterleaved.
+    std::vector<float> vertices;
+    size_t stride;
+
+    WeldedMeshSample() : stride( 0 ) {}
+};
+
+//-*****************************************************************************
+//! Caches MeshWeldRemaps by topology digest, so that meshes with homogeneous
+//! topology, and instances of the same mesh, only pay for the weld once.
+//! The digest is computed from the stored ArraySampleKeys of the topology
+//! properties, so looking a remap up does not read the topology itself.
+//! It is safe to use the same cache from multiple threads.
+class MeshWeldCache
+{
+public:
+    //! iNumThreads is used for building and gathering, 0 means the hardware
+    //! concurrency.
+    explicit MeshWeldCache( size_t iNumThreads = 0 )
+      : m_numThreads( iNumThreads ) {}
+
+    //! Returns the remap for the given sample of iSchema, building it if
+    //! needed.  Pass iUseUVs or iUseNormals as false to weld without them.
+    MeshWeldRemapConstPtr getRemap( const IPolyMeshSchema &iSchema,
+                                    const Abc::ISampleSelector &iSS =
+                                    Abc::ISampleSelector(),
+                                    bool iUseUVs = true,
+                                    bool iUseNormals = true )
+    {
+        IV2fGeomParam uvParam = iUseUVs ? iSchema.getUVsParam() :
+            IV2fGeomParam();
+        IN3fGeomParam nParam = iUseNormals ? iSchema.getNormalsParam() :
+            IN3fGeomParam();
+
+        Util::Digest digest = computeTopologyDigest( iSchema, uvParam,
+                                                     nParam, iSS );
+
+        {
+            Util::scoped_lock l( m_mutex );
+            std::map< Util::Digest, MeshWeldRemapConstPtr >::iterator it =
+                m_remaps.find( digest );
+            if ( it != m_remaps.end() ) { return it->second; }
+        }
+
+        Abc::Int32ArraySamplePtr counts =
+            iSchema.getFaceCountsProperty().getValue( iSS );
+        Abc::Int32ArraySamplePtr indices =
+            iSchema.getFaceIndicesProperty().getValue( iSS );
+
+        const int32_t *countsData = counts->size() ? counts->get() : NULL;
+        const int32_t *indicesData = indices->size() ? indices->get() : NULL;
+
+        std::vector<uint32_t> uvFaceVertex;
+        std::vector<uint32_t> nFaceVertex;
+        bool hasUVs = getFaceVertexIndices( uvParam, countsData,
+                                            counts->size(), indicesData,
+                                            indices->size(), iSS,
+                                            uvFaceVertex );
+        bool hasNormals = getFaceVertexIndices( nParam, countsData,
+                                                counts->size(), indicesData,
+                                                indices->size(), iSS,
+                                                nFaceVertex );
+
+        MeshWeldRemapConstPtr remap = BuildMeshWeldRemap(
+            countsData, counts->size(), indicesData, indices->size(),
+            hasUVs && !uvFaceVertex.empty() ? &uvFaceVertex.front() : NULL,
+            hasNormals && !nFaceVertex.empty() ? &nFaceVertex.front() : NULL,
+            digest, m_numThreads );
+
+        Util::scoped_lock l( m_mutex );
+        // another thread may have won the race, keep the first one
+        return m_remaps.insert( std::make_pair( digest, remap ) ).first->second;
+    }
+
+    //! Welds the given sample of iSchema.  Only positions, uv values and
+    //! normal values are read once the remap for this topology is cached.
+    void weld( const IPolyMeshSchema &iSchema,
+               WeldedMeshSample &oSample,
+               const Abc::ISampleSelector &iSS = Abc::ISampleSelector(),
+               bool iUseUVs = true,
+               bool iUseNormals = true )
+    {
+        oSample.remap = getRemap( iSchema, iSS, iUseUVs, iUseNormals );
+        const MeshWeldRemap &remap = *oSample.remap;
+
+        Abc::P3fArraySamplePtr positions =
+            iSchema.getPositionsProperty().getValue( iSS );
+
+        // The remap already holds the value indices, so only the value
+        // arrays are read.
+        Abc::V2fArraySamplePtr uvVals;
+        if ( remap.hasUVs() )
+        {
+            uvVals = iSchema.getUVsParam().getValueProperty().getValue( iSS );
+        }
+
+        Abc::N3fArraySamplePtr nVals;
+        if ( remap.hasNormals() )
+        {
+            nVals = iSchema.getNormalsParam().getValueProperty().getValue(
+                iSS );
+        }
+
+        oSample.stride = 3 + ( remap.hasUVs() ? 2 : 0 ) +
+            ( remap.hasNormals() ? 3 : 0 );
+        oSample.vertices.resize( remap.getNumVertices() * oSample.stride );
+
+        if ( oSample.vertices.empty() ) { return; }
+
+        GatherWeldedInterleaved( remap, positions->get(),
+            uvVals && uvVals->size() ? uvVals->get() : NULL,
+            nVals && nVals->size() ? nVals->get() : NULL,
+            &oSample.vertices.front(), oSample.stride, m_numThreads );
+    }
+
+    size_t size()
+    {
+        Util::scoped_lock l( m_mutex );
+        return m_remaps.size();
+    }
+
+    void clear()
+    {
+        Util::scoped_lock l( m_mutex );
+        m_remaps.clear();
+    }
+
+private:
+    template <class PARAM>
+    static bool getFaceVertexIndices( PARAM iParam,
+                                      const int32_t *iFaceCounts,
+                                      size_t iNumFaces,
+                                      const int32_t *iFaceIndices,
+                                      size_t iNumFaceVertices,
+                                      const Abc::ISampleSelector &iSS,
+                                      std::vector<uint32_t> &oIndices )
+    {
+        if ( !iParam.valid() || iParam.getNumSamples() == 0 ) { return false; }
+
+        typename PARAM::Sample samp;
+        iParam.getIndexed( samp, iSS );
+        Abc::UInt32ArraySamplePtr idx = samp.getIndices();
+
+        if ( !idx || idx->size() == 0 ) { return false; }
+
+        GetFaceVertexParamIndices( iFaceCounts, iNumFaces, iFaceIndices,
+                                   iNumFaceVertices, idx->get(), idx->size(),
+                                   samp.getScope(), oIndices );
+        return true;
+    }
+
+    template <class PARAM>
+    static void appendParamDigest( PARAM iParam,
+                                   const Abc::ISampleSelector &iSS,
+                                   std::vector<Util::Digest> &ioDigests )
+    {
+        Util::Digest d;
+        if ( !iParam.valid() || iParam.getNumSamples() == 0 )
+        {
+            ioDigests.push_back( d );
+            return;
+        }
+
+        d.words[0] = static_cast<uint64_t>( iParam.getScope() ) + 1;
+        if ( iParam.isIndexed() )
+        {
+            AbcA::ArraySampleKey key;
+            if ( iParam.getIndexProperty().getKey( key, iSS ) )
+            {
+                ioDigests.push_back( d );
+                ioDigests.push_back( key.digest );
+                return;
+            }
+        }
+
+        // not indexed, or the key is unavailable, only the size matters
+        // for the identity indices
+        Util::Dimensions dims;
+        iParam.getValueProperty().getDimensions( dims, iSS );
+        d.words[1] = dims.numPoints();
+        ioDigests.push_back( d );
+
+        if ( iParam.isIndexed() )
+        {
+            Abc::UInt32ArraySamplePtr idx =
+                iParam.getIndexProperty().getValue( iSS );
+            Util::Digest content;
+            Util::MurmurHash3_x64_128( idx->get(),
+                                       idx->size() * sizeof( uint32_t ),
+                                       sizeof( uint32_t ), content.d );
+            ioDigests.push_back( content );
+        }
+    }
+
+    static void appendPropDigest( Abc::IInt32ArrayProperty iProp,
+                                  const Abc::ISampleSelector &iSS,
+                                  std::vector<Util::Digest> &ioDigests )
+    {
+        AbcA::ArraySampleKey key;
+        if ( iProp.getKey( key, iSS ) )
+        {
+            ioDigests.push_back( key.digest );
+            return;
+        }
+
+        Abc::Int32ArraySamplePtr samp = iProp.getValue( iSS );
+        Util::Digest content;
+        Util::MurmurHash3_x64_128( samp->get(),
+                                   samp->size() * sizeof( int32_t ),
+                                   sizeof( int32_t ), content.d );
+        ioDigests.push_back( content );
+    }
+
+    static Util::Digest
+    computeTopologyDigest( const IPolyMeshSchema &iSchema,
+                           IV2fGeomParam iUVs,
+                           IN3fGeomParam iNormals,
+                           const Abc::ISampleSelector &iSS )
+    {
+        std::vector<Util::Digest> digests;
+        appendPropDigest( iSchema.getFaceCountsProperty(), iSS, digests );
+        appendPropDigest( iSchema.getFaceIndicesProperty(), iSS, digests );
+        appendParamDigest( iUVs, iSS, digests );
+        appendParamDigest( iNormals, iSS, digests );
+
+        Util::Digest ret;
+        Util::MurmurHash3_x64_128( &digests.front(),
+                                   digests.size() * sizeof( Util::Digest ),
+                                   sizeof( uint64_t ), ret.d );
+        return ret;
+    }
+
+    size_t m_numThreads;
+    Util::mutex m_mutex;
+    std::map< Util::Digest, MeshWeldRemapConstPtr > m_remaps;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcGeom
+} // End namespace Alembic
+
+#endif
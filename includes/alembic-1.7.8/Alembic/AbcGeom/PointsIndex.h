@@ -0,0 +1,549 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcGeom_PointsIndex_h_
+#define _Alembic_AbcGeom_PointsIndex_h_
+
+#include <Alembic/Util/Export.h>
+#include <Alembic/Util/ParallelFor.h>
+#include <Alembic/AbcGeom/Foundation.h>
+#include <Alembic/AbcGeom/IPoints.h>
+
+namespace Alembic {
+namespace AbcGeom {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Maps the particles of one points sample onto the particles of another by
+//! id.  Particle order and count may differ between the two samples.
+struct PointsCorrespondence
+{
+    //! Marks a particle that has no counterpart in the other sample.
+    enum { kNoMatch = 0xffffffffU };
+
+    //! For each particle of the source sample, its index in the target
+    //! sample, or kNoMatch if it died.  The mapping is one-to-one, so a
+    //! duplicate id that lost to an earlier source particle is kNoMatch.
+    std::vector<uint32_t> toTarget;
+
+    //! For each particle of the target sample, its index in the source
+    //! sample, or kNoMatch if it was born.
+    std::vector<uint32_t> toSource;
+
+    //! Number of particles present in both samples.
+    size_t numMatched;
+
+    PointsCorrespondence() : numMatched( 0 ) {}
+};
+
+typedef Util::shared_ptr< const PointsCorrespondence >
+PointsCorrespondenceConstPtr;
+
+namespace PointsIndexDetail {
+
+//-*****************************************************************************
+inline uint64_t MixId( uint64_t iId )
+{
+    iId ^= iId >> 33;
+    iId *= 0xff51afd7ed558ccdULL;
+    iId ^= iId >> 33;
+    iId *= 0xc4ceb9fe1a85ec53ULL;
+    iId ^= iId >> 33;
+    return iId;
+}
+
+//-*****************************************************************************
+// Stable, parallel partition of iIds into iNumParts buckets by hash.
+// oOrder receives the element indices grouped by bucket, in their original
+// order within each bucket, oStarts the iNumParts + 1 bucket offsets.
+inline void PartitionIds( const uint64_t *iIds, size_t iNum,
+                          size_t iNumParts, size_t iNumChunks,
+                          std::vector<uint32_t> &oOrder,
+                          std::vector<size_t> &oStarts )
+{
+    size_t chunkSize = ( iNum + iNumChunks - 1 ) / iNumChunks;
+    std::vector<size_t> counts( iNumChunks * iNumParts, 0 );
+
+    Util::ParallelFor( 0, iNumChunks, 1,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t c = iBegin; c < iEnd; ++c )
+            {
+                size_t *cnt = &counts[c * iNumParts];
+                size_t e = std::min( iNum, ( c + 1 ) * chunkSize );
+                for ( size_t i = c * chunkSize; i < e; ++i )
+                {
+                    ++cnt[ MixId( iIds[i] ) % iNumParts ];
+                }
+            }
+        }, iNumChunks );
+
+    // offsets, partition major then chunk, which keeps things stable
+    oStarts.assign( iNumParts + 1, 0 );
+    std::vector<size_t> offsets( iNumChunks * iNumParts );
+    size_t total = 0;
+    for ( size_t p = 0; p < iNumParts; ++p )
+    {
+        oStarts[p] = total;
+        for ( size_t c = 0; c < iNumChunks; ++c )
+        {
+            offsets[c * iNumParts + p] = total;
+            total += counts[c * iNumParts + p];
+        }
+    }
+    oStarts[iNumParts] = total;
+
+    oOrder.resize( iNum );
+    Util::ParallelFor( 0, iNumChunks, 1,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            for ( size_t c = iBegin; c < iEnd; ++c )
+            {
+                size_t *off = &offsets[c * iNumParts];
+                size_t e = std::min( iNum, ( c + 1 ) * chunkSize );
+                for ( size_t i = c * chunkSize; i < e; ++i )
+                {
+                    oOrder[ off[ MixId( iIds[i] ) % iNumParts ]++ ] =
+                        static_cast<uint32_t>( i );
+                }
+            }
+        }, iNumChunks );
+}
+
+} // End namespace PointsIndexDetail
+
+//-*****************************************************************************
+//! Joins two id arrays with a partitioned hash join.  Both sides are split
+//! into hash partitions in parallel, and each partition is then joined
+//! independently.  If an id appears more than once in a sample, its first
+//! occurrence wins, so the result does not depend on iNumThreads (0 means
+//! the hardware concurrency).
+inline PointsCorrespondenceConstPtr
+BuildPointsCorrespondence( const uint64_t *iSourceIds, size_t iNumSource,
+                           const uint64_t *iTargetIds, size_t iNumTarget,
+                           size_t iNumThreads = 0 )
+{
+    using namespace PointsIndexDetail;
+
+    ABCA_ASSERT( iNumSource < PointsCorrespondence::kNoMatch &&
+                 iNumTarget < PointsCorrespondence::kNoMatch,
+                 "Too many particles for a PointsCorrespondence" );
+
+    Util::shared_ptr< PointsCorrespondence > ret(
+        new PointsCorrespondence() );
+    ret->toTarget.assign( iNumSource, PointsCorrespondence::kNoMatch );
+    ret->toSource.assign( iNumTarget, PointsCorrespondence::kNoMatch );
+
+    if ( iNumSource == 0 || iNumTarget == 0 ) { return ret; }
+
+    size_t numThreads = iNumThreads > 0 ? iNumThreads :
+        Util::GetDefaultNumThreads();
+    size_t largest = std::max( iNumSource, iNumTarget );
+    size_t numChunks = std::max( std::min( numThreads,
+                                           largest / 65536 + 1 ),
+                                 ( size_t ) 1 );
+    size_t numParts = numChunks * 4;
+
+    std::vector<uint32_t> srcOrder, tgtOrder;
+    std::vector<size_t> srcStarts, tgtStarts;
+    PartitionIds( iSourceIds, iNumSource, numParts, numChunks,
+                  srcOrder, srcStarts );
+    PartitionIds( iTargetIds, iNumTarget, numParts, numChunks,
+                  tgtOrder, tgtStarts );
+
+    std::vector<size_t> matched( numParts, 0 );
+    Util::ParallelFor( 0, numParts, 1,
+        [&]( size_t iBegin, size_t iEnd )
+        {
+            Util::unordered_map<uint64_t, uint32_t> table;
+            for ( size_t p = iBegin; p < iEnd; ++p )
+            {
+                table.clear();
+                table.reserve( tgtStarts[p + 1] - tgtStarts[p] );
+                for ( size_t i = tgtStarts[p]; i < tgtStarts[p + 1]; ++i )
+                {
+                    table.insert( std::make_pair( iTargetIds[ tgtOrder[i] ],
+                                                  tgtOrder[i] ) );
+                }
+
+                for ( size_t i = srcStarts[p]; i < srcStarts[p + 1]; ++i )
+                {
+                    uint32_t s = srcOrder[i];
+                    Util::unordered_map<uint64_t, uint32_t>::const_iterator
+                        it = table.find( iSourceIds[s] );
+                    if ( it == table.end() ) { continue; }
+
+                    // only the first source particle claims a target
+                    if ( ret->toSource[ it->second ] ==
+                         PointsCorrespondence::kNoMatch )
+                    {
+                        ret->toSource[ it->second ] = s;
+                        ret->toTarget[s] = it->second;
+                        ++matched[p];
+                    }
+                }
+            }
+        }, numChunks );
+
+    for ( size_t p = 0; p < numParts; ++p )
+    {
+        ret->numMatched += matched[p];
+    }
+
+    return ret;
+}
+
+//-*****************************************************************************
+//! A uniform grid over the positions of a points sample.  Points are bucketed
+//! by a hash of their cell, and stored sorted by bucket so each cell's points
+//! are contiguous.
+class PointsGrid
+{
+public:
+    PointsGrid() : m_cellSize( 1.0f ), m_invCellSize( 1.0f ) {}
+
+    //! Builds the grid.  If iCellSize is not positive, a cell size is chosen
+    //! so that cells hold about 8 points on average.
+    PointsGrid( const V3f *iPositions, size_t iNumPoints,
+                float iCellSize = 0.0f, size_t iNumThreads = 0 )
+    {
+        build( iPositions, iNumPoints, iCellSize, iNumThreads );
+    }
+
+    void build( const V3f *iPositions, size_t iNumPoints,
+                float iCellSize = 0.0f, size_t iNumThreads = 0 )
+    {
+        m_positions.assign( iPositions, iPositions + iNumPoints );
+        m_bounds.makeEmpty();
+        for ( size_t i = 0; i < iNumPoints; ++i )
+        {
+            m_bounds.extendBy( iPositions[i] );
+        }
+
+        if ( iCellSize <= 0.0f )
+        {
+            V3f size = m_bounds.isEmpty() ? V3f( 1.0f ) : m_bounds.size();
+            float volume = std::max( size.x, 1e-6f ) *
+                std::max( size.y, 1e-6f ) * std::max( size.z, 1e-6f );
+            float cells = std::max( static_cast<float>( iNumPoints ) / 8.0f,
+                                    1.0f );
+            iCellSize = std::pow( volume / cells, 1.0f / 3.0f );
+            if ( !( iCellSize > 0.0f ) ) { iCellSize = 1.0f; }
+        }
+
+        m_cellSize = iCellSize;
+        m_invCellSize = 1.0f / iCellSize;
+
+        size_t numBuckets = 1;
+        while ( numBuckets < iNumPoints / 2 + 1 ) { numBuckets <<= 1; }
+        m_bucketStarts.assign( numBuckets + 1, 0 );
+
+        std::vector<uint32_t> bucketOf( iNumPoints );
+        Util::ParallelFor( 0, iNumPoints, 1 << 16,
+            [&]( size_t iBegin, size_t iEnd )
+            {
+                for ( size_t i = iBegin; i < iEnd; ++i )
+                {
+                    bucketOf[i] = static_cast<uint32_t>(
+                        bucket( cellOf( iPositions[i] ) ) );
+                }
+            }, iNumThreads );
+
+        for ( size_t i = 0; i < iNumPoints; ++i )
+        {
+            ++m_bucketStarts[ bucketOf[i] + 1 ];
+        }
+        for ( size_t b = 0; b < numBuckets; ++b )
+        {
+            m_bucketStarts[b + 1] += m_bucketStarts[b];
+        }
+
+        std::vector<size_t> fill( m_bucketStarts.begin(),
+                                  m_bucketStarts.end() - 1 );
+        m_indices.resize( iNumPoints );
+        for ( size_t i = 0; i < iNumPoints; ++i )
+        {
+            m_indices[ fill[ bucketOf[i] ]++ ] = static_cast<uint32_t>( i );
+        }
+    }
+
+    size_t getNumPoints() const { return m_positions.size(); }
+    float getCellSize() const { return m_cellSize; }
+    const Box3f &getBounds() const { return m_bounds; }
+
+    //! Appends the indices of all points within iRadius of iCenter.
+    void findWithinRadius( const V3f &iCenter, float iRadius,
+                           std::vector<uint32_t> &oIndices ) const
+    {
+        if ( m_positions.empty() || iRadius < 0.0f ) { return; }
+
+        V3i lo = cellOf( iCenter - V3f( iRadius ) );
+        V3i hi = cellOf( iCenter + V3f( iRadius ) );
+        float r2 = iRadius * iRadius;
+
+        // Cells that hash to the same bucket must only be scanned once.  If
+        // the query covers more cells than there are buckets, scanning every
+        // bucket is cheaper.
+        const size_t numBuckets = m_bucketStarts.size() - 1;
+        double numCells = ( double( hi.x ) - lo.x + 1 ) *
+            ( double( hi.y ) - lo.y + 1 ) * ( double( hi.z ) - lo.z + 1 );
+
+        std::vector<size_t> buckets;
+        if ( numCells >= double( numBuckets ) )
+        {
+            buckets.resize( numBuckets );
+            for ( size_t b = 0; b < numBuckets; ++b ) { buckets[b] = b; }
+        }
+        else
+        {
+            buckets.reserve( static_cast<size_t>( numCells ) );
+            for ( int z = lo.z; z <= hi.z; ++z )
+            for ( int y = lo.y; y <= hi.y; ++y )
+            for ( int x = lo.x; x <= hi.x; ++x )
+            {
+                buckets.push_back( bucket( V3i( x, y, z ) ) );
+            }
+            std::sort( buckets.begin(), buckets.end() );
+            buckets.erase( std::unique( buckets.begin(), buckets.end() ),
+                           buckets.end() );
+        }
+
+        for ( size_t j = 0; j < buckets.size(); ++j )
+        {
+            size_t b = buckets[j];
+            for ( size_t i = m_bucketStarts[b]; i < m_bucketStarts[b + 1];
+                  ++i )
+            {
+                uint32_t p = m_indices[i];
+                if ( ( m_positions[p] - iCenter ).length2() <= r2 )
+                {
+                    oIndices.push_back( p );
+                }
+            }
+        }
+    }
+
+    //! Returns the index of the point nearest iCenter, searching out to
+    //! iMaxRadius, or PointsCorrespondence::kNoMatch if there is none.
+    uint32_t findNearest( const V3f &iCenter,
+                          float iMaxRadius =
+                          std::numeric_limits<float>::max() ) const
+    {
+        uint32_t best = PointsCorrespondence::kNoMatch;
+        if ( m_positions.empty() ) { return best; }
+
+        // grow the search shell by shell until the best hit is closer than
+        // any point in an unvisited cell could be
+        V3f span = m_bounds.max - m_bounds.min;
+        float maxReach = ( m_bounds.intersects( iCenter ) ?
+            span.length() : span.length() +
+            ( iCenter - closestPointOnBounds( iCenter ) ).length() ) +
+            m_cellSize;
+        maxReach = std::min( maxReach, iMaxRadius );
+
+        float bestD2 = iMaxRadius < std::numeric_limits<float>::max() ?
+            iMaxRadius * iMaxRadius : std::numeric_limits<float>::max();
+
+        std::vector<uint32_t> found;
+        for ( float r = m_cellSize; ; r *= 2.0f )
+        {
+            found.clear();
+            float reach = std::min( r, maxReach );
+            findWithinRadius( iCenter, reach, found );
+            for ( size_t i = 0; i < found.size(); ++i )
+            {
+                float d2 = ( m_positions[ found[i] ] - iCenter ).length2();
+                if ( d2 < bestD2 || ( d2 == bestD2 && found[i] < best ) )
+                {
+                    bestD2 = d2;
+                    best = found[i];
+                }
+            }
+
+            if ( best != PointsCorrespondence::kNoMatch ||
+                 reach >= maxReach )
+            {
+                return best;
+            }
+        }
+    }
+
+private:
+    V3i cellOf( const V3f &iP ) const
+    {
+        return V3i( static_cast<int>( std::floor( iP.x * m_invCellSize ) ),
+                    static_cast<int>( std::floor( iP.y * m_invCellSize ) ),
+                    static_cast<int>( std::floor( iP.z * m_invCellSize ) ) );
+    }
+
+    size_t bucket( const V3i &iCell ) const
+    {
+        uint64_t h = static_cast<uint32_t>( iCell.x ) * 73856093ULL ^
+            static_cast<uint32_t>( iCell.y ) * 19349663ULL ^
+            static_cast<uint32_t>( iCell.z ) * 83492791ULL;
+        return static_cast<size_t>( PointsIndexDetail::MixId( h ) &
+            ( m_bucketStarts.size() - 2 ) );
+    }
+
+    V3f closestPointOnBounds( const V3f &iP ) const
+    {
+        return V3f( std::min( std::max( iP.x, m_bounds.min.x ), m_bounds.max.x ),
+                    std::min( std::max( iP.y, m_bounds.min.y ), m_bounds.max.y ),
+                    std::min( std::max( iP.z, m_bounds.min.z ), m_bounds.max.z ) );
+    }
+
+    std::vector<V3f> m_positions;
+    std::vector<uint32_t> m_indices;
+    std::vector<size_t> m_bucketStarts;
+    Box3f m_bounds;
+    float m_cellSize;
+    float m_invCellSize;
+};
+
+typedef Util::shared_ptr< const PointsGrid > PointsGridConstPtr;
+
+//-*****************************************************************************
+//! Caches PointsCorrespondences and PointsGrids by the ArraySampleKeys of the
+//! samples they were built from, so that samples shared between frames, or
+//! between objects, are only joined or indexed once.  The keys come from the
+//! archive, so a cache hit does not read the sample data.  It is safe to use
+//! the same cache from multiple threads.
+class PointsIndexCache
+{
+public:
+    explicit PointsIndexCache( size_t iNumThreads = 0 )
+      : m_numThreads( iNumThreads ) {}
+
+    //! Returns the correspondence between the ids of iSchema at iSource and
+    //! at iTarget.
+    PointsCorrespondenceConstPtr
+    getCorrespondence( const IPointsSchema &iSchema,
+                       const Abc::ISampleSelector &iSource,
+                       const Abc::ISampleSelector &iTarget )
+    {
+        Abc::IUInt64ArrayProperty ids = iSchema.getIdsProperty();
+        Abc::UInt64ArraySamplePtr srcIds, tgtIds;
+        std::pair< AbcA::ArraySampleKey, AbcA::ArraySampleKey > key(
+            getKey( ids, iSource, srcIds ), getKey( ids, iTarget, tgtIds ) );
+
+        {
+            Util::scoped_lock l( m_mutex );
+            CorrespondenceMap::iterator it = m_correspondences.find( key );
+            if ( it != m_correspondences.end() ) { return it->second; }
+        }
+
+        if ( !srcIds ) { srcIds = ids.getValue( iSource ); }
+        if ( !tgtIds ) { tgtIds = ids.getValue( iTarget ); }
+
+        PointsCorrespondenceConstPtr ret = BuildPointsCorrespondence(
+            srcIds->size() ? srcIds->get() : NULL, srcIds->size(),
+            tgtIds->size() ? tgtIds->get() : NULL, tgtIds->size(),
+            m_numThreads );
+
+        Util::scoped_lock l( m_mutex );
+        return m_correspondences.insert(
+            std::make_pair( key, ret ) ).first->second;
+    }
+
+    //! Returns a grid over the positions of iSchema at iSS.
+    PointsGridConstPtr getGrid( const IPointsSchema &iSchema,
+                                const Abc::ISampleSelector &iSS =
+                                Abc::ISampleSelector(),
+                                float iCellSize = 0.0f )
+    {
+        Abc::IP3fArrayProperty positions = iSchema.getPositionsProperty();
+        Abc::P3fArraySamplePtr samp;
+        std::pair< AbcA::ArraySampleKey, float > key(
+            getKey( positions, iSS, samp ), iCellSize );
+
+        {
+            Util::scoped_lock l( m_mutex );
+            GridMap::iterator it = m_grids.find( key );
+            if ( it != m_grids.end() ) { return it->second; }
+        }
+
+        if ( !samp ) { samp = positions.getValue( iSS ); }
+
+        PointsGridConstPtr ret( new PointsGrid(
+            samp->size() ? samp->get() : NULL, samp->size(), iCellSize,
+            m_numThreads ) );
+
+        Util::scoped_lock l( m_mutex );
+        return m_grids.insert( std::make_pair( key, ret ) ).first->second;
+    }
+
+    void clear()
+    {
+        Util::scoped_lock l( m_mutex );
+        m_correspondences.clear();
+        m_grids.clear();
+    }
+
+private:
+    //! Returns the stored key of the sample, or, if the archive can't
+    //! provide one, reads the sample into oSample and hashes it.
+    template <class PROP>
+    static AbcA::ArraySampleKey
+    getKey( PROP iProp, const Abc::ISampleSelector &iSS,
+            typename PROP::sample_ptr_type &oSample )
+    {
+        AbcA::ArraySampleKey key;
+        if ( iProp.getKey( key, iSS ) ) { return key; }
+
+        oSample = iProp.getValue( iSS );
+        key = oSample->getKey();
+        return key;
+    }
+
+    typedef std::map< std::pair< AbcA::ArraySampleKey, AbcA::ArraySampleKey >,
+                      PointsCorrespondenceConstPtr > CorrespondenceMap;
+    typedef std::map< std::pair< AbcA::ArraySampleKey, float >,
+                      PointsGridConstPtr > GridMap;
+
+    size_t m_numThreads;
+    Util::mutex m_mutex;
+    CorrespondenceMap m_correspondences;
+    GridMap m_grids;
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcGeom
+} // End namespace Alembic
+
+#endif
@@ -0,0 +1,443 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_AbcMaterial_MaterialCache_h_
+#define _Alembic_AbcMaterial_MaterialCache_h_
+
+#include <Alembic/Util/InternedString.h>
+#include <Alembic/AbcMaterial/IMaterial.h>
+#include <Alembic/AbcMaterial/MaterialAssignment.h>
+#include <Alembic/AbcMaterial/MaterialFlatten.h>
+
+#include <algorithm>
+
+namespace Alembic {
+namespace AbcMaterial {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! The result of MaterialFlatten, resolved once and stored in flat arrays.
+//! All names are interned ids (see Util::InternString and
+//! Util::GetInternedString), and shaders and network nodes refer to their
+//! parameters and connections by ranges into shared arrays.  A
+//! FlattenedMaterial never changes once built, so it can be shared by any
+//! number of threads.
+class FlattenedMaterial
+{
+public:
+    struct Parameter
+    {
+        uint32_t name;
+        Abc::ICompoundProperty parent;
+
+        //! Owned by parent, as in MaterialFlatten::ParameterEntry.
+        const AbcCoreAbstract::PropertyHeader *header;
+    };
+
+    struct Shader
+    {
+        uint32_t target;
+        uint32_t shaderType;
+        uint32_t shaderName;
+        size_t firstParameter;
+        size_t numParameters;
+    };
+
+    struct Connection
+    {
+        uint32_t inputName;
+        uint32_t connectedNodeName;
+        uint32_t connectedOutputName;
+    };
+
+    struct Terminal
+    {
+        uint32_t target;
+        uint32_t shaderType;
+        uint32_t nodeName;
+        uint32_t outputName;
+    };
+
+    struct NetworkNode
+    {
+        uint32_t name;
+
+        //! 0 (the id of "") if the node has no target or type.
+        uint32_t target;
+        uint32_t nodeType;
+
+        size_t firstParameter;
+        size_t numParameters;
+        size_t firstConnection;
+        size_t numConnections;
+    };
+
+    //! Builds from a MaterialFlatten that has had its schemas appended.
+    explicit FlattenedMaterial( MaterialFlatten &iFlatten );
+
+    //! An empty material, for objects with no material.
+    FlattenedMaterial() {}
+
+    bool empty() const { return m_shaders.empty() && m_nodes.empty(); }
+
+    const std::vector<Shader> &getShaders() const { return m_shaders; }
+    const std::vector<Terminal> &getTerminals() const { return m_terminals; }
+    const std::vector<NetworkNode> &getNetworkNodes() const { return m_nodes; }
+    const std::vector<Parameter> &getParameters() const
+    { return m_parameters; }
+    const std::vector<Connection> &getConnections() const
+    { return m_connections; }
+
+    //! Returns the shader for the interned target and shader type, or NULL.
+    const Shader *findShader( uint32_t iTarget, uint32_t iShaderType ) const
+    {
+        for ( size_t i = 0; i < m_shaders.size(); ++i )
+        {
+            if ( m_shaders[i].target == iTarget &&
+                 m_shaders[i].shaderType == iShaderType )
+            {
+                return &m_shaders[i];
+            }
+        }
+        return NULL;
+    }
+
+    //! Returns the network terminal for the interned target and shader type,
+    //! or NULL.
+    const Terminal *findTerminal( uint32_t iTarget,
+                                  uint32_t iShaderType ) const
+    {
+        for ( size_t i = 0; i < m_terminals.size(); ++i )
+        {
+            if ( m_terminals[i].target == iTarget &&
+                 m_terminals[i].shaderType == iShaderType )
+            {
+                return &m_terminals[i];
+            }
+        }
+        return NULL;
+    }
+
+    //! Returns the network node with the interned name, or NULL.  Nodes are
+    //! sorted by name id, so this is a binary search.
+    const NetworkNode *findNetworkNode( uint32_t iName ) const
+    {
+        std::vector<NetworkNode>::const_iterator it =
+            std::lower_bound( m_nodes.begin(), m_nodes.end(), iName,
+                              NodeNameLess() );
+        return ( it != m_nodes.end() && it->name == iName ) ? &( *it ) : NULL;
+    }
+
+    const Parameter *getParameters( const Shader &iShader ) const
+    {
+        return iShader.numParameters ?
+            &m_parameters[iShader.firstParameter] : NULL;
+    }
+
+    const Parameter *getParameters( const NetworkNode &iNode ) const
+    {
+        return iNode.numParameters ?
+            &m_parameters[iNode.firstParameter] : NULL;
+    }
+
+    const Connection *getConnections( const NetworkNode &iNode ) const
+    {
+        return iNode.numConnections ?
+            &m_connections[iNode.firstConnection] : NULL;
+    }
+
+private:
+    struct NodeNameLess
+    {
+        bool operator()( const NetworkNode &iNode, uint32_t iName ) const
+        { return iNode.name < iName; }
+
+        bool operator()( const NetworkNode &iA, const NetworkNode &iB ) const
+        { return iA.name < iB.name; }
+    };
+
+    void appendParameters( const MaterialFlatten::ParameterEntryVector &iParams,
+                           size_t &oFirst, size_t &oNum )
+    {
+        oFirst = m_parameters.size();
+        oNum = iParams.size();
+        for ( size_t i = 0; i < iParams.size(); ++i )
+        {
+            Parameter param;
+            param.name = Util::InternString( iParams[i].name );
+            param.parent = iParams[i].parent;
+            param.header = iParams[i].header;
+            m_parameters.push_back( param );
+        }
+    }
+
+    std::vector<Shader> m_shaders;
+    std::vector<Terminal> m_terminals;
+    std::vector<NetworkNode> m_nodes;
+    std::vector<Parameter> m_parameters;
+    std::vector<Connection> m_connections;
+};
+
+typedef Util::shared_ptr<const FlattenedMaterial> FlattenedMaterialConstPtr;
+
+//-*****************************************************************************
+inline FlattenedMaterial::FlattenedMaterial( MaterialFlatten &iFlatten )
+{
+    std::vector<std::string> targets;
+    std::vector<std::string> shaderTypes;
+    std::string str;
+
+    iFlatten.getTargetNames( targets );
+    for ( size_t i = 0; i < targets.size(); ++i )
+    {
+        iFlatten.getShaderTypesForTarget( targets[i], shaderTypes );
+        for ( size_t j = 0; j < shaderTypes.size(); ++j )
+        {
+            if ( !iFlatten.getShader( targets[i], shaderTypes[j], str ) )
+            {
+                continue;
+            }
+
+            Shader shader;
+            shader.target = Util::InternString( targets[i] );
+            shader.shaderType = Util::InternString( shaderTypes[j] );
+            shader.shaderName = Util::InternString( str );
+
+            MaterialFlatten::ParameterEntryVector params;
+            iFlatten.getShaderParameters( targets[i], shaderTypes[j], params );
+            appendParameters( params, shader.firstParameter,
+                              shader.numParameters );
+            m_shaders.push_back( shader );
+        }
+    }
+
+    std::string outputName;
+    iFlatten.getNetworkTerminalTargetNames( targets );
+    for ( size_t i = 0; i < targets.size(); ++i )
+    {
+        iFlatten.getNetworkTerminalShaderTypesForTarget( targets[i],
+                                                         shaderTypes );
+        for ( size_t j = 0; j < shaderTypes.size(); ++j )
+        {
+            if ( !iFlatten.getNetworkTerminal( targets[i], shaderTypes[j],
+                                               str, outputName ) )
+            {
+                continue;
+            }
+
+            Terminal terminal;
+            terminal.target = Util::InternString( targets[i] );
+            terminal.shaderType = Util::InternString( shaderTypes[j] );
+            terminal.nodeName = Util::InternString( str );
+            terminal.outputName = Util::InternString( outputName );
+            m_terminals.push_back( terminal );
+        }
+    }
+
+    size_t numNodes = iFlatten.getNumNetworkNodes();
+    for ( size_t i = 0; i < numNodes; ++i )
+    {
+        MaterialFlatten::NetworkNode flatNode = iFlatten.getNetworkNode( i );
+        if ( !flatNode.valid() )
+        {
+            continue;
+        }
+
+        NetworkNode node;
+        node.name = Util::InternString( flatNode.getName() );
+        node.target = flatNode.getTarget( str ) ? Util::InternString( str ) : 0;
+        node.nodeType =
+            flatNode.getNodeType( str ) ? Util::InternString( str ) : 0;
+
+        MaterialFlatten::ParameterEntryVector params;
+        flatNode.getParameters( params );
+        appendParameters( params, node.firstParameter, node.numParameters );
+
+        MaterialFlatten::NetworkNode::ConnectionVector connections;
+        flatNode.getConnections( connections );
+        node.firstConnection = m_connections.size();
+        node.numConnections = connections.size();
+        for ( size_t j = 0; j < connections.size(); ++j )
+        {
+            Connection connection;
+            connection.inputName =
+                Util::InternString( connections[j].inputName );
+            connection.connectedNodeName =
+                Util::InternString( connections[j].connectedNodeName );
+            connection.connectedOutputName =
+                Util::InternString( connections[j].connectedOutputName );
+            m_connections.push_back( connection );
+        }
+
+        m_nodes.push_back( node );
+    }
+
+    std::sort( m_nodes.begin(), m_nodes.end(), NodeNameLess() );
+}
+
+//-*****************************************************************************
+//! Flattens each distinct material assignment once and shares the result.
+//! Objects that are assigned the same material path, in the same archive,
+//! get the same FlattenedMaterial.  Objects with a local material (see
+//! hasMaterial) are cached per object, since their flattening differs from
+//! their assignment alone.
+//!
+//! Entries are keyed by the address of the archive reader, so a cache must
+//! be cleared (or destroyed) before an archive it has seen is closed.  It is
+//! safe to use from multiple threads; lookups are spread over several locks
+//! so that render threads rarely wait on each other, and a material is never
+//! flattened while a lock is held.
+class MaterialCache : private Util::noncopyable
+{
+public:
+    enum { kNumShards = 16 };
+
+    MaterialCache() : m_empty( new FlattenedMaterial() ) {}
+
+    //! Returns the flattened material for iObject, following the same rules
+    //! as MaterialFlatten( iObject, iAlternateSearchArchive ).  Objects with
+    //! no material get an empty FlattenedMaterial.
+    FlattenedMaterialConstPtr
+    get( Abc::IObject iObject,
+         Abc::IArchive iAlternateSearchArchive = Abc::IArchive() )
+    {
+        std::string path;
+        IMaterialSchema localMaterial;
+        bool isLocal = hasMaterial( iObject, localMaterial );
+
+        if ( isLocal )
+        {
+            path = iObject.getFullName();
+        }
+        else if ( !getMaterialAssignmentPath( iObject, path ) )
+        {
+            return m_empty;
+        }
+
+        Abc::IArchive archive = iAlternateSearchArchive.valid() ?
+            iAlternateSearchArchive : iObject.getArchive();
+
+        Key key;
+        key.archive = archive.getPtr().get();
+        key.isLocal = isLocal;
+        key.path = path;
+
+        Shard &shard = m_shards[KeyHash()( key ) % kNumShards];
+        {
+            Util::scoped_lock l( shard.mutex );
+            MaterialMap::const_iterator it = shard.materials.find( key );
+            if ( it != shard.materials.end() )
+            {
+                return it->second;
+            }
+        }
+
+        MaterialFlatten flatten( iObject, iAlternateSearchArchive );
+        FlattenedMaterialConstPtr material( new FlattenedMaterial( flatten ) );
+
+        // another thread may have got here first, if so use its result
+        Util::scoped_lock l( shard.mutex );
+        return shard.materials.insert(
+            std::make_pair( key, material ) ).first->second;
+    }
+
+    //! The number of distinct materials flattened so far.
+    size_t size()
+    {
+        size_t ret = 0;
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            Util::scoped_lock l( m_shards[i].mutex );
+            ret += m_shards[i].materials.size();
+        }
+        return ret;
+    }
+
+    void clear()
+    {
+        for ( size_t i = 0; i < kNumShards; ++i )
+        {
+            Util::scoped_lock l( m_shards[i].mutex );
+            m_shards[i].materials.clear();
+        }
+    }
+
+private:
+    struct Key
+    {
+        const void *archive;
+        bool isLocal;
+        std::string path;
+
+        bool operator==( const Key &iOther ) const
+        {
+            return archive == iOther.archive && isLocal == iOther.isLocal &&
+                path == iOther.path;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()( const Key &iKey ) const
+        {
+            size_t h = std::hash<std::string>()( iKey.path );
+            h ^= std::hash<const void *>()( iKey.archive ) +
+                0x9e3779b9 + ( h << 6 ) + ( h >> 2 );
+            return iKey.isLocal ? ~h : h;
+        }
+    };
+
+    typedef Util::unordered_map<Key, FlattenedMaterialConstPtr, KeyHash>
+    MaterialMap;
+
+    struct Shard
+    {
+        Util::mutex mutex;
+        MaterialMap materials;
+    };
+
+    FlattenedMaterialConstPtr m_empty;
+    Shard m_shards[kNumShards];
+};
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace AbcMaterial
+} // End namespace Alembic
+
+#endif
@@ -41,9 +41,11 @@
 #include <Alembic/Util/Digest.h>
 #include <Alembic/Util/Dimensions.h>
 #include <Alembic/Util/Exception.h>
+#include <Alembic/Util/InternedString.h>
 #include <Alembic/Util/Murmur3.h>
 #include <Alembic/Util/Naming.h>
 #include <Alembic/Util/OperatorBool.h>
+#include <Alembic/Util/ParallelFor.h>
 #include <Alembic/Util/PlainOldDataType.h>
 #include <Alembic/Util/TokenMap.h>
 #include <Alembic/Util/SpookyV2.h>
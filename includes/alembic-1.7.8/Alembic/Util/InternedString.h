@@ -0,0 +1,133 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_Util_InternedString_h_
+#define _Alembic_Util_InternedString_h_
+
+#include <Alembic/Util/Foundation.h>
+
+#include <deque>
+
+namespace Alembic {
+namespace Util {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! A shared table of unique strings.  Interning a string returns a
+//! small integer id, so strings that are compared over and over again, like
+//! schema titles and interpretations, can be compared as integers instead.
+//! The empty string is always id 0.  Ids, and the strings they refer to,
+//! stay valid for the life of the program.  There is one table per module
+//! (executable or shared library) that includes this header.  It is safe to
+//! use from multiple threads.
+class InternedStringTable : noncopyable
+{
+public:
+    //! Returns the shared table.
+    static InternedStringTable &get()
+    {
+        static InternedStringTable table;
+        return table;
+    }
+
+    //! Returns the id of iStr, adding it to the table if needed.
+    uint32_t intern( const std::string &iStr )
+    {
+        if ( iStr.empty() ) { return 0; }
+
+        scoped_lock l( m_mutex );
+        unordered_map< std::string, uint32_t >::const_iterator it =
+            m_ids.find( iStr );
+        if ( it != m_ids.end() ) { return it->second; }
+
+        uint32_t id = static_cast<uint32_t>( m_strings.size() );
+        m_strings.push_back( iStr );
+        m_ids.insert( std::make_pair( iStr, id ) );
+        return id;
+    }
+
+    //! Returns the id of iStr, or 0 if it has never been interned.
+    uint32_t find( const std::string &iStr )
+    {
+        if ( iStr.empty() ) { return 0; }
+
+        scoped_lock l( m_mutex );
+        unordered_map< std::string, uint32_t >::const_iterator it =
+            m_ids.find( iStr );
+        return it != m_ids.end() ? it->second : 0;
+    }
+
+    //! Returns the string with the given id.
+    const std::string &str( uint32_t iId )
+    {
+        scoped_lock l( m_mutex );
+        // std::deque never moves its elements when growing at the back
+        return iId < m_strings.size() ? m_strings[iId] : m_strings[0];
+    }
+
+private:
+    InternedStringTable()
+    {
+        m_strings.push_back( std::string() );
+    }
+
+    mutex m_mutex;
+    std::deque< std::string > m_strings;
+    unordered_map< std::string, uint32_t > m_ids;
+};
+
+//-*****************************************************************************
+//! Convenience wrapper for InternedStringTable::get().intern().
+inline uint32_t InternString( const std::string &iStr )
+{
+    return InternedStringTable::get().intern( iStr );
+}
+
+//-*****************************************************************************
+//! Convenience wrapper for InternedStringTable::get().str().
+inline const std::string &GetInternedString( uint32_t iId )
+{
+    return InternedStringTable::get().str( iId );
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace Util
+} // End namespace Alembic
+
+#endif
@@ -0,0 +1,148 @@
+//-*****************************************************************************
+//
+// Copyright (c) 2018,
+//  Sony Pictures Imageworks Inc. and
+//  Industrial Light & Magic, a division of Lucasfilm Entertainment Company Ltd.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//-*****************************************************************************
+
+
+#ifndef _Alembic_Util_ParallelFor_h_
+#define _Alembic_Util_ParallelFor_h_
+
+#include <Alembic/Util/Foundation.h>
+
+#include <exception>
+#include <thread>
+
+namespace Alembic {
+namespace Util {
+namespace ALEMBIC_VERSION_NS {
+
+//-*****************************************************************************
+//! Returns the number of worker threads used by ParallelFor when the caller
+//! asks for the default (0).
+inline size_t GetDefaultNumThreads()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+//-*****************************************************************************
+//! Splits [iBegin, iEnd) into contiguous chunks of at least iGrain items and
+//! calls iFunc( chunkBegin, chunkEnd ) for each of them, using up to
+//! iNumThreads threads (0 means GetDefaultNumThreads()).  The calling thread
+//! takes part in the work.  Chunks are assigned deterministically, so a
+//! chunk's range does not depend on scheduling.  If any invocation throws,
+//! the first exception is rethrown on the calling thread once every worker
+//! has finished.  If a worker thread can't be started, its chunk and the
+//! ones after it run on the calling thread instead.
+template <class FUNC>
+void ParallelFor( size_t iBegin, size_t iEnd, size_t iGrain, FUNC iFunc,
+                  size_t iNumThreads = 0 )
+{
+    if ( iEnd <= iBegin ) { return; }
+
+    size_t count = iEnd - iBegin;
+    size_t grain = std::max( iGrain, ( size_t ) 1 );
+    size_t numThreads = iNumThreads > 0 ? iNumThreads : GetDefaultNumThreads();
+    size_t numChunks = std::min( numThreads, ( count + grain - 1 ) / grain );
+
+    if ( numChunks <= 1 )
+    {
+        iFunc( iBegin, iEnd );
+        return;
+    }
+
+    size_t chunkSize = ( count + numChunks - 1 ) / numChunks;
+
+    std::vector< std::exception_ptr > errors( numChunks );
+    std::vector< std::thread > workers;
+    workers.reserve( numChunks - 1 );
+
+    // Chunks from firstInline on run on the calling thread; that is all of
+    // them past the first if a thread can't be started (std::system_error
+    // when the process is out of threads), since the workers already
+    // started must still be joined.
+    size_t firstInline = numChunks;
+
+    for ( size_t c = 1; c < numChunks; ++c )
+    {
+        size_t b = iBegin + c * chunkSize;
+        size_t e = std::min( b + chunkSize, iEnd );
+        if ( b >= e ) { break; }
+
+        try
+        {
+            workers.emplace_back( [&iFunc, &errors, b, e, c]()
+            {
+                try { iFunc( b, e ); }
+                catch ( ... ) { errors[c] = std::current_exception(); }
+            } );
+        }
+        catch ( ... )
+        {
+            firstInline = c;
+            break;
+        }
+    }
+
+    try { iFunc( iBegin, std::min( iBegin + chunkSize, iEnd ) ); }
+    catch ( ... ) { errors[0] = std::current_exception(); }
+
+    for ( size_t c = firstInline; c < numChunks; ++c )
+    {
+        size_t b = iBegin + c * chunkSize;
+        size_t e = std::min( b + chunkSize, iEnd );
+        if ( b >= e ) { break; }
+
+        try { iFunc( b, e ); }
+        catch ( ... ) { errors[c] = std::current_exception(); }
+    }
+
+    for ( size_t i = 0; i < workers.size(); ++i )
+    {
+        workers[i].join();
+    }
+
+    for ( size_t i = 0; i < errors.size(); ++i )
+    {
+        if ( errors[i] ) { std::rethrow_exception( errors[i] ); }
+    }
+}
+
+} // End namespace ALEMBIC_VERSION_NS
+
+using namespace ALEMBIC_VERSION_NS;
+
+} // End namespace Util
+} // End namespace Alembic
+
+#endif
@@ -223,6 +223,17 @@ public:
         }
     }
 
+    //! \brief This function returns a pointer to the string value
+    //!     associated with a particular token, or NULL if the map does not
+    //!     contain this token-value pair. Unlike \ref value it does not copy
+    //!     the string. The pointer is valid until the map is modified.
+    const std::string *valuePtr( const std::string &token ) const
+    {
+        const_iterator fiter = m_map.find( token );
+        return fiter != m_map.end() ? &( (*fiter).second ) : NULL;
+    }
+
+    //-*************************************************************************
     //! \brief This function is a shorthand for \ref value
     //!     It will not return a modifiable entry. To modify,
     //!     \ref setValue must be used.
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_ILM_THREAD_BVH_H
+#define INCLUDED_ILM_THREAD_BVH_H
+
+//-----------------------------------------------------------------------------
+//
+//	buildBVH (bvh, bounds, n, maxLeafSize, pool)
+//
+//	Builds an IMATH_NAMESPACE::BVH<T> like BVH<T>::build(), with
+//	the subtrees below the top splits built as tasks on a
+//	ThreadPool.  The top splits run in the calling thread, and the
+//	tree is the same as the one build() makes.
+//
+//	There are a few subtrees per worker thread, since the surface
+//	area heuristic rarely splits a range in half.  If the pool has no
+//	worker threads, buildBVH() is BVH<T>::build().
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadNamespace.h"
+#include "ImathBVH.h"
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+template <class T>
+class BVHSubtreeTask: public Task
+{
+  public:
+
+    BVHSubtreeTask (TaskGroup *group, IMATH_NAMESPACE::BVH<T> &bvh, int i):
+	Task (group), _bvh (bvh), _i (i) {}
+
+    void	execute ()	{_bvh.buildSubtree (_i);}
+
+  private:
+
+    IMATH_NAMESPACE::BVH<T> &	_bvh;
+    int				_i;
+};
+
+
+template <class T>
+void
+buildBVH (IMATH_NAMESPACE::BVH<T> &bvh,
+	  const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<T> > *bounds,
+	  size_t n,
+	  int maxLeafSize = 4,
+	  ThreadPool &pool = ThreadPool::globalThreadPool())
+{
+    int numThreads = pool.numThreads();
+
+    if (numThreads == 0)
+    {
+	bvh.build (bounds, n, maxLeafSize);
+	return;
+    }
+
+    int numSubtrees = bvh.beginBuild (bounds, n, maxLeafSize, 4 * numThreads);
+
+    {
+	//
+	// The TaskGroup destructor waits for all the tasks.
+	//
+
+	TaskGroup group;
+
+	for (int i = 0; i < numSubtrees; ++i)
+	    pool.addTask (new BVHSubtreeTask<T> (&group, bvh, i));
+    }
+
+    bvh.endBuild();
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_BVH_H
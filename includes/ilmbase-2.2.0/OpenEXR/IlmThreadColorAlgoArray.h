@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef INCLUDED_ILM_THREAD_COLOR_ALGO_ARRAY_H
+#define INCLUDED_ILM_THREAD_COLOR_ALGO_ARRAY_H
+
+//-----------------------------------------------------------------------------
+//
+//	hsv2rgbArray (hsv, rgb, n, pool)
+//	hsv2rgbPlanes (h, s, v, r, g, b, n, pool)
+//	rgb2hsvArray (rgb, hsv, n, pool)
+//	rgb2hsvPlanes (r, g, b, h, s, v, n, pool)
+//	rgb2packedArray (c, packed, n, pool)
+//	packed2rgbArray (packed, c, n, pool)
+//
+//	Convert colors like the functions of the same names in
+//	ImathColorAlgoArray.h, for Vec3<T> and Color4<T> arrays and for
+//	channel planes, with ranges of the arrays converted as tasks on a
+//	ThreadPool.  The results are the same as those of the
+//	single-threaded functions.
+//
+//	There are a few ranges per worker thread, each a whole number of
+//	colorBlockSize blocks.  If the pool has no worker threads, or the
+//	array is too short to be worth splitting, it is converted in the
+//	calling thread.
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadNamespace.h"
+#include "ImathColorAlgoArray.h"
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+//
+// Number of colors per task, or 0 if the array should be converted in
+// the calling thread.
+//
+
+inline size_t
+colorArrayChunkSize (size_t n, ThreadPool &pool)
+{
+    const size_t blockSize = IMATH_NAMESPACE::colorBlockSize;
+    const size_t minChunkSize = 16 * blockSize;
+    const size_t numThreads = pool.numThreads();
+
+    if (numThreads == 0 || n < 2 * minChunkSize)
+	return 0;
+
+    size_t chunkSize = (n + 4 * numThreads - 1) / (4 * numThreads);
+    chunkSize = (chunkSize + blockSize - 1) / blockSize * blockSize;
+    return (chunkSize < minChunkSize)? minChunkSize: chunkSize;
+}
+
+
+template <class In, class Out>
+class ColorArrayTask: public Task
+{
+  public:
+
+    typedef void (*Function) (const In *, Out *, size_t);
+
+    ColorArrayTask (TaskGroup *group,
+		    Function f,
+		    const In *in,
+		    Out *out,
+		    size_t n)
+    :
+	Task (group), _f (f), _in (in), _out (out), _n (n)
+    {}
+
+    void	execute ()	{_f (_in, _out, _n);}
+
+  private:
+
+    Function		_f;
+    const In *		_in;
+    Out *		_out;
+    size_t		_n;
+};
+
+
+template <class T>
+class ColorPlanesTask: public Task
+{
+  public:
+
+    typedef void (*Function) (const T *, const T *, const T *,
+			      T *, T *, T *, size_t);
+
+    ColorPlanesTask (TaskGroup *group,
+		     Function f,
+		     const T *in0, const T *in1, const T *in2,
+		     T *out0, T *out1, T *out2,
+		     size_t n)
+    :
+	Task (group), _f (f),
+	_in0 (in0), _in1 (in1), _in2 (in2),
+	_out0 (out0), _out1 (out1), _out2 (out2),
+	_n (n)
+    {}
+
+    void
+    execute ()
+    {
+	_f (_in0, _in1, _in2, _out0, _out1, _out2, _n);
+    }
+
+  private:
+
+    Function		_f;
+    const T *		_in0;
+    const T *		_in1;
+    const T *		_in2;
+    T *			_out0;
+    T *			_out1;
+    T *			_out2;
+    size_t		_n;
+};
+
+
+template <class In, class Out>
+void
+convertColorArray (typename ColorArrayTask<In, Out>::Function f,
+		   const In *in,
+		   Out *out,
+		   size_t n,
+		   ThreadPool &pool)
+{
+    size_t chunkSize = colorArrayChunkSize (n, pool);
+
+    if (chunkSize == 0)
+    {
+	f (in, out, n);
+	return;
+    }
+
+    {
+	//
+	// The TaskGroup destructor waits for all the tasks.
+	//
+
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new ColorArrayTask<In, Out> (&group, f,
+						       in + i, out + i,
+						       count));
+	}
+    }
+}
+
+
+template <class T>
+void
+convertColorPlanes (typename ColorPlanesTask<T>::Function f,
+		    const T *in0, const T *in1, const T *in2,
+		    T *out0, T *out1, T *out2,
+		    size_t n,
+		    ThreadPool &pool)
+{
+    size_t chunkSize = colorArrayChunkSize (n, pool);
+
+    if (chunkSize == 0)
+    {
+	f (in0, in1, in2, out0, out1, out2, n);
+	return;
+    }
+
+    {
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new ColorPlanesTask<T> (&group, f,
+						  in0 + i, in1 + i, in2 + i,
+						  out0 + i, out1 + i, out2 + i,
+						  count));
+	}
+    }
+}
+
+
+template <class T>
+void
+hsv2rgbArray (const IMATH_NAMESPACE::Vec3<T> *hsv,
+	      IMATH_NAMESPACE::Vec3<T> *rgb,
+	      size_t n,
+	      ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::hsv2rgbArray<T>, hsv, rgb, n, pool);
+}
+
+
+template <class T>
+void
+hsv2rgbArray (const IMATH_NAMESPACE::Color4<T> *hsv,
+	      IMATH_NAMESPACE::Color4<T> *rgb,
+	      size_t n,
+	      ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::hsv2rgbArray<T>, hsv, rgb, n, pool);
+}
+
+
+template <class T>
+void
+hsv2rgbPlanes (const T *h, const T *s, const T *v,
+	       T *r, T *g, T *b,
+	       size_t n,
+	       ThreadPool &pool)
+{
+    convertColorPlanes (&IMATH_NAMESPACE::hsv2rgbPlanes<T>,
+			h, s, v, r, g, b, n, pool);
+}
+
+
+template <class T>
+void
+rgb2hsvArray (const IMATH_NAMESPACE::Vec3<T> *rgb,
+	      IMATH_NAMESPACE::Vec3<T> *hsv,
+	      size_t n,
+	      ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::rgb2hsvArray<T>, rgb, hsv, n, pool);
+}
+
+
+template <class T>
+void
+rgb2hsvArray (const IMATH_NAMESPACE::Color4<T> *rgb,
+	      IMATH_NAMESPACE::Color4<T> *hsv,
+	      size_t n,
+	      ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::rgb2hsvArray<T>, rgb, hsv, n, pool);
+}
+
+
+template <class T>
+void
+rgb2hsvPlanes (const T *r, const T *g, const T *b,
+	       T *h, T *s, T *v,
+	       size_t n,
+	       ThreadPool &pool)
+{
+    convertColorPlanes (&IMATH_NAMESPACE::rgb2hsvPlanes<T>,
+			r, g, b, h, s, v, n, pool);
+}
+
+
+template <class T>
+void
+rgb2packedArray (const IMATH_NAMESPACE::Vec3<T> *c,
+		 IMATH_NAMESPACE::PackedColor *packed,
+		 size_t n,
+		 ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::rgb2packedArray<T>,
+		       c, packed, n, pool);
+}
+
+
+template <class T>
+void
+rgb2packedArray (const IMATH_NAMESPACE::Color4<T> *c,
+		 IMATH_NAMESPACE::PackedColor *packed,
+		 size_t n,
+		 ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::rgb2packedArray<T>,
+		       c, packed, n, pool);
+}
+
+
+template <class T>
+void
+packed2rgbArray (const IMATH_NAMESPACE::PackedColor *packed,
+		 IMATH_NAMESPACE::Vec3<T> *c,
+		 size_t n,
+		 ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::packed2rgbArray<T>,
+		       packed, c, n, pool);
+}
+
+
+template <class T>
+void
+packed2rgbArray (const IMATH_NAMESPACE::PackedColor *packed,
+		 IMATH_NAMESPACE::Color4<T> *c,
+		 size_t n,
+		 ThreadPool &pool)
+{
+    convertColorArray (&IMATH_NAMESPACE::packed2rgbArray<T>,
+		       packed, c, n, pool);
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_COLOR_ALGO_ARRAY_H
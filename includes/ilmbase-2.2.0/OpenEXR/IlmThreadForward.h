@@ -46,6 +46,9 @@ class ThreadPool;
 class Task;
 class TaskGroup;
 class Semaphore;
+class GraphTask;
+class TaskGraph;
+template <class T> class ResultTask;
 
 ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
 
@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef INCLUDED_ILM_THREAD_HALF_FUNCTION_H
+#define INCLUDED_ILM_THREAD_HALF_FUNCTION_H
+
+//-----------------------------------------------------------------------------
+//
+//	evaluateHalfFunction (hf, f, pool)
+//
+//	Fills in the table of a halfFunction<T> that was constructed
+//	with halfFunction<T>::DEFERRED, by calling hf.evaluate (f, first,
+//	last) for ranges of the 65536 bit patterns as tasks on a
+//	ThreadPool.  f is called from several threads at once, so it
+//	must not modify shared state.
+//
+//	applyHalfFunction (hf, x, y, n, pool)
+//
+//	Does hf.apply (x, y, n), with chunks of x and y looked up as
+//	tasks on a ThreadPool.
+//
+//	There are a few ranges or chunks per worker thread.  If the pool
+//	has no worker threads, or there are too few values to be worth
+//	splitting, the work is done in the calling thread.
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadNamespace.h"
+#include "halfFunction.h"
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+template <class T, class Function>
+class HalfFunctionEvaluateTask: public Task
+{
+  public:
+
+    HalfFunctionEvaluateTask (TaskGroup *group,
+			      halfFunction<T> &hf,
+			      Function f,
+			      int first,
+			      int last)
+    :
+	Task (group), _hf (hf), _f (f), _first (first), _last (last)
+    {}
+
+    void	execute ()	{_hf.evaluate (_f, _first, _last);}
+
+  private:
+
+    halfFunction<T> &	_hf;
+    Function		_f;
+    int			_first;
+    int			_last;
+};
+
+
+template <class T>
+class HalfFunctionApplyTask: public Task
+{
+  public:
+
+    HalfFunctionApplyTask (TaskGroup *group,
+			   const halfFunction<T> &hf,
+			   const half x[],
+			   T y[],
+			   size_t n)
+    :
+	Task (group), _hf (hf), _x (x), _y (y), _n (n)
+    {}
+
+    void	execute ()	{_hf.apply (_x, _y, _n);}
+
+  private:
+
+    const halfFunction<T> &	_hf;
+    const half *		_x;
+    T *				_y;
+    size_t			_n;
+};
+
+
+template <class T, class Function>
+void
+evaluateHalfFunction (halfFunction<T> &hf,
+		      Function f,
+		      ThreadPool &pool = ThreadPool::globalThreadPool())
+{
+    const int numThreads = pool.numThreads();
+
+    if (numThreads == 0)
+    {
+	hf.evaluate (f);
+	return;
+    }
+
+    //
+    // Functions worth tabulating in parallel are expensive enough
+    // that even the smallest ranges, 256 bit patterns, outweigh the
+    // cost of a task.
+    //
+
+    int numRanges = 4 * numThreads;
+
+    if (numRanges > 256)
+	numRanges = 256;
+
+    const int rangeSize = ((1 << 16) + numRanges - 1) / numRanges;
+
+    {
+	//
+	// The TaskGroup destructor waits for all the tasks.
+	//
+
+	TaskGroup group;
+
+	for (int first = 0; first < (1 << 16); first += rangeSize)
+	{
+	    pool.addTask (new HalfFunctionEvaluateTask<T, Function>
+			      (&group, hf, f, first, first + rangeSize));
+	}
+    }
+}
+
+
+template <class T>
+void
+applyHalfFunction (const halfFunction<T> &hf,
+		   const half x[],
+		   T y[],
+		   size_t n,
+		   ThreadPool &pool = ThreadPool::globalThreadPool())
+{
+    //
+    // A lookup costs about as much as copying the value, so chunks
+    // must be long to be worth a task.
+    //
+
+    const size_t minChunkSize = 1 << 15;
+    const size_t numThreads = pool.numThreads();
+
+    if (numThreads == 0 || n < 2 * minChunkSize)
+    {
+	hf.apply (x, y, n);
+	return;
+    }
+
+    size_t chunkSize = (n + 4 * numThreads - 1) / (4 * numThreads);
+
+    if (chunkSize < minChunkSize)
+	chunkSize = minChunkSize;
+
+    {
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new HalfFunctionApplyTask<T> (&group, hf,
+							x + i, y + i,
+							count));
+	}
+    }
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_HALF_FUNCTION_H
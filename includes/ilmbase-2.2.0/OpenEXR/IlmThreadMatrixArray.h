@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_ILM_THREAD_MATRIX_ARRAY_H
+#define INCLUDED_ILM_THREAD_MATRIX_ARRAY_H
+
+//-----------------------------------------------------------------------------
+//
+//	procrustesRotationAndTranslationArray (A, B, weights, indices,
+//					       clusterStart, numClusters,
+//					       result, doScaling, pool)
+//
+//	Fits the clusters like IMATH_NAMESPACE::
+//	procrustesRotationAndTranslationArray(), with runs of clusters
+//	fitted as tasks on a ThreadPool.  Every run is a whole number of
+//	Matrix33Block<double> widths, so the SVD blocks, and the results,
+//	are the same as those of the single-threaded function.
+//
+//	There are a few runs per worker thread, since clusters differ in
+//	size.  If the pool has no worker threads, or there is only one
+//	block of clusters, the clusters are fitted in the calling thread.
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadNamespace.h"
+#include "ImathMatrixArray.h"
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+template <class T>
+class ProcrustesTask: public Task
+{
+  public:
+
+    ProcrustesTask (TaskGroup *group,
+		    const IMATH_NAMESPACE::Vec3<T> *A,
+		    const IMATH_NAMESPACE::Vec3<T> *B,
+		    const T *weights,
+		    const size_t *indices,
+		    const size_t *clusterStart,
+		    size_t numClusters,
+		    IMATH_NAMESPACE::M44d *result,
+		    bool doScaling)
+    :
+	Task (group),
+	_A (A), _B (B), _weights (weights), _indices (indices),
+	_clusterStart (clusterStart), _numClusters (numClusters),
+	_result (result), _doScaling (doScaling)
+    {}
+
+    void
+    execute ()
+    {
+	IMATH_NAMESPACE::procrustesRotationAndTranslationArray
+	    (_A, _B, _weights, _indices, _clusterStart, _numClusters,
+	     _result, _doScaling);
+    }
+
+  private:
+
+    const IMATH_NAMESPACE::Vec3<T> *	_A;
+    const IMATH_NAMESPACE::Vec3<T> *	_B;
+    const T *				_weights;
+    const size_t *			_indices;
+    const size_t *			_clusterStart;
+    size_t				_numClusters;
+    IMATH_NAMESPACE::M44d *		_result;
+    bool				_doScaling;
+};
+
+
+template <class T>
+void
+procrustesRotationAndTranslationArray (const IMATH_NAMESPACE::Vec3<T> *A,
+				       const IMATH_NAMESPACE::Vec3<T> *B,
+				       const T *weights,
+				       const size_t *indices,
+				       const size_t *clusterStart,
+				       size_t numClusters,
+				       IMATH_NAMESPACE::M44d *result,
+				       bool doScaling,
+				       ThreadPool &pool)
+{
+    const size_t N = IMATH_NAMESPACE::Matrix33Block<double>::width;
+    const size_t numThreads = pool.numThreads();
+
+    if (numThreads == 0 || numClusters <= N)
+    {
+	IMATH_NAMESPACE::procrustesRotationAndTranslationArray
+	    (A, B, weights, indices, clusterStart, numClusters,
+	     result, doScaling);
+	return;
+    }
+
+    //
+    // Clusters per task, rounded up to whole blocks.
+    //
+
+    size_t numBlocks = (numClusters + N - 1) / N;
+    size_t blocksPerTask = (numBlocks + 4 * numThreads - 1) / (4 * numThreads);
+    size_t runLength = blocksPerTask * N;
+
+    {
+	//
+	// The TaskGroup destructor waits for all the tasks.  Each run
+	// reads its own part of clusterStart, whose entries are
+	// positions in indices, and writes its own part of result.
+	//
+
+	TaskGroup group;
+
+	for (size_t c0 = 0; c0 < numClusters; c0 += runLength)
+	{
+	    size_t count = (numClusters - c0 < runLength)?
+			   numClusters - c0: runLength;
+
+	    pool.addTask (new ProcrustesTask<T> (&group, A, B, weights,
+						 indices, clusterStart + c0,
+						 count, result + c0,
+						 doScaling));
+	}
+    }
+}
+
+
+template <class T>
+void
+procrustesRotationAndTranslationArray (const IMATH_NAMESPACE::Vec3<T> *A,
+				       const IMATH_NAMESPACE::Vec3<T> *B,
+				       const size_t *indices,
+				       const size_t *clusterStart,
+				       size_t numClusters,
+				       IMATH_NAMESPACE::M44d *result,
+				       bool doScaling,
+				       ThreadPool &pool)
+{
+    // Unweighted:
+    procrustesRotationAndTranslationArray (A, B, (const T *) 0, indices,
+					   clusterStart, numClusters,
+					   result, doScaling, pool);
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_MATRIX_ARRAY_H
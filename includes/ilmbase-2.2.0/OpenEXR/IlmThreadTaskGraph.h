@@ -0,0 +1,784 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifndef INCLUDED_ILM_THREAD_TASK_GRAPH_H
+#define INCLUDED_ILM_THREAD_TASK_GRAPH_H
+
+
+//-----------------------------------------------------------------------------
+//
+//	class GraphTask, class ResultTask<T>, class TaskGraph
+//
+//	Class TaskGraph runs a set of tasks with dependencies between
+//	them on a ThreadPool.  A task starts only after all the tasks it
+//	depends on have finished, so a pipeline of stages can be written
+//	as a graph and different stages of different items can overlap,
+//	instead of waiting for each stage to finish completely.
+//
+//	Class GraphTask is the abstract interface for a task in a graph.
+//	Derived classes implement execute(), as with class Task.  Before
+//	a task is submitted to its graph, dependsOn() adds edges from
+//	the tasks it has to wait for; those may be finished, running, or
+//	not yet submitted.  A task may create and submit new tasks (its
+//	continuations) from within execute().
+//
+//	Class ResultTask<T> is a GraphTask that computes a value of type
+//	T.  Its successors can read the value directly; other threads
+//	can wait for it with get(), as with a future.
+//
+//	Each task belongs to a stage, a small integer chosen by the
+//	application.  The graph can limit how many of its tasks run at
+//	once, both in total and per stage; for example, a limit on an
+//	I/O stage keeps a few worker threads reading while the rest work
+//	on data that has already been read.  Tasks waiting for a free
+//	slot are queued inside the graph rather than in the ThreadPool,
+//	so one graph never occupies more worker threads than its limit
+//	and no extra threads are created.  Ready tasks start in the order
+//	in which they became ready, skipping those whose stage is full.
+//
+//	If execute() throws, the exception's message is recorded in the
+//	task, and the tasks that depend on it are not executed; they get
+//	the same message.  TaskGraph::wait() does not throw; use
+//	hasException() to check the outcome.  ResultTask<T>::get() throws
+//	IEX_NAMESPACE::BaseExc if the task failed.
+//
+//	The graph owns its tasks: tasks must be created with new and are
+//	deleted by the TaskGraph destructor, which first waits for them
+//	to finish.  Do not call wait() or get() from within a task in
+//	the same graph.
+//
+//	If the ThreadPool has no worker threads, the tasks run in the
+//	thread that calls wait().
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadMutex.h"
+#include "IlmThreadSemaphore.h"
+#include "IlmThreadNamespace.h"
+#include "IexBaseExc.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <exception>
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+class TaskGraph;
+
+
+class GraphTask
+{
+  public:
+
+    //---------------------------------------------------------
+    // Constructor -- the task belongs to graph, which deletes
+    // it, and runs in the given stage.
+    //---------------------------------------------------------
+
+    GraphTask (TaskGraph *graph, int stage = 0);
+    virtual ~GraphTask ();
+
+    virtual void	execute () = 0;
+
+    //------------------------------------------------------------
+    // Make this task wait for task to finish.  Must be called
+    // before this task is submitted; task must belong to the same
+    // graph.
+    //------------------------------------------------------------
+
+    void		dependsOn (GraphTask *task);
+
+    TaskGraph *		graph ();
+    int			stage () const;
+
+    //-----------------------------------------------------------
+    // The state of the task.  These are only meaningful once the
+    // task has finished, for instance in a successor or after
+    // TaskGraph::wait().
+    //-----------------------------------------------------------
+
+    bool		finished () const;
+    bool		hasException () const;
+    const std::string &	exception () const;
+
+  private:
+
+    friend class TaskGraph;
+
+    TaskGraph *		_graph;
+    int			_stage;
+    int			_numUnfinished;
+    bool		_submitted;
+    bool		_finished;
+    bool		_hasException;
+    std::string		_exception;
+    std::vector<GraphTask *> _successors;
+
+    void operator = (const GraphTask &);	// not implemented
+    GraphTask (const GraphTask &);		// not implemented
+};
+
+
+template <class T>
+class ResultTask: public GraphTask
+{
+  public:
+
+    ResultTask (TaskGraph *graph, int stage = 0);
+
+    virtual T		compute () = 0;
+
+    //-------------------------------------------------------------
+    // Wait for the task to finish and return its result.  Throws
+    // IEX_NAMESPACE::BaseExc if the task or one of the tasks it
+    // depends on threw.  The task must have been submitted.
+    //-------------------------------------------------------------
+
+    const T &		get ();
+
+    //--------------------------------------------------------------
+    // The result, without waiting; for use by successor tasks.
+    //--------------------------------------------------------------
+
+    const T &		result () const;
+
+  private:
+
+    virtual void	execute ();
+
+    T			_result;
+};
+
+
+class TaskGraph
+{
+  public:
+
+    //-------------------------------------------------------------
+    // Constructor -- the graph's tasks run on pool, with at most
+    // maxConcurrency of them running at once; 0 means no limit
+    // other than the number of threads in the pool.
+    //-------------------------------------------------------------
+
+    TaskGraph (ThreadPool &pool = ThreadPool::globalThreadPool(),
+	       int maxConcurrency = 0);
+
+    //------------------------------------------------------------
+    // Destructor -- waits for all submitted tasks to finish, and
+    // deletes all the tasks of the graph.
+    //------------------------------------------------------------
+
+    ~TaskGraph ();
+
+
+    //-------------------------------------------------------------
+    // Limit the number of tasks of a stage that run at once; 0
+    // (the default for every stage) means no limit.  Throws
+    // IEX_NAMESPACE::ArgExc if stage is negative.
+    //-------------------------------------------------------------
+
+    void		setStageLimit (int stage, int maxConcurrency);
+
+
+    //-------------------------------------------------------------
+    // Submit a task.  It starts when the tasks it depends on have
+    // finished and a slot is free.  The tasks it depends on must
+    // be submitted too, or it never starts and wait() blocks.
+    //-------------------------------------------------------------
+
+    void		submit (GraphTask *task);
+
+
+    //------------------------------------------------------------
+    // Wait for all submitted tasks, or for one task, to finish.
+    //------------------------------------------------------------
+
+    void		wait ();
+    void		wait (GraphTask *task);
+
+
+    //-------------------------------------------------------------
+    // Whether any task has thrown, and the first message recorded.
+    //-------------------------------------------------------------
+
+    bool		hasException () const;
+    std::string		exception () const;
+
+  private:
+
+    friend class GraphTask;
+
+    class Runner;
+    friend class Runner;
+
+    void		addTask (GraphTask *task);
+    bool		canStart (const GraphTask *task) const;
+    GraphTask *		take (std::deque<GraphTask *>::iterator i);
+    GraphTask *		nextReady ();
+    bool		startReady (Lock &lock);
+    void		run (GraphTask *task);
+    void		launch (std::vector<GraphTask *> &tasks);
+    void		notify ();
+    void		sleep (Lock &lock);
+    void		waitFor (GraphTask *task);
+
+    ThreadPool &	_pool;
+    int			_maxConcurrency;
+    int			_numRunning;
+    int			_numUnfinished;
+    int			_numWaiting;
+    bool		_hasException;
+    std::string		_exception;
+    std::vector<int>	_stageLimits;
+    std::vector<int>	_stageRunning;
+    std::deque<GraphTask *> _ready;
+    std::vector<GraphTask *> _tasks;
+    Mutex		_mutex;
+    Semaphore		_wakeup;
+    TaskGroup *		_group;
+
+    void operator = (const TaskGraph &);	// not implemented
+    TaskGraph (const TaskGraph &);		// not implemented
+};
+
+
+//-----------------------------------------------------------------------------
+// Implementation
+//-----------------------------------------------------------------------------
+
+class TaskGraph::Runner: public Task
+{
+  public:
+
+    Runner (TaskGraph *graph, GraphTask *task):
+	Task (graph->_group),
+	_graph (graph),
+	_task (task)
+    {
+	// empty
+    }
+
+    virtual void
+    execute ()
+    {
+	_graph->run (_task);
+    }
+
+  private:
+
+    TaskGraph *		_graph;
+    GraphTask *		_task;
+};
+
+
+inline
+GraphTask::GraphTask (TaskGraph *graph, int stage):
+    _graph (graph),
+    _stage (stage),
+    _numUnfinished (0),
+    _submitted (false),
+    _finished (false),
+    _hasException (false)
+{
+    _graph->addTask (this);
+}
+
+
+inline
+GraphTask::~GraphTask ()
+{
+    // empty
+}
+
+
+inline void
+GraphTask::dependsOn (GraphTask *task)
+{
+    Lock lock (_graph->_mutex);
+
+    if (!task->_finished)
+    {
+	task->_successors.push_back (this);
+	++_numUnfinished;
+    }
+    else if (task->_hasException)
+    {
+	_hasException = true;
+	_exception = task->_exception;
+    }
+}
+
+
+inline TaskGraph *
+GraphTask::graph ()
+{
+    return _graph;
+}
+
+
+inline int
+GraphTask::stage () const
+{
+    return _stage;
+}
+
+
+inline bool
+GraphTask::finished () const
+{
+    Lock lock (_graph->_mutex);
+    return _finished;
+}
+
+
+inline bool
+GraphTask::hasException () const
+{
+    return _hasException;
+}
+
+
+inline const std::string &
+GraphTask::exception () const
+{
+    return _exception;
+}
+
+
+template <class T>
+ResultTask<T>::ResultTask (TaskGraph *graph, int stage):
+    GraphTask (graph, stage),
+    _result ()
+{
+    // empty
+}
+
+
+template <class T>
+void
+ResultTask<T>::execute ()
+{
+    _result = compute();
+}
+
+
+template <class T>
+const T &
+ResultTask<T>::get ()
+{
+    graph()->wait (this);
+
+    if (hasException())
+	throw IEX_NAMESPACE::BaseExc (exception());
+
+    return _result;
+}
+
+
+template <class T>
+const T &
+ResultTask<T>::result () const
+{
+    return _result;
+}
+
+
+inline
+TaskGraph::TaskGraph (ThreadPool &pool, int maxConcurrency):
+    _pool (pool),
+    _maxConcurrency (maxConcurrency),
+    _numRunning (0),
+    _numUnfinished (0),
+    _numWaiting (0),
+    _hasException (false),
+    _group (new TaskGroup)
+{
+    // empty
+}
+
+
+inline
+TaskGraph::~TaskGraph ()
+{
+    wait();
+
+    //
+    // Deleting the TaskGroup waits until the Runners have returned.
+    //
+
+    delete _group;
+
+    for (size_t i = 0; i < _tasks.size(); ++i)
+	delete _tasks[i];
+}
+
+
+inline void
+TaskGraph::setStageLimit (int stage, int maxConcurrency)
+{
+    if (stage < 0)
+	throw IEX_NAMESPACE::ArgExc ("Cannot set a concurrency limit "
+				     "for a negative task graph stage.");
+
+    Lock lock (_mutex);
+
+    if (stage >= int (_stageLimits.size()))
+    {
+	_stageLimits.resize (stage + 1, 0);
+	_stageRunning.resize (stage + 1, 0);
+    }
+
+    _stageLimits[stage] = maxConcurrency;
+
+    //
+    // A higher limit may let queued tasks start.
+    //
+
+    startReady (lock);
+}
+
+
+inline void
+TaskGraph::addTask (GraphTask *task)
+{
+    Lock lock (_mutex);
+    _tasks.push_back (task);
+}
+
+
+inline void
+TaskGraph::submit (GraphTask *task)
+{
+    Lock lock (_mutex);
+
+    if (task->_submitted)
+	return;
+
+    task->_submitted = true;
+    ++_numUnfinished;
+
+    if (task->_numUnfinished == 0)
+    {
+	_ready.push_back (task);
+	startReady (lock);
+    }
+}
+
+
+inline bool
+TaskGraph::canStart (const GraphTask *task) const
+{
+    int s = task->_stage;
+
+    if (s < 0 || s >= int (_stageLimits.size()) || _stageLimits[s] <= 0)
+	return true;
+
+    return _stageRunning[s] < _stageLimits[s];
+}
+
+
+inline GraphTask *
+TaskGraph::nextReady ()
+{
+    //
+    // Called with _mutex locked.  Take the first ready task that can
+    // start now, and count it as running.  Without worker threads,
+    // tasks are left in the queue for wait() to run.
+    //
+
+    if (_pool.numThreads() == 0)
+	return 0;
+
+    int limit = _maxConcurrency > 0? _maxConcurrency: _pool.numThreads();
+
+    if (_numRunning >= limit)
+	return 0;
+
+    for (std::deque<GraphTask *>::iterator i = _ready.begin();
+	 i != _ready.end();
+	 ++i)
+    {
+	if (canStart (*i))
+	    return take (i);
+    }
+
+    return 0;
+}
+
+
+inline GraphTask *
+TaskGraph::take (std::deque<GraphTask *>::iterator i)
+{
+    //
+    // Called with _mutex locked.  Remove a task from the ready queue
+    // and count it as running.
+    //
+
+    GraphTask *task = *i;
+    _ready.erase (i);
+    ++_numRunning;
+
+    int s = task->_stage;
+
+    if (s >= 0 && s < int (_stageRunning.size()))
+	++_stageRunning[s];
+
+    return task;
+}
+
+
+inline bool
+TaskGraph::startReady (Lock &lock)
+{
+    //
+    // Called with _mutex locked.  Hand every task that can start
+    // now to the ThreadPool, with _mutex unlocked meanwhile.
+    // Returns whether any task was started.
+    //
+
+    std::vector<GraphTask *> start;
+
+    while (GraphTask *t = nextReady())
+	start.push_back (t);
+
+    if (start.empty())
+	return false;
+
+    lock.release();
+    launch (start);
+    lock.acquire();
+    return true;
+}
+
+
+inline void
+TaskGraph::launch (std::vector<GraphTask *> &tasks)
+{
+    //
+    // Called with _mutex unlocked; the ThreadPool may run the task
+    // in this thread.
+    //
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+	_pool.addTask (new Runner (this, tasks[i]));
+
+    tasks.clear();
+}
+
+
+inline void
+TaskGraph::run (GraphTask *task)
+{
+    //
+    // Run task, which has been counted as running, then release its
+    // successors.  When this frees up ready tasks, this thread goes
+    // on with the first of them rather than queueing it in the
+    // ThreadPool, and hands the others to the pool.
+    //
+
+    std::vector<GraphTask *> start;
+
+    while (task)
+    {
+	if (!task->_hasException)
+	{
+	    try
+	    {
+		task->execute();
+	    }
+	    catch (std::exception &e)
+	    {
+		task->_hasException = true;
+		task->_exception = e.what();
+	    }
+	    catch (...)
+	    {
+		task->_hasException = true;
+		task->_exception = "Unrecognized exception in graph task.";
+	    }
+	}
+
+	GraphTask *next = 0;
+
+	{
+	    Lock lock (_mutex);
+
+	    task->_finished = true;
+	    --_numRunning;
+	    --_numUnfinished;
+
+	    int s = task->_stage;
+
+	    if (s >= 0 && s < int (_stageRunning.size()))
+		--_stageRunning[s];
+
+	    if (task->_hasException && !_hasException)
+	    {
+		_hasException = true;
+		_exception = task->_exception;
+	    }
+
+	    for (size_t i = 0; i < task->_successors.size(); ++i)
+	    {
+		GraphTask *succ = task->_successors[i];
+
+		if (task->_hasException && !succ->_hasException)
+		{
+		    succ->_hasException = true;
+		    succ->_exception = task->_exception;
+		}
+
+		if (--succ->_numUnfinished == 0 && succ->_submitted)
+		    _ready.push_back (succ);
+	    }
+
+	    while (GraphTask *t = nextReady())
+		start.push_back (t);
+
+	    if (!start.empty())
+	    {
+		next = start.front();
+		start.erase (start.begin());
+	    }
+
+	    notify();
+	}
+
+	launch (start);
+	task = next;
+    }
+}
+
+
+inline void
+TaskGraph::notify ()
+{
+    //
+    // Called with _mutex locked.  Wake up every thread in wait();
+    // they check their condition again.
+    //
+
+    while (_numWaiting > 0)
+    {
+	--_numWaiting;
+	_wakeup.post();
+    }
+}
+
+
+inline void
+TaskGraph::sleep (Lock &lock)
+{
+    //
+    // Called with _mutex locked.  Unlock it and block until the next
+    // notify().  A notify() between the two steps is not lost, since
+    // the semaphore counts it.
+    //
+
+    ++_numWaiting;
+    lock.release();
+    _wakeup.wait();
+    lock.acquire();
+}
+
+
+inline void
+TaskGraph::wait ()
+{
+    waitFor (0);
+}
+
+
+inline void
+TaskGraph::wait (GraphTask *task)
+{
+    waitFor (task);
+}
+
+
+inline void
+TaskGraph::waitFor (GraphTask *task)
+{
+    //
+    // Wait for task, or for all tasks if task is 0.  Tasks that
+    // could not start earlier (because the pool had no threads, or
+    // had fewer) are started from here.
+    //
+
+    Lock lock (_mutex);
+
+    while (task? !task->_finished: _numUnfinished > 0)
+    {
+	if (_pool.numThreads() == 0 && !_ready.empty())
+	{
+	    //
+	    // No worker threads; run the next ready task here.
+	    //
+
+	    GraphTask *t = take (_ready.begin());
+
+	    lock.release();
+	    run (t);
+	    lock.acquire();
+	}
+	else if (!startReady (lock))
+	{
+	    sleep (lock);
+	}
+    }
+}
+
+
+inline bool
+TaskGraph::hasException () const
+{
+    Lock lock (_mutex);
+    return _hasException;
+}
+
+
+inline std::string
+TaskGraph::exception () const
+{
+    Lock lock (_mutex);
+    return _exception;
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_TASK_GRAPH_H
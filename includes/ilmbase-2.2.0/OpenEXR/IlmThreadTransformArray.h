@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef INCLUDED_ILM_THREAD_TRANSFORM_ARRAY_H
+#define INCLUDED_ILM_THREAD_TRANSFORM_ARRAY_H
+
+//-----------------------------------------------------------------------------
+//
+//	multVecMatrixArray (m, src, dst, n, pool)
+//	multDirMatrixArray (m, src, dst, n, pool)
+//	multVecMatrixArray (m, srcX, srcY, srcZ, dstX, dstY, dstZ, n, pool)
+//	multDirMatrixArray (m, srcX, srcY, srcZ, dstX, dstY, dstZ, n, pool)
+//	transformArray (m, src, dst, n, pool)
+//	affineTransformArray (m, src, dst, n, pool)
+//
+//	Transform arrays like the functions of the same names in
+//	ImathTransformArray.h, with chunks of the arrays transformed as
+//	tasks on a ThreadPool.  Elements are independent, so the results
+//	are the same as those of the single-threaded functions.
+//
+//	There are a few chunks per worker thread.  If the pool has no
+//	worker threads, or the array is too short to be worth splitting,
+//	it is transformed in the calling thread.
+//
+//-----------------------------------------------------------------------------
+
+#include "IlmThreadPool.h"
+#include "IlmThreadNamespace.h"
+#include "ImathTransformArray.h"
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_ENTER
+
+//
+// Number of elements per task, or 0 if the array should be transformed
+// in the calling thread.  A chunk is never shorter than minChunkSize,
+// since a few thousand vectors take about as long to transform as a
+// task takes to schedule.
+//
+
+inline size_t
+transformArrayChunkSize (size_t n, ThreadPool &pool)
+{
+    const size_t minChunkSize = 4096;
+    const size_t numThreads = pool.numThreads();
+
+    if (numThreads == 0 || n < 2 * minChunkSize)
+	return 0;
+
+    size_t chunkSize = (n + 4 * numThreads - 1) / (4 * numThreads);
+    return (chunkSize < minChunkSize)? minChunkSize: chunkSize;
+}
+
+
+template <class S, class T>
+class VecArrayTask: public Task
+{
+  public:
+
+    VecArrayTask (TaskGroup *group,
+		  const IMATH_NAMESPACE::Matrix44<T> &m,
+		  const IMATH_NAMESPACE::Vec3<S> *src,
+		  IMATH_NAMESPACE::Vec3<S> *dst,
+		  size_t n,
+		  bool dir)
+    :
+	Task (group), _m (m), _src (src), _dst (dst), _n (n), _dir (dir)
+    {}
+
+    void
+    execute ()
+    {
+	if (_dir)
+	    IMATH_NAMESPACE::multDirMatrixArray (_m, _src, _dst, _n);
+	else
+	    IMATH_NAMESPACE::multVecMatrixArray (_m, _src, _dst, _n);
+    }
+
+  private:
+
+    const IMATH_NAMESPACE::Matrix44<T> &	_m;
+    const IMATH_NAMESPACE::Vec3<S> *		_src;
+    IMATH_NAMESPACE::Vec3<S> *			_dst;
+    size_t					_n;
+    bool					_dir;
+};
+
+
+template <class S, class T>
+class VecPlanesTask: public Task
+{
+  public:
+
+    VecPlanesTask (TaskGroup *group,
+		   const IMATH_NAMESPACE::Matrix44<T> &m,
+		   const S *srcX, const S *srcY, const S *srcZ,
+		   S *dstX, S *dstY, S *dstZ,
+		   size_t n,
+		   bool dir)
+    :
+	Task (group), _m (m),
+	_srcX (srcX), _srcY (srcY), _srcZ (srcZ),
+	_dstX (dstX), _dstY (dstY), _dstZ (dstZ),
+	_n (n), _dir (dir)
+    {}
+
+    void
+    execute ()
+    {
+	if (_dir)
+	    IMATH_NAMESPACE::multDirMatrixArray (_m, _srcX, _srcY, _srcZ,
+						 _dstX, _dstY, _dstZ, _n);
+	else
+	    IMATH_NAMESPACE::multVecMatrixArray (_m, _srcX, _srcY, _srcZ,
+						 _dstX, _dstY, _dstZ, _n);
+    }
+
+  private:
+
+    const IMATH_NAMESPACE::Matrix44<T> &	_m;
+    const S *					_srcX;
+    const S *					_srcY;
+    const S *					_srcZ;
+    S *						_dstX;
+    S *						_dstY;
+    S *						_dstZ;
+    size_t					_n;
+    bool					_dir;
+};
+
+
+template <class S, class T>
+class BoxArrayTask: public Task
+{
+  public:
+
+    BoxArrayTask (TaskGroup *group,
+		  const IMATH_NAMESPACE::Matrix44<T> &m,
+		  const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *src,
+		  IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *dst,
+		  size_t n,
+		  bool affine)
+    :
+	Task (group), _m (m), _src (src), _dst (dst), _n (n), _affine (affine)
+    {}
+
+    void
+    execute ()
+    {
+	if (_affine)
+	    IMATH_NAMESPACE::affineTransformArray (_m, _src, _dst, _n);
+	else
+	    IMATH_NAMESPACE::transformArray (_m, _src, _dst, _n);
+    }
+
+  private:
+
+    const IMATH_NAMESPACE::Matrix44<T> &			_m;
+    const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *	_src;
+    IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *		_dst;
+    size_t							_n;
+    bool							_affine;
+};
+
+
+template <class S, class T>
+void
+transformVecArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		   const IMATH_NAMESPACE::Vec3<S> *src,
+		   IMATH_NAMESPACE::Vec3<S> *dst,
+		   size_t n,
+		   bool dir,
+		   ThreadPool &pool)
+{
+    size_t chunkSize = transformArrayChunkSize (n, pool);
+
+    if (chunkSize == 0)
+    {
+	if (dir)
+	    IMATH_NAMESPACE::multDirMatrixArray (m, src, dst, n);
+	else
+	    IMATH_NAMESPACE::multVecMatrixArray (m, src, dst, n);
+
+	return;
+    }
+
+    {
+	//
+	// The TaskGroup destructor waits for all the tasks.
+	//
+
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new VecArrayTask<S, T> (&group, m, src + i, dst + i,
+						  count, dir));
+	}
+    }
+}
+
+
+template <class S, class T>
+void
+transformVecPlanes (const IMATH_NAMESPACE::Matrix44<T> &m,
+		    const S *srcX, const S *srcY, const S *srcZ,
+		    S *dstX, S *dstY, S *dstZ,
+		    size_t n,
+		    bool dir,
+		    ThreadPool &pool)
+{
+    size_t chunkSize = transformArrayChunkSize (n, pool);
+
+    if (chunkSize == 0)
+    {
+	if (dir)
+	    IMATH_NAMESPACE::multDirMatrixArray (m, srcX, srcY, srcZ,
+						 dstX, dstY, dstZ, n);
+	else
+	    IMATH_NAMESPACE::multVecMatrixArray (m, srcX, srcY, srcZ,
+						 dstX, dstY, dstZ, n);
+
+	return;
+    }
+
+    {
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new VecPlanesTask<S, T> (&group, m,
+						   srcX + i, srcY + i,
+						   srcZ + i, dstX + i,
+						   dstY + i, dstZ + i,
+						   count, dir));
+	}
+    }
+}
+
+
+template <class S, class T>
+void
+transformBoxArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		   const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *src,
+		   IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *dst,
+		   size_t n,
+		   bool affine,
+		   ThreadPool &pool)
+{
+    size_t chunkSize = transformArrayChunkSize (n, pool);
+
+    if (chunkSize == 0)
+    {
+	if (affine)
+	    IMATH_NAMESPACE::affineTransformArray (m, src, dst, n);
+	else
+	    IMATH_NAMESPACE::transformArray (m, src, dst, n);
+
+	return;
+    }
+
+    {
+	TaskGroup group;
+
+	for (size_t i = 0; i < n; i += chunkSize)
+	{
+	    size_t count = (n - i < chunkSize)? n - i: chunkSize;
+
+	    pool.addTask (new BoxArrayTask<S, T> (&group, m, src + i, dst + i,
+						  count, affine));
+	}
+    }
+}
+
+
+template <class S, class T>
+void
+multVecMatrixArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		    const IMATH_NAMESPACE::Vec3<S> *src,
+		    IMATH_NAMESPACE::Vec3<S> *dst,
+		    size_t n,
+		    ThreadPool &pool)
+{
+    transformVecArray (m, src, dst, n, false, pool);
+}
+
+
+template <class S, class T>
+void
+multDirMatrixArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		    const IMATH_NAMESPACE::Vec3<S> *src,
+		    IMATH_NAMESPACE::Vec3<S> *dst,
+		    size_t n,
+		    ThreadPool &pool)
+{
+    transformVecArray (m, src, dst, n, true, pool);
+}
+
+
+template <class S, class T>
+void
+multVecMatrixArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		    const S *srcX, const S *srcY, const S *srcZ,
+		    S *dstX, S *dstY, S *dstZ,
+		    size_t n,
+		    ThreadPool &pool)
+{
+    transformVecPlanes (m, srcX, srcY, srcZ, dstX, dstY, dstZ, n,
+			false, pool);
+}
+
+
+template <class S, class T>
+void
+multDirMatrixArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		    const S *srcX, const S *srcY, const S *srcZ,
+		    S *dstX, S *dstY, S *dstZ,
+		    size_t n,
+		    ThreadPool &pool)
+{
+    transformVecPlanes (m, srcX, srcY, srcZ, dstX, dstY, dstZ, n,
+			true, pool);
+}
+
+
+template <class S, class T>
+void
+transformArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *src,
+		IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *dst,
+		size_t n,
+		ThreadPool &pool)
+{
+    transformBoxArray (m, src, dst, n, false, pool);
+}
+
+
+template <class S, class T>
+void
+affineTransformArray (const IMATH_NAMESPACE::Matrix44<T> &m,
+		      const IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *src,
+		      IMATH_NAMESPACE::Box< IMATH_NAMESPACE::Vec3<S> > *dst,
+		      size_t n,
+		      ThreadPool &pool)
+{
+    transformBoxArray (m, src, dst, n, true, pool);
+}
+
+
+ILMTHREAD_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_ILM_THREAD_TRANSFORM_ARRAY_H
@@ -0,0 +1,1065 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef INCLUDED_IMATHBVH_H
+#define INCLUDED_IMATHBVH_H
+
+//---------------------------------------------------------------------------
+//
+//	template class BVH<T>
+//
+//	A bounding volume hierarchy over an array of Box<Vec3<T>>, for
+//	answering ray, frustum, box and nearest-point queries without
+//	testing every box.  Queries report primitive indices (positions
+//	in the array passed to build()) whose boxes pass the test; exact
+//	tests against the primitives themselves are left to the caller.
+//
+//	The tree is built top-down with a binned surface area heuristic.
+//	Nodes are stored in a flat array in depth-first order: an interior
+//	node's left child immediately follows it, and the node records the
+//	index of its right child.  Leaves record a range of the primitive
+//	index array, so each node is a box plus two ints.  A copy of the
+//	primitive boxes is kept in the same order as that array, so the
+//	boxes of a leaf are contiguous.
+//
+//	When the boxes move but the primitives stay the same (deforming
+//	geometry), refit() recomputes the node bounds bottom-up without
+//	rebuilding the tree.
+//
+//	The subtrees below the top splits don't share any data, so they
+//	can be built concurrently with beginBuild(), buildSubtree() and
+//	endBuild(); IlmThreadBVH.h does that on an IlmThread::ThreadPool.
+//
+//	Queries:
+//
+//	intersect (box, result)		indices of boxes overlapping box
+//	intersect (frustumTest, result)	indices of boxes that may be
+//					visible, see FrustumTest<T>
+//	intersect (ray, tMax, hit)	calls hit (i, tMax) for every box i
+//					the ray enters before tMax, nearer
+//					subtrees first; hit may lower tMax
+//	intersect (rays, tMax, n, hit)	the same for a packet of n rays,
+//					calling hit (ray, i, tMax[ray])
+//	closest (p, distance2, d2)	the primitive nearest to p, where
+//					distance2 (i, p) returns the squared
+//					distance from p to primitive i
+//
+//---------------------------------------------------------------------------
+
+#include "ImathBox.h"
+#include "ImathBoxAlgo.h"
+#include "ImathFrustumTest.h"
+#include "ImathLimits.h"
+#include "ImathLine.h"
+#include "ImathVec.h"
+#include "ImathNamespace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+template <class T>
+class BVH
+{
+  public:
+
+    struct Node
+    {
+	Box< Vec3<T> >	bounds;
+
+	//
+	// For a leaf, offset is the first entry of the primitive index
+	// array and count is the number of entries.  For an interior
+	// node, count is 0 and offset is the index of the right child;
+	// the left child is the next node.
+	//
+
+	int		offset;
+	int		count;
+
+	bool		isLeaf () const		{return count > 0;}
+    };
+
+    //-------------------------------------------------------------
+    //	Constructors - the default constructor makes an empty tree
+    //-------------------------------------------------------------
+
+    BVH ();
+    BVH (const Box< Vec3<T> > *bounds, size_t n, int maxLeafSize = 4);
+
+
+    //--------------------------------------------------------------
+    //	Build the tree over bounds[0] ... bounds[n-1], with at most
+    //	maxLeafSize primitives per leaf.
+    //--------------------------------------------------------------
+
+    void		build (const Box< Vec3<T> > *bounds,
+			       size_t n,
+			       int maxLeafSize = 4);
+
+
+    //--------------------------------------------------------------
+    //	build() in three steps.  beginBuild() makes the top levels of
+    //	the tree, stopping at up to maxSubtrees ranges of primitives,
+    //	and returns the number of ranges.  buildSubtree(i) builds the
+    //	subtree of range i; calls for different ranges may run at the
+    //	same time.  Once all of them have returned, endBuild() joins
+    //	the subtrees into the tree.  bounds must stay valid until
+    //	then.  The tree is the same as the one build() makes.
+    //--------------------------------------------------------------
+
+    int			beginBuild (const Box< Vec3<T> > *bounds,
+				    size_t n,
+				    int maxLeafSize,
+				    int maxSubtrees);
+
+    void		buildSubtree (int i);
+
+    void		endBuild ();
+
+
+    //------------------------------------------------------------
+    //	Recompute the node bounds from new bounds for the same n
+    //	primitives, keeping the tree structure.  Queries stay
+    //	correct, but become slower as the boxes drift away from the
+    //	layout they were built with.
+    //------------------------------------------------------------
+
+    void		refit (const Box< Vec3<T> > *bounds);
+
+    void		clear ();
+
+
+    //-------
+    //	Query
+    //-------
+
+    size_t		numNodes () const	{return _nodes.size();}
+    size_t		numPrimitives () const	{return _indices.size();}
+    const Node &	node (size_t i) const	{return _nodes[i];}
+
+    //
+    // The primitive stored at position i of the primitive index array
+    // that leaves refer to.
+    //
+
+    int			primitive (size_t i) const {return _indices[i];}
+
+    //
+    // The bounds of all the primitives (empty if there are none)
+    //
+
+    Box< Vec3<T> >	bounds () const;
+
+    void		intersect (const Box< Vec3<T> > &box,
+				   std::vector<int> &result) const;
+
+    void		intersect (const FrustumTest<T> &frustumTest,
+				   std::vector<int> &result) const;
+
+    template <class F>
+    void		intersect (const Line3<T> &ray,
+				   T tMax,
+				   F &hit) const;
+
+    template <class F>
+    void		intersect (const Line3<T> *rays,
+				   T *tMax,
+				   int numRays,
+				   F &hit) const;
+
+    template <class F>
+    int			closest (const Vec3<T> &p,
+				 F &distance2,
+				 T &minDistance2) const;
+
+  private:
+
+    enum {NUM_BINS = 16, STACK_SIZE = 64};
+
+    struct BuildRange
+    {
+	int		begin;
+	int		end;
+	int		parent;		// node whose offset is this node, or -1
+    };
+
+    //
+    // A range left for buildSubtree().  The top levels of the tree
+    // hold a placeholder node for it, with count 0 and offset
+    // -1 - (index of the range).
+    //
+
+    struct Subtree
+    {
+	int			begin;
+	int			end;
+	int			depth;
+	int			maxDepth;
+	std::vector<Node>	nodes;
+    };
+
+    void		buildRange (int begin,
+				    int end,
+				    int depth,
+				    int stopDepth,
+				    std::vector<Node> &nodes,
+				    int &maxDepth);
+
+    static T		halfArea (const Box< Vec3<T> > &b);
+
+    static bool		enters (const Box< Vec3<T> > &b,
+				const Vec3<T> &pos,
+				const Vec3<T> &invDir,
+				T tMax,
+				T &tEnter);
+
+    static T		boxDistance2 (const Box< Vec3<T> > &b,
+				      const Vec3<T> &p);
+
+    int			split (const Box< Vec3<T> > *bounds,
+			       const std::vector< Vec3<T> > &centers,
+			       const Box< Vec3<T> > &nodeBounds,
+			       int begin,
+			       int end);
+
+    std::vector<Node>	_nodes;
+    std::vector<int>	_indices;
+    std::vector< Box< Vec3<T> > > _bounds;	// in _indices order
+    int			_depth;
+
+    //
+    // Build state, between beginBuild() and endBuild()
+    //
+
+    const Box< Vec3<T> > *	_buildBounds;
+    std::vector< Vec3<T> >	_centers;
+    int				_maxLeafSize;
+    std::vector<Subtree>	_subtrees;
+};
+
+
+//------------------------------------------------------------------
+// Traversal stack: STACK_SIZE entries on the stack, or a heap array
+// for the rare trees deeper than that.
+//------------------------------------------------------------------
+
+template <int N>
+class BVHStack
+{
+  public:
+
+    explicit BVHStack (int depth)
+    : _size (0)
+    {
+	if (depth + 1 > N)
+	{
+	    _heap.resize (depth + 1);
+	    _data = &_heap[0];
+	}
+	else
+	{
+	    _data = _local;
+	}
+    }
+
+    bool	empty () const		{return _size == 0;}
+    void	push (int i)		{_data[_size++] = i;}
+    int		pop ()			{return _data[--_size];}
+
+  private:
+
+    int			_local[N];
+    std::vector<int>	_heap;
+    int *		_data;
+    int			_size;
+};
+
+
+//---------------
+// Implementation
+//---------------
+
+template <class T>
+BVH<T>::BVH ()
+: _depth (0), _buildBounds (0), _maxLeafSize (1)
+{
+    // empty
+}
+
+
+template <class T>
+BVH<T>::BVH (const Box< Vec3<T> > *bounds, size_t n, int maxLeafSize)
+: _depth (0), _buildBounds (0), _maxLeafSize (1)
+{
+    build (bounds, n, maxLeafSize);
+}
+
+
+template <class T>
+void
+BVH<T>::clear ()
+{
+    _nodes.clear();
+    _indices.clear();
+    _bounds.clear();
+    _depth = 0;
+}
+
+
+template <class T>
+inline T
+BVH<T>::halfArea (const Box< Vec3<T> > &b)
+{
+    if (b.isEmpty())
+	return 0;
+
+    Vec3<T> d = b.size();
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+
+template <class T>
+void
+BVH<T>::build (const Box< Vec3<T> > *bounds, size_t n, int maxLeafSize)
+{
+    if (beginBuild (bounds, n, maxLeafSize, 1) > 0)
+	buildSubtree (0);
+
+    endBuild();
+}
+
+
+template <class T>
+int
+BVH<T>::beginBuild (const Box< Vec3<T> > *bounds,
+		    size_t n,
+		    int maxLeafSize,
+		    int maxSubtrees)
+{
+    clear();
+    _subtrees.clear();
+
+    _buildBounds = bounds;
+    _maxLeafSize = std::max (maxLeafSize, 1);
+
+    if (n == 0)
+	return 0;
+
+    _indices.resize (n);
+    _centers.resize (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	_indices[i] = int (i);
+	_centers[i] = bounds[i].isEmpty()? Vec3<T> (0): bounds[i].center();
+    }
+
+    //
+    // Ranges still to be split at depth stopDepth are left as
+    // subtrees; there are at most 2^(stopDepth - 1) of them.
+    //
+
+    int stopDepth = 1;
+
+    while ((2 << (stopDepth - 1)) <= maxSubtrees && stopDepth < 30)
+	++stopDepth;
+
+    buildRange (0, int (n), 1, stopDepth, _nodes, _depth);
+
+    return int (_subtrees.size());
+}
+
+
+template <class T>
+void
+BVH<T>::buildSubtree (int i)
+{
+    Subtree &s = _subtrees[i];
+
+    s.nodes.reserve (2 * ((s.end - s.begin) / _maxLeafSize) + 1);
+    buildRange (s.begin, s.end, s.depth, limits<int>::max(),
+		s.nodes, s.maxDepth);
+}
+
+
+template <class T>
+void
+BVH<T>::endBuild ()
+{
+    //
+    // Splice each subtree in place of its placeholder.  The nodes of
+    // a subtree keep their order, so only the right child offsets of
+    // interior nodes need to move.
+    //
+
+    if (!_subtrees.empty())
+    {
+	std::vector<int> remap (_nodes.size());
+	int next = 0;
+
+	for (size_t i = 0; i < _nodes.size(); ++i)
+	{
+	    const Node &n = _nodes[i];
+	    remap[i] = next;
+	    next += (n.count == 0 && n.offset < 0)?
+		    int (_subtrees[-1 - n.offset].nodes.size()): 1;
+	}
+
+	std::vector<Node> nodes;
+	nodes.reserve (next);
+
+	for (size_t i = 0; i < _nodes.size(); ++i)
+	{
+	    Node n = _nodes[i];
+
+	    if (n.count == 0 && n.offset < 0)
+	    {
+		const Subtree &s = _subtrees[-1 - n.offset];
+		int base = int (nodes.size());
+
+		for (size_t j = 0; j < s.nodes.size(); ++j)
+		{
+		    Node m = s.nodes[j];
+
+		    if (!m.isLeaf())
+			m.offset += base;
+
+		    nodes.push_back (m);
+		}
+
+		_depth = std::max (_depth, s.maxDepth);
+	    }
+	    else
+	    {
+		if (!n.isLeaf())
+		    n.offset = remap[n.offset];
+
+		nodes.push_back (n);
+	    }
+	}
+
+	_nodes.swap (nodes);
+    }
+
+    _bounds.resize (_indices.size());
+
+    for (size_t i = 0; i < _indices.size(); ++i)
+	_bounds[i] = _buildBounds[_indices[i]];
+
+    _buildBounds = 0;
+    _subtrees.clear();
+    std::vector< Vec3<T> >().swap (_centers);
+}
+
+
+template <class T>
+void
+BVH<T>::buildRange (int begin,
+		    int end,
+		    int depth,
+		    int stopDepth,
+		    std::vector<Node> &nodes,
+		    int &maxDepth)
+{
+    //
+    // Ranges are processed from a stack, pushing the right half before
+    // the left so that each left child is created right after its
+    // parent and its subtree is finished before the right child.
+    //
+
+    std::vector<BuildRange> stack;
+    std::vector<int> depths;
+
+    BuildRange top = {begin, end, -1};
+    stack.push_back (top);
+    depths.push_back (depth);
+    maxDepth = depth;
+
+    while (!stack.empty())
+    {
+	BuildRange r = stack.back();
+	int d = depths.back();
+	stack.pop_back();
+	depths.pop_back();
+
+	maxDepth = std::max (maxDepth, d);
+
+	int index = int (nodes.size());
+	nodes.push_back (Node());
+
+	if (r.parent >= 0)
+	    nodes[r.parent].offset = index;
+
+	if (d >= stopDepth && r.end - r.begin > _maxLeafSize)
+	{
+	    Subtree s;
+	    s.begin = r.begin;
+	    s.end = r.end;
+	    s.depth = d;
+	    s.maxDepth = d;
+
+	    nodes[index].offset = -1 - int (_subtrees.size());
+	    nodes[index].count = 0;
+	    _subtrees.push_back (s);
+	    continue;
+	}
+
+	Box< Vec3<T> > nodeBounds;
+
+	for (int i = r.begin; i < r.end; ++i)
+	    nodeBounds.extendBy (_buildBounds[_indices[i]]);
+
+	nodes[index].bounds = nodeBounds;
+
+	if (r.end - r.begin <= _maxLeafSize)
+	{
+	    nodes[index].offset = r.begin;
+	    nodes[index].count = r.end - r.begin;
+	    continue;
+	}
+
+	int mid = split (_buildBounds, _centers, nodeBounds, r.begin, r.end);
+
+	nodes[index].offset = -1;
+	nodes[index].count = 0;
+
+	BuildRange right = {mid, r.end, index};
+	BuildRange left = {r.begin, mid, -1};
+
+	stack.push_back (right);
+	depths.push_back (d + 1);
+	stack.push_back (left);
+	depths.push_back (d + 1);
+    }
+}
+
+
+template <class T>
+int
+BVH<T>::split (const Box< Vec3<T> > *bounds,
+	       const std::vector< Vec3<T> > &centers,
+	       const Box< Vec3<T> > &nodeBounds,
+	       int begin,
+	       int end)
+{
+    //
+    // Bin the primitive centers along the longest axis of their
+    // bounds, and split at the bin boundary with the lowest surface
+    // area cost.  Falls back to splitting the range in half when the
+    // centers coincide or every primitive lands on one side.
+    //
+
+    Box< Vec3<T> > centerBounds;
+
+    for (int i = begin; i < end; ++i)
+	centerBounds.extendBy (centers[_indices[i]]);
+
+    const int axis = centerBounds.majorAxis();
+    const T lo = centerBounds.min[axis];
+    const T extent = centerBounds.max[axis] - lo;
+    int mid = (begin + end) / 2;
+
+    if (extent > 0)
+    {
+	const T scale = T (NUM_BINS) / extent;
+
+	Box< Vec3<T> > binBounds[NUM_BINS];
+	int binCounts[NUM_BINS] = {0};
+
+	for (int i = begin; i < end; ++i)
+	{
+	    int b = int ((centers[_indices[i]][axis] - lo) * scale);
+	    b = std::min (b, int (NUM_BINS) - 1);
+
+	    binBounds[b].extendBy (bounds[_indices[i]]);
+	    ++binCounts[b];
+	}
+
+	//
+	// Sweep from the right to get the cost of everything right of
+	// each boundary, then from the left to pick the cheapest one.
+	//
+
+	T rightCost[NUM_BINS];
+	Box< Vec3<T> > acc;
+	int count = 0;
+
+	for (int b = NUM_BINS - 1; b > 0; --b)
+	{
+	    acc.extendBy (binBounds[b]);
+	    count += binCounts[b];
+	    rightCost[b] = halfArea (acc) * T (count);
+	}
+
+	acc.makeEmpty();
+	count = 0;
+
+	int bestBin = -1;
+	T bestCost = limits<T>::max();
+
+	for (int b = 0; b < NUM_BINS - 1; ++b)
+	{
+	    acc.extendBy (binBounds[b]);
+	    count += binCounts[b];
+
+	    if (count == 0 || count == end - begin)
+		continue;
+
+	    T cost = halfArea (acc) * T (count) + rightCost[b + 1];
+
+	    if (cost < bestCost)
+	    {
+		bestCost = cost;
+		bestBin = b;
+	    }
+	}
+
+	if (bestBin >= 0)
+	{
+	    int *first = &_indices[0] + begin;
+	    int *last = &_indices[0] + end;
+	    int *m = first;
+
+	    for (int *i = first; i != last; ++i)
+	    {
+		int b = int ((centers[*i][axis] - lo) * scale);
+		b = std::min (b, int (NUM_BINS) - 1);
+
+		if (b <= bestBin)
+		    std::swap (*i, *m++);
+	    }
+
+	    return int (m - &_indices[0]);
+	}
+    }
+
+    return mid;
+}
+
+
+template <class T>
+void
+BVH<T>::refit (const Box< Vec3<T> > *bounds)
+{
+    //
+    // Children always follow their parent, so walking the nodes
+    // backwards visits both children before the parent.
+    //
+
+    for (int i = int (_nodes.size()) - 1; i >= 0; --i)
+    {
+	Node &n = _nodes[i];
+	Box< Vec3<T> > b;
+
+	if (n.isLeaf())
+	{
+	    for (int j = n.offset; j < n.offset + n.count; ++j)
+	    {
+		_bounds[j] = bounds[_indices[j]];
+		b.extendBy (_bounds[j]);
+	    }
+	}
+	else
+	{
+	    b.extendBy (_nodes[i + 1].bounds);
+	    b.extendBy (_nodes[n.offset].bounds);
+	}
+
+	n.bounds = b;
+    }
+}
+
+
+template <class T>
+Box< Vec3<T> >
+BVH<T>::bounds () const
+{
+    return _nodes.empty()? Box< Vec3<T> >(): _nodes[0].bounds;
+}
+
+
+template <class T>
+void
+BVH<T>::intersect (const Box< Vec3<T> > &box, std::vector<int> &result) const
+{
+    if (_nodes.empty())
+	return;
+
+    BVHStack<STACK_SIZE> stack (_depth);
+    stack.push (0);
+
+    while (!stack.empty())
+    {
+	const Node &n = _nodes[stack.pop()];
+
+	if (n.bounds.isEmpty() || !n.bounds.intersects (box))
+	    continue;
+
+	if (n.isLeaf())
+	{
+	    for (int j = n.offset; j < n.offset + n.count; ++j)
+	    {
+		if (!_bounds[j].isEmpty() && _bounds[j].intersects (box))
+		    result.push_back (_indices[j]);
+	    }
+	}
+	else
+	{
+	    stack.push (n.offset);
+	    stack.push (int (&n - &_nodes[0]) + 1);
+	}
+    }
+}
+
+
+template <class T>
+void
+BVH<T>::intersect (const FrustumTest<T> &frustumTest,
+		   std::vector<int> &result) const
+{
+    //
+    // Nodes entirely inside the frustum are pushed with their low bit
+    // set, and their subtrees are collected without further tests.
+    //
+
+    if (_nodes.empty())
+	return;
+
+    BVHStack<STACK_SIZE> stack (_depth);
+    stack.push (0);
+
+    while (!stack.empty())
+    {
+	const int entry = stack.pop();
+	const int i = entry >> 1;
+	bool inside = entry & 1;
+	const Node &n = _nodes[i];
+
+	if (!inside)
+	{
+	    if (n.bounds.isEmpty() || !frustumTest.isVisible (n.bounds))
+		continue;
+
+	    inside = frustumTest.completelyContains (n.bounds);
+	}
+
+	if (n.isLeaf())
+	{
+	    for (int j = n.offset; j < n.offset + n.count; ++j)
+	    {
+		if (!_bounds[j].isEmpty() &&
+		    (inside || frustumTest.isVisible (_bounds[j])))
+		    result.push_back (_indices[j]);
+	    }
+	}
+	else
+	{
+	    stack.push ((n.offset << 1) | int (inside));
+	    stack.push (((i + 1) << 1) | int (inside));
+	}
+    }
+}
+
+
+template <class T>
+inline bool
+BVH<T>::enters (const Box< Vec3<T> > &b,
+		const Vec3<T> &pos,
+		const Vec3<T> &invDir,
+		T tMax,
+		T &tEnter)
+{
+    //
+    // Slab test for the part of the ray between 0 and tMax.
+    //
+
+    if (b.isEmpty())
+	return false;
+
+    T t0 = 0;
+    T t1 = tMax;
+
+    for (int a = 0; a < 3; ++a)
+    {
+	T tNear = (b.min[a] - pos[a]) * invDir[a];
+	T tFar = (b.max[a] - pos[a]) * invDir[a];
+
+	if (tNear > tFar)
+	    std::swap (tNear, tFar);
+
+	t0 = (tNear > t0)? tNear: t0;
+	t1 = (tFar < t1)? tFar: t1;
+    }
+
+    tEnter = t0;
+    return t0 <= t1;
+}
+
+
+template <class T>
+template <class F>
+void
+BVH<T>::intersect (const Line3<T> &ray, T tMax, F &hit) const
+{
+    //
+    // The ray is pos + t * dir for t >= 0, with dir not necessarily
+    // normalized.  Of the two children of a node, the one the ray
+    // enters first is visited first, so that hit can lower tMax and
+    // prune the other.
+    //
+
+    if (_nodes.empty())
+	return;
+
+    const Vec3<T> invDir (T (1) / ray.dir.x,
+			  T (1) / ray.dir.y,
+			  T (1) / ray.dir.z);
+
+    BVHStack<STACK_SIZE> stack (_depth);
+    stack.push (0);
+
+    while (!stack.empty())
+    {
+	const int i = stack.pop();
+	const Node &n = _nodes[i];
+	T tEnter;
+
+	if (!enters (n.bounds, ray.pos, invDir, tMax, tEnter))
+	    continue;
+
+	if (n.isLeaf())
+	{
+	    for (int j = n.offset; j < n.offset + n.count; ++j)
+	    {
+		if (enters (_bounds[j], ray.pos, invDir, tMax, tEnter))
+		    hit (_indices[j], tMax);
+	    }
+
+	    continue;
+	}
+
+	T tLeft = 0, tRight = 0;
+	const bool left = enters (_nodes[i + 1].bounds, ray.pos, invDir,
+				  tMax, tLeft);
+	const bool right = enters (_nodes[n.offset].bounds, ray.pos, invDir,
+				   tMax, tRight);
+
+	if (left && right)
+	{
+	    if (tLeft <= tRight)
+	    {
+		stack.push (n.offset);
+		stack.push (i + 1);
+	    }
+	    else
+	    {
+		stack.push (i + 1);
+		stack.push (n.offset);
+	    }
+	}
+	else if (left)
+	{
+	    stack.push (i + 1);
+	}
+	else if (right)
+	{
+	    stack.push (n.offset);
+	}
+    }
+}
+
+
+template <class T>
+template <class F>
+void
+BVH<T>::intersect (const Line3<T> *rays, T *tMax, int numRays, F &hit) const
+{
+    //
+    // Traverses the tree once for a packet of rays: a node is visited
+    // if any ray in the packet enters it, and its leaves are tested
+    // against the rays that do.  Works best for coherent rays, such as
+    // neighbouring pixels of a pick or camera region.
+    //
+
+    if (_nodes.empty() || numRays <= 0)
+	return;
+
+    std::vector< Vec3<T> > invDir (numRays);
+    std::vector<char> active (numRays);
+
+    for (int r = 0; r < numRays; ++r)
+    {
+	invDir[r].setValue (T (1) / rays[r].dir.x,
+			    T (1) / rays[r].dir.y,
+			    T (1) / rays[r].dir.z);
+    }
+
+    BVHStack<STACK_SIZE> stack (_depth);
+    stack.push (0);
+
+    while (!stack.empty())
+    {
+	const int i = stack.pop();
+	const Node &n = _nodes[i];
+	bool any = false;
+
+	for (int r = 0; r < numRays; ++r)
+	{
+	    T tEnter;
+	    active[r] = enters (n.bounds, rays[r].pos, invDir[r],
+				tMax[r], tEnter);
+	    any = any || active[r];
+	}
+
+	if (!any)
+	    continue;
+
+	if (n.isLeaf())
+	{
+	    for (int r = 0; r < numRays; ++r)
+	    {
+		if (!active[r])
+		    continue;
+
+		for (int j = n.offset; j < n.offset + n.count; ++j)
+		{
+		    T tEnter;
+
+		    if (enters (_bounds[j], rays[r].pos, invDir[r],
+				tMax[r], tEnter))
+			hit (r, _indices[j], tMax[r]);
+		}
+	    }
+	}
+	else
+	{
+	    stack.push (n.offset);
+	    stack.push (i + 1);
+	}
+    }
+}
+
+
+template <class T>
+inline T
+BVH<T>::boxDistance2 (const Box< Vec3<T> > &b, const Vec3<T> &p)
+{
+    return (closestPointInBox (p, b) - p).length2();
+}
+
+
+template <class T>
+template <class F>
+int
+BVH<T>::closest (const Vec3<T> &p, F &distance2, T &minDistance2) const
+{
+    //
+    // Returns the primitive i with the smallest distance2 (i, p) below
+    // minDistance2 (pass limits<T>::max() for no limit), or -1 if there
+    // is none; minDistance2 is set to that distance.  distance2 must
+    // not return less than the squared distance from p to the
+    // primitive's box, or nearer primitives may be pruned.
+    //
+
+    int best = -1;
+
+    if (_nodes.empty())
+	return best;
+
+    BVHStack<STACK_SIZE> stack (_depth);
+    stack.push (0);
+
+    while (!stack.empty())
+    {
+	const int i = stack.pop();
+	const Node &n = _nodes[i];
+
+	if (n.bounds.isEmpty() || boxDistance2 (n.bounds, p) >= minDistance2)
+	    continue;
+
+	if (n.isLeaf())
+	{
+	    for (int j = n.offset; j < n.offset + n.count; ++j)
+	    {
+		if (_bounds[j].isEmpty() ||
+		    boxDistance2 (_bounds[j], p) >= minDistance2)
+		    continue;
+
+		T d2 = distance2 (_indices[j], p);
+
+		if (d2 < minDistance2)
+		{
+		    minDistance2 = d2;
+		    best = _indices[j];
+		}
+	    }
+
+	    continue;
+	}
+
+	//
+	// Visit the nearer child first.
+	//
+
+	const Node &l = _nodes[i + 1];
+	const Node &r = _nodes[n.offset];
+	const T dl = l.bounds.isEmpty()? limits<T>::max(): boxDistance2 (l.bounds, p);
+	const T dr = r.bounds.isEmpty()? limits<T>::max(): boxDistance2 (r.bounds, p);
+
+	if (dl <= dr)
+	{
+	    stack.push (n.offset);
+	    stack.push (i + 1);
+	}
+	else
+	{
+	    stack.push (i + 1);
+	    stack.push (n.offset);
+	}
+    }
+
+    return best;
+}
+
+
+IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMATHBVH_H
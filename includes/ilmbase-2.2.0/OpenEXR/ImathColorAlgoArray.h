@@ -0,0 +1,466 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef INCLUDED_IMATHCOLORALGOARRAY_H
+#define INCLUDED_IMATHCOLORALGOARRAY_H
+
+//---------------------------------------------------------------------------
+//
+//	Batched color conversions over arrays of colors: hsv2rgb(),
+//	rgb2hsv(), rgb2packed() and packed2rgb() from ImathColorAlgo.h,
+//	for Vec3<T> (and so Color3<T>) and Color4<T> arrays, and for
+//	colors stored as separate channel planes.
+//
+//	The HSV conversions are written as straight-line code, with the
+//	hue sextant chosen by selects rather than a switch, and run over
+//	blocks of colors so that the loops can be vectorized.  They
+//	compute in double and convert to and from T exactly as the
+//	single-color functions do, so the results are the same.  T may be
+//	half; this header includes ImathHalfLimits.h for that.
+//
+//	Input and output arrays may be the same.  Colors are converted
+//	independently, so ranges of an array can be converted concurrently;
+//	IlmThreadColorAlgoArray.h does that on an IlmThread::ThreadPool.
+//
+//	Contains:
+//
+//	void hsv2rgbArray (const Vec3<T> *hsv, Vec3<T> *rgb, size_t n)
+//	void hsv2rgbArray (const Color4<T> *hsv, Color4<T> *rgb, size_t n)
+//	void hsv2rgbPlanes (const T *h, const T *s, const T *v,
+//			    T *r, T *g, T *b, size_t n)
+//
+//	void rgb2hsvArray (const Vec3<T> *rgb, Vec3<T> *hsv, size_t n)
+//	void rgb2hsvArray (const Color4<T> *rgb, Color4<T> *hsv, size_t n)
+//	void rgb2hsvPlanes (const T *r, const T *g, const T *b,
+//			    T *h, T *s, T *v, size_t n)
+//
+//	void rgb2packedArray (const Vec3<T> *c, PackedColor *packed,
+//			      size_t n)
+//	void rgb2packedArray (const Color4<T> *c, PackedColor *packed,
+//			      size_t n)
+//	void packed2rgbArray (const PackedColor *packed, Vec3<T> *c,
+//			      size_t n)
+//	void packed2rgbArray (const PackedColor *packed, Color4<T> *c,
+//			      size_t n)
+//
+//---------------------------------------------------------------------------
+
+#include "ImathColorAlgo.h"
+#include "ImathColor.h"
+#include "ImathHalfLimits.h"
+#include "ImathLimits.h"
+#include "ImathMath.h"
+#include "ImathVec.h"
+#include "ImathNamespace.h"
+
+#include <stddef.h>
+
+IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+inline void
+hsv2rgbLane (double hue, double sat, double val,
+	     double &x, double &y, double &z)
+{
+    //
+    // hsv2rgb_d() without the switch.  The sextant i is counted with
+    // compares rather than floor(), which the compiler will not
+    // vectorize under strict floating-point semantics, and the cases
+    // are applied as a series of selects.  As in the switch, a hue
+    // outside [0, 1] gives black.
+    //
+
+    hue = (hue == 1)? 0.0: hue * 6;
+
+    double i = -1;
+
+    for (int j = 0; j < 6; ++j)
+	i += (hue >= j)? 1.0: 0.0;
+
+    i = (hue >= 6)? -1.0: i;
+
+    const double f = hue - i;
+    const double p = val * (1 - sat);
+    const double q = val * (1 - (sat * f));
+    const double t = val * (1 - (sat * (1 - f)));
+
+    double rx = 0, ry = 0, rz = 0;
+
+    rx = (i == 0)? val: rx;  ry = (i == 0)? t: ry;    rz = (i == 0)? p: rz;
+    rx = (i == 1)? q: rx;    ry = (i == 1)? val: ry;  rz = (i == 1)? p: rz;
+    rx = (i == 2)? p: rx;    ry = (i == 2)? val: ry;  rz = (i == 2)? t: rz;
+    rx = (i == 3)? p: rx;    ry = (i == 3)? q: ry;    rz = (i == 3)? val: rz;
+    rx = (i == 4)? t: rx;    ry = (i == 4)? p: ry;    rz = (i == 4)? val: rz;
+    rx = (i == 5)? val: rx;  ry = (i == 5)? p: ry;    rz = (i == 5)? q: rz;
+
+    x = rx;
+    y = ry;
+    z = rz;
+}
+
+
+inline void
+rgb2hsvLane (double x, double y, double z,
+	     double &hue, double &sat, double &val)
+{
+    //
+    // rgb2hsv_d() without branches.
+    //
+
+    const double max = (x > y) ? ((x > z) ? x : z) : ((y > z) ? y : z);
+    const double min = (x < y) ? ((x < z) ? x : z) : ((y < z) ? y : z);
+    const double range = max - min;
+
+    //
+    // Every candidate is computed, with safe divisors, and the result
+    // selected, so there is no control flow in the loop.
+    //
+
+    const double m = (max != 0)? max: 1.0;
+    const double r = (range != 0)? range: 1.0;
+    const double s = range / m;
+
+    val = max;
+    sat = (max != 0)? s: 0.0;
+
+    const double hx = (y - z) / r;
+    const double hy = 2 + (z - x) / r;
+    const double hz = 4 + (x - y) / r;
+
+    const double h = (x == max)? hx: (y == max)? hy: hz;
+
+    hue = h / 6.;
+    hue = (hue < 0.)? hue + 1.0: hue;
+    hue = (sat != 0)? hue: 0.0;
+}
+
+
+//
+// Conversions to and from the double working values, matching the
+// single-color functions.  (The Color4 versions of those scale
+// integral inputs in float rather than double.)
+//
+
+template <class T>
+inline double
+colorToDouble (const T &c)
+{
+    if (limits<T>::isIntegral())
+	return c / double (limits<T>::max());
+    else
+	return double (c);
+}
+
+
+template <class T>
+inline double
+colorToDouble4 (const T &c)
+{
+    if (limits<T>::isIntegral())
+	return c / float (limits<T>::max());
+    else
+	return double (c);
+}
+
+
+template <class T>
+inline T
+colorFromDouble (double c)
+{
+    if (limits<T>::isIntegral())
+	return (T) (c * limits<T>::max());
+    else
+	return (T) c;
+}
+
+
+//
+// The array functions gather colors into blocks of doubles, run the
+// lanes over the block, and scatter the results.  The block loops
+// read and write only local arrays, so they vectorize without the
+// compiler having to prove that the caller's arrays do not overlap.
+//
+
+enum {colorBlockSize = 64};
+
+
+inline void
+hsv2rgbBlock (double c[3][colorBlockSize], int count)
+{
+    for (int k = 0; k < count; ++k)
+	hsv2rgbLane (c[0][k], c[1][k], c[2][k], c[0][k], c[1][k], c[2][k]);
+}
+
+
+inline void
+rgb2hsvBlock (double c[3][colorBlockSize], int count)
+{
+    for (int k = 0; k < count; ++k)
+	rgb2hsvLane (c[0][k], c[1][k], c[2][k], c[0][k], c[1][k], c[2][k]);
+}
+
+
+template <class T>
+void
+hsv2rgbArray (const Vec3<T> *hsv, Vec3<T> *rgb, size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble (hsv[i + k].x);
+	    c[1][k] = colorToDouble (hsv[i + k].y);
+	    c[2][k] = colorToDouble (hsv[i + k].z);
+	}
+
+	hsv2rgbBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    rgb[i + k].x = colorFromDouble<T> (c[0][k]);
+	    rgb[i + k].y = colorFromDouble<T> (c[1][k]);
+	    rgb[i + k].z = colorFromDouble<T> (c[2][k]);
+	}
+    }
+}
+
+
+template <class T>
+void
+hsv2rgbArray (const Color4<T> *hsv, Color4<T> *rgb, size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble4 (hsv[i + k].r);
+	    c[1][k] = colorToDouble4 (hsv[i + k].g);
+	    c[2][k] = colorToDouble4 (hsv[i + k].b);
+	}
+
+	hsv2rgbBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    rgb[i + k].r = colorFromDouble<T> (c[0][k]);
+	    rgb[i + k].g = colorFromDouble<T> (c[1][k]);
+	    rgb[i + k].b = colorFromDouble<T> (c[2][k]);
+	    rgb[i + k].a = colorFromDouble<T> (colorToDouble4 (hsv[i + k].a));
+	}
+    }
+}
+
+
+template <class T>
+void
+hsv2rgbPlanes (const T *h, const T *s, const T *v,
+	       T *r, T *g, T *b,
+	       size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble (h[i + k]);
+	    c[1][k] = colorToDouble (s[i + k]);
+	    c[2][k] = colorToDouble (v[i + k]);
+	}
+
+	hsv2rgbBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    r[i + k] = colorFromDouble<T> (c[0][k]);
+	    g[i + k] = colorFromDouble<T> (c[1][k]);
+	    b[i + k] = colorFromDouble<T> (c[2][k]);
+	}
+    }
+}
+
+
+template <class T>
+void
+rgb2hsvArray (const Vec3<T> *rgb, Vec3<T> *hsv, size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble (rgb[i + k].x);
+	    c[1][k] = colorToDouble (rgb[i + k].y);
+	    c[2][k] = colorToDouble (rgb[i + k].z);
+	}
+
+	rgb2hsvBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    hsv[i + k].x = colorFromDouble<T> (c[0][k]);
+	    hsv[i + k].y = colorFromDouble<T> (c[1][k]);
+	    hsv[i + k].z = colorFromDouble<T> (c[2][k]);
+	}
+    }
+}
+
+
+template <class T>
+void
+rgb2hsvArray (const Color4<T> *rgb, Color4<T> *hsv, size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble4 (rgb[i + k].r);
+	    c[1][k] = colorToDouble4 (rgb[i + k].g);
+	    c[2][k] = colorToDouble4 (rgb[i + k].b);
+	}
+
+	rgb2hsvBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    hsv[i + k].r = colorFromDouble<T> (c[0][k]);
+	    hsv[i + k].g = colorFromDouble<T> (c[1][k]);
+	    hsv[i + k].b = colorFromDouble<T> (c[2][k]);
+	    hsv[i + k].a = colorFromDouble<T> (colorToDouble4 (rgb[i + k].a));
+	}
+    }
+}
+
+
+template <class T>
+void
+rgb2hsvPlanes (const T *r, const T *g, const T *b,
+	       T *h, T *s, T *v,
+	       size_t n)
+{
+    double c[3][colorBlockSize];
+
+    for (size_t i = 0; i < n; i += colorBlockSize)
+    {
+	const int count = (n - i < size_t (colorBlockSize))?
+			  int (n - i): int (colorBlockSize);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    c[0][k] = colorToDouble (r[i + k]);
+	    c[1][k] = colorToDouble (g[i + k]);
+	    c[2][k] = colorToDouble (b[i + k]);
+	}
+
+	rgb2hsvBlock (c, count);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    h[i + k] = colorFromDouble<T> (c[0][k]);
+	    s[i + k] = colorFromDouble<T> (c[1][k]);
+	    v[i + k] = colorFromDouble<T> (c[2][k]);
+	}
+    }
+}
+
+
+//
+// The packing functions have no branches at run time; the array
+// versions call them directly in a loop the compiler can vectorize.
+//
+
+template <class T>
+void
+rgb2packedArray (const Vec3<T> *c, PackedColor *packed, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	packed[i] = rgb2packed (c[i]);
+}
+
+
+template <class T>
+void
+rgb2packedArray (const Color4<T> *c, PackedColor *packed, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	packed[i] = rgb2packed (c[i]);
+}
+
+
+template <class T>
+void
+packed2rgbArray (const PackedColor *packed, Vec3<T> *c, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	packed2rgb (packed[i], c[i]);
+}
+
+
+template <class T>
+void
+packed2rgbArray (const PackedColor *packed, Color4<T> *c, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	packed2rgb (packed[i], c[i]);
+}
+
+
+IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMATHCOLORALGOARRAY_H
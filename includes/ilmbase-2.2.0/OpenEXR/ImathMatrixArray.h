@@ -0,0 +1,1349 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef INCLUDED_IMATHMATRIXARRAY_H
+#define INCLUDED_IMATHMATRIXARRAY_H
+
+//---------------------------------------------------------------------------
+//
+//	Batched matrix operations over arrays of matrices: Matrix44
+//	multiply, inverse, and the scale/shear/rotate/translate
+//	decompositions from ImathMatrixAlgo.h; Matrix33 symmetric
+//	eigensystems and SVDs; and Procrustes fits of many point clusters.
+//
+//	The kernels work on Matrix44Block and Matrix33Block, structure-of-
+//	arrays layouts holding N matrices with element [i][j] of all N
+//	matrices stored contiguously.  Each kernel loops over the N lanes
+//	of a block for every step, so the same operation runs across
+//	matrices and the compiler can vectorize it.  The array functions
+//	load blocks from ordinary matrix arrays, run the kernels, and store
+//	the results.  The Matrix44 results are the same as the per-matrix
+//	functions; the Matrix33 solvers are computed here rather than by
+//	the compiled jacobiSVD() and jacobiEigenSolver(), so they agree
+//	with those to within the tolerance, up to the order and sign of
+//	eigenvectors.
+//
+//	None of these functions throw.  Where the per-matrix function would
+//	throw (or return false with exc == false), the array function
+//	stores a default result and clears the matching entry of the
+//	optional valid array.  src and dst arrays may be the same.
+//
+//	Contains:
+//
+//	struct Matrix44Block<T,N>
+//	struct Matrix33Block<T,N>
+//
+//	void multiply (const Matrix44Block<T,N> &a,
+//		       const Matrix44Block<T,N> &b,
+//		       Matrix44Block<T,N> &c)
+//
+//	void affineInverse (const Matrix44Block<T,N> &m,
+//			    Matrix44Block<T,N> &result,
+//			    bool valid[N])
+//
+//	void extractAndRemoveScalingAndShear (Matrix44Block<T,N> &m,
+//					      T scl[3][N], T shr[3][N],
+//					      bool valid[N])
+//
+//	void multiplyArray (const Matrix44<T> *a, const Matrix44<T> *b,
+//			    Matrix44<T> *dst, size_t n)
+//
+//	size_t inverseArray (const Matrix44<T> *src, Matrix44<T> *dst,
+//			     size_t n, bool *valid = 0)
+//
+//	size_t extractSHRTArray (const Matrix44<T> *src,
+//				 Vec3<T> *s, Vec3<T> *h, Vec3<T> *r,
+//				 Vec3<T> *t, size_t n, bool *valid = 0,
+//				 typename Euler<T>::Order rOrder = Euler<T>::XYZ)
+//
+//	size_t extractSHQTArray (const Matrix44<T> *src,
+//				 Vec3<T> *s, Vec3<T> *h, Quat<T> *q,
+//				 Vec3<T> *t, size_t n, bool *valid = 0)
+//
+//	The size_t results are the number of matrices that could not be
+//	inverted or decomposed.
+//
+//	void jacobiEigenSolver (Matrix33Block<T,N> &A, T S[3][N],
+//				Matrix33Block<T,N> &V, T tol)
+//
+//	void jacobiSVD (const Matrix33Block<T,N> &A, Matrix33Block<T,N> &U,
+//			T S[3][N], Matrix33Block<T,N> &V, T tol,
+//			bool forcePositiveDeterminant)
+//
+//	void jacobiEigenSolverArray (const Matrix33<T> *A, Vec3<T> *S,
+//				     Matrix33<T> *V, size_t n, T tol = eps)
+//
+//	void jacobiSVDArray (const Matrix33<T> *A, Matrix33<T> *U,
+//			     Vec3<T> *S, Matrix33<T> *V, size_t n,
+//			     T tol = eps, bool forcePositiveDeterminant = false)
+//
+//	void procrustesRotationAndTranslationArray (
+//			     const Vec3<T> *A, const Vec3<T> *B,
+//			     const T *weights, const size_t *indices,
+//			     const size_t *clusterStart, size_t numClusters,
+//			     M44d *result, bool doScaling = false)
+//
+//	Clusters don't share any data, so runs of them can be fitted
+//	concurrently; IlmThreadMatrixArray.h does that on an
+//	IlmThread::ThreadPool.
+//
+//---------------------------------------------------------------------------
+
+#include "ImathMatrixAlgo.h"
+#include "ImathMatrix.h"
+#include "ImathQuat.h"
+#include "ImathEuler.h"
+#include "ImathExc.h"
+#include "ImathFun.h"
+#include "ImathLimits.h"
+#include "ImathMath.h"
+#include "ImathVec.h"
+#include "ImathNamespace.h"
+
+#include <cstddef>
+
+IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+template <class T, int N = 8>
+struct Matrix44Block
+{
+    //
+    // x[i][j][k] is element [i][j] of the k-th matrix in the block.
+    //
+
+    T           x[4][4][N];
+
+    enum {width = N};
+
+    //
+    // Load count (at most N) matrices; the remaining lanes are filled
+    // with the identity so the kernels can run on full blocks.
+    //
+
+    void        load (const Matrix44<T> *m, int count);
+    void        store (Matrix44<T> *m, int count) const;
+};
+
+
+template <class T, int N>
+void
+Matrix44Block<T,N>::load (const Matrix44<T> *m, int count)
+{
+    for (int k = 0; k < count; ++k)
+	for (int i = 0; i < 4; ++i)
+	    for (int j = 0; j < 4; ++j)
+		x[i][j][k] = m[k][i][j];
+
+    for (int k = count; k < N; ++k)
+	for (int i = 0; i < 4; ++i)
+	    for (int j = 0; j < 4; ++j)
+		x[i][j][k] = (i == j)? T (1): T (0);
+}
+
+
+template <class T, int N>
+void
+Matrix44Block<T,N>::store (Matrix44<T> *m, int count) const
+{
+    for (int k = 0; k < count; ++k)
+	for (int i = 0; i < 4; ++i)
+	    for (int j = 0; j < 4; ++j)
+		m[k][i][j] = x[i][j][k];
+}
+
+
+template <class T, int N>
+void
+multiply (const Matrix44Block<T,N> &a,
+	  const Matrix44Block<T,N> &b,
+	  Matrix44Block<T,N> &c)
+{
+    //
+    // c = a * b for each lane, summed in the same order as
+    // Matrix44<T>::multiply().  c must not be a or b.
+    //
+
+    for (int i = 0; i < 4; ++i)
+    {
+	for (int j = 0; j < 4; ++j)
+	{
+	    for (int k = 0; k < N; ++k)
+	    {
+		c.x[i][j][k] = a.x[i][0][k] * b.x[0][j][k] +
+			       a.x[i][1][k] * b.x[1][j][k] +
+			       a.x[i][2][k] * b.x[2][j][k] +
+			       a.x[i][3][k] * b.x[3][j][k];
+	    }
+	}
+    }
+}
+
+
+template <class T, int N>
+void
+affineInverse (const Matrix44Block<T,N> &m,
+	       Matrix44Block<T,N> &result,
+	       bool valid[N])
+{
+    //
+    // The affine branch of Matrix44<T>::inverse(), for matrices whose
+    // last column is (0 0 0 1).  Lanes that inverse() would reject as
+    // singular are set to the identity and flagged in valid.  result
+    // must not be m.
+    //
+
+    const T (&x)[4][4][N] = m.x;
+    T (&s)[4][4][N] = result.x;
+
+    for (int k = 0; k < N; ++k)
+    {
+	s[0][0][k] = x[1][1][k] * x[2][2][k] - x[2][1][k] * x[1][2][k];
+	s[0][1][k] = x[2][1][k] * x[0][2][k] - x[0][1][k] * x[2][2][k];
+	s[0][2][k] = x[0][1][k] * x[1][2][k] - x[1][1][k] * x[0][2][k];
+
+	s[1][0][k] = x[2][0][k] * x[1][2][k] - x[1][0][k] * x[2][2][k];
+	s[1][1][k] = x[0][0][k] * x[2][2][k] - x[2][0][k] * x[0][2][k];
+	s[1][2][k] = x[1][0][k] * x[0][2][k] - x[0][0][k] * x[1][2][k];
+
+	s[2][0][k] = x[1][0][k] * x[2][1][k] - x[2][0][k] * x[1][1][k];
+	s[2][1][k] = x[2][0][k] * x[0][1][k] - x[0][0][k] * x[2][1][k];
+	s[2][2][k] = x[0][0][k] * x[1][1][k] - x[1][0][k] * x[0][1][k];
+    }
+
+    T r[N];
+
+    for (int k = 0; k < N; ++k)
+    {
+	r[k] = x[0][0][k] * s[0][0][k] +
+	       x[0][1][k] * s[1][0][k] +
+	       x[0][2][k] * s[2][0][k];
+    }
+
+    //
+    // inverse() divides by r directly when |r| >= 1, and otherwise
+    // only when every cofactor is small enough not to overflow.
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	const T ar = IMATH_INTERNAL_NAMESPACE::abs (r[k]);
+	const T mr = ar / limits<T>::smallest();
+	bool ok = true;
+
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		ok = ok && (ar >= 1 || mr > IMATH_INTERNAL_NAMESPACE::abs (s[i][j][k]));
+
+	valid[k] = ok;
+    }
+
+    for (int i = 0; i < 3; ++i)
+	for (int j = 0; j < 3; ++j)
+	    for (int k = 0; k < N; ++k)
+		s[i][j][k] /= r[k];
+
+    for (int k = 0; k < N; ++k)
+    {
+	s[3][0][k] = -x[3][0][k] * s[0][0][k] - x[3][1][k] * s[1][0][k] - x[3][2][k] * s[2][0][k];
+	s[3][1][k] = -x[3][0][k] * s[0][1][k] - x[3][1][k] * s[1][1][k] - x[3][2][k] * s[2][1][k];
+	s[3][2][k] = -x[3][0][k] * s[0][2][k] - x[3][1][k] * s[1][2][k] - x[3][2][k] * s[2][2][k];
+
+	s[0][3][k] = 0;
+	s[1][3][k] = 0;
+	s[2][3][k] = 0;
+	s[3][3][k] = 1;
+    }
+
+    for (int i = 0; i < 4; ++i)
+	for (int j = 0; j < 4; ++j)
+	    for (int k = 0; k < N; ++k)
+		if (!valid[k])
+		    s[i][j][k] = (i == j)? T (1): T (0);
+}
+
+
+template <class T, int N>
+void
+lengthOfRows (const T row[3][N], T len[N])
+{
+    //
+    // Vec3<T>::length() for each lane, including its fallback for
+    // vectors short enough that squaring underflows.
+    //
+
+    T len2[N];
+
+    for (int k = 0; k < N; ++k)
+    {
+	len2[k] = row[0][k] * row[0][k] + row[1][k] * row[1][k] +
+		  row[2][k] * row[2][k];
+
+	len[k] = Math<T>::sqrt (len2[k]);
+    }
+
+    for (int k = 0; k < N; ++k)
+    {
+	if (len2[k] < T (2) * limits<T>::smallest())
+	    len[k] = Vec3<T> (row[0][k], row[1][k], row[2][k]).length();
+    }
+}
+
+
+template <class T, int N>
+void
+checkForZeroScaleInRow (const T scl[N], const T row[3][N], bool valid[N])
+{
+    //
+    // checkForZeroScaleInRow() for each lane, clearing valid instead
+    // of throwing.
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	const T as = IMATH_INTERNAL_NAMESPACE::abs (scl[k]);
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    if (as < 1 &&
+		IMATH_INTERNAL_NAMESPACE::abs (row[i][k]) >= limits<T>::max() * as)
+		valid[k] = false;
+	}
+    }
+}
+
+
+template <class T, int N>
+void
+extractAndRemoveScalingAndShear (Matrix44Block<T,N> &m,
+				 T scl[3][N],
+				 T shr[3][N],
+				 bool valid[N])
+{
+    //
+    // extractAndRemoveScalingAndShear() for each lane, following the
+    // same steps (Spencer W. Thomas, Graphics Gems II, p. 320).
+    // Instead of returning early, lanes that fail a zero scale check
+    // are flagged and carried through; their results are meaningless.
+    //
+
+    T row[3][3][N];
+
+    for (int i = 0; i < 3; ++i)
+	for (int j = 0; j < 3; ++j)
+	    for (int k = 0; k < N; ++k)
+		row[i][j][k] = m.x[i][j][k];
+
+    for (int k = 0; k < N; ++k)
+	valid[k] = true;
+
+    //
+    // Normalize the 3x3 matrix by its largest coefficient.
+    //
+
+    T maxVal[N];
+
+    for (int k = 0; k < N; ++k)
+    {
+	T mv = 0;
+
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		mv = (IMATH_INTERNAL_NAMESPACE::abs (row[i][j][k]) > mv)?
+		     IMATH_INTERNAL_NAMESPACE::abs (row[i][j][k]): mv;
+
+	maxVal[k] = mv;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+	bool rowValid[N];
+
+	for (int k = 0; k < N; ++k)
+	    rowValid[k] = true;
+
+	checkForZeroScaleInRow (maxVal, row[i], rowValid);
+
+	for (int k = 0; k < N; ++k)
+	    valid[k] = valid[k] && (maxVal[k] == 0 || rowValid[k]);
+
+	for (int j = 0; j < 3; ++j)
+	    for (int k = 0; k < N; ++k)
+		row[i][j][k] = (maxVal[k] != 0)? row[i][j][k] / maxVal[k]:
+						 row[i][j][k];
+    }
+
+    //
+    // X scale, then normalize the first row.
+    //
+
+    lengthOfRows (row[0], scl[0]);
+    checkForZeroScaleInRow (scl[0], row[0], valid);
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[0][j][k] /= scl[0][k];
+
+    //
+    // XY shear, then make the second row orthogonal to the first.
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	shr[0][k] = row[0][0][k] * row[1][0][k] +
+		    row[0][1][k] * row[1][1][k] +
+		    row[0][2][k] * row[1][2][k];
+    }
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[1][j][k] -= shr[0][k] * row[0][j][k];
+
+    //
+    // Y scale; normalize the second row and correct the XY shear.
+    //
+
+    lengthOfRows (row[1], scl[1]);
+    checkForZeroScaleInRow (scl[1], row[1], valid);
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[1][j][k] /= scl[1][k];
+
+    for (int k = 0; k < N; ++k)
+	shr[0][k] /= scl[1][k];
+
+    //
+    // XZ and YZ shears, orthogonalizing the third row.
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	shr[1][k] = row[0][0][k] * row[2][0][k] +
+		    row[0][1][k] * row[2][1][k] +
+		    row[0][2][k] * row[2][2][k];
+    }
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[2][j][k] -= shr[1][k] * row[0][j][k];
+
+    for (int k = 0; k < N; ++k)
+    {
+	shr[2][k] = row[1][0][k] * row[2][0][k] +
+		    row[1][1][k] * row[2][1][k] +
+		    row[1][2][k] * row[2][2][k];
+    }
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[2][j][k] -= shr[2][k] * row[1][j][k];
+
+    //
+    // Z scale; normalize the third row and correct the XZ and YZ
+    // shears.
+    //
+
+    lengthOfRows (row[2], scl[2]);
+    checkForZeroScaleInRow (scl[2], row[2], valid);
+
+    for (int j = 0; j < 3; ++j)
+	for (int k = 0; k < N; ++k)
+	    row[2][j][k] /= scl[2][k];
+
+    for (int k = 0; k < N; ++k)
+    {
+	shr[1][k] /= scl[2][k];
+	shr[2][k] /= scl[2][k];
+    }
+
+    //
+    // Negate the rows and scales of lanes whose rows form a left-handed
+    // frame, store the rotation, and undo the normalization.
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	const T cx = row[1][1][k] * row[2][2][k] - row[1][2][k] * row[2][1][k];
+	const T cy = row[1][2][k] * row[2][0][k] - row[1][0][k] * row[2][2][k];
+	const T cz = row[1][0][k] * row[2][1][k] - row[1][1][k] * row[2][0][k];
+
+	const T det = row[0][0][k] * cx + row[0][1][k] * cy + row[0][2][k] * cz;
+	const T sign = (det < 0)? T (-1): T (1);
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    scl[i][k] *= sign;
+
+	    for (int j = 0; j < 3; ++j)
+		m.x[i][j][k] = row[i][j][k] * sign;
+
+	    scl[i][k] *= maxVal[k];
+	}
+    }
+}
+
+
+template <class T>
+void
+multiplyArray (const Matrix44<T> *a,
+	       const Matrix44<T> *b,
+	       Matrix44<T> *dst,
+	       size_t n)
+{
+    //
+    // dst[i] = a[i] * b[i]
+    //
+
+    const int N = Matrix44Block<T>::width;
+
+    Matrix44Block<T> ab, bb, cb;
+
+    for (size_t i = 0; i < n; i += N)
+    {
+	const int count = (n - i < size_t (N))? int (n - i): N;
+
+	ab.load (a + i, count);
+	bb.load (b + i, count);
+	multiply (ab, bb, cb);
+	cb.store (dst + i, count);
+    }
+}
+
+
+template <class T>
+size_t
+inverseArray (const Matrix44<T> *src,
+	      Matrix44<T> *dst,
+	      size_t n,
+	      bool *valid = 0)
+{
+    //
+    // dst[i] = src[i].inverse().  Blocks of affine matrices use the
+    // affineInverse() kernel; a block containing a projective matrix
+    // is inverted one matrix at a time with the Gauss-Jordan method,
+    // as inverse() does.  Singular matrices produce the identity.
+    //
+
+    const int N = Matrix44Block<T>::width;
+
+    Matrix44Block<T> mb, rb;
+    bool ok[N];
+    size_t numInvalid = 0;
+
+    for (size_t i = 0; i < n; i += N)
+    {
+	const int count = (n - i < size_t (N))? int (n - i): N;
+	bool affine = true;
+
+	for (int k = 0; k < count; ++k)
+	{
+	    const Matrix44<T> &m = src[i + k];
+	    affine = affine && m[0][3] == 0 && m[1][3] == 0 &&
+			       m[2][3] == 0 && m[3][3] == 1;
+	}
+
+	if (affine)
+	{
+	    mb.load (src + i, count);
+	    affineInverse (mb, rb, ok);
+	    rb.store (dst + i, count);
+	}
+	else
+	{
+	    for (int k = 0; k < count; ++k)
+	    {
+		try
+		{
+		    dst[i + k] = src[i + k].inverse (true);
+		    ok[k] = true;
+		}
+		catch (SingMatrixExc &)
+		{
+		    dst[i + k].makeIdentity();
+		    ok[k] = false;
+		}
+	    }
+	}
+
+	for (int k = 0; k < count; ++k)
+	{
+	    if (!ok[k])
+		++numInvalid;
+
+	    if (valid)
+		valid[i + k] = ok[k];
+	}
+    }
+
+    return numInvalid;
+}
+
+
+template <class T, class R>
+size_t
+extractSHRArray (const Matrix44<T> *src,
+		 Vec3<T> *s,
+		 Vec3<T> *h,
+		 R *r,
+		 Vec3<T> *t,
+		 size_t n,
+		 bool *valid,
+		 void (*toRotation) (const Matrix44<T> &, R &, void *),
+		 void *data)
+{
+    //
+    // Shared by extractSHRTArray() and extractSHQTArray(): runs the
+    // scale and shear kernel on blocks, then converts each rotation
+    // matrix with toRotation.  Matrices with a zero scale get unit
+    // scale, no shear and no rotation.
+    //
+
+    const int N = Matrix44Block<T>::width;
+
+    Matrix44Block<T> mb;
+    T scl[3][N];
+    T shr[3][N];
+    bool ok[N];
+    size_t numInvalid = 0;
+
+    for (size_t i = 0; i < n; i += N)
+    {
+	const int count = (n - i < size_t (N))? int (n - i): N;
+
+	mb.load (src + i, count);
+	extractAndRemoveScalingAndShear (mb, scl, shr, ok);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    const Matrix44<T> &m = src[i + k];
+
+	    t[i + k].setValue (m[3][0], m[3][1], m[3][2]);
+
+	    if (ok[k])
+	    {
+		Matrix44<T> rot;
+
+		for (int a = 0; a < 3; ++a)
+		    for (int b = 0; b < 3; ++b)
+			rot[a][b] = mb.x[a][b][k];
+
+		s[i + k].setValue (scl[0][k], scl[1][k], scl[2][k]);
+		h[i + k].setValue (shr[0][k], shr[1][k], shr[2][k]);
+		toRotation (rot, r[i + k], data);
+	    }
+	    else
+	    {
+		++numInvalid;
+
+		s[i + k].setValue (1, 1, 1);
+		h[i + k].setValue (0, 0, 0);
+		toRotation (Matrix44<T>(), r[i + k], data);
+	    }
+
+	    if (valid)
+		valid[i + k] = ok[k];
+	}
+    }
+
+    return numInvalid;
+}
+
+
+template <class T>
+void
+extractEulerForSHRT (const Matrix44<T> &rot, Vec3<T> &r, void *data)
+{
+    typename Euler<T>::Order rOrder =
+	*static_cast<const typename Euler<T>::Order *> (data);
+
+    extractEulerXYZ (rot, r);
+
+    if (rOrder != Euler<T>::XYZ)
+    {
+	IMATH_INTERNAL_NAMESPACE::Euler<T> eXYZ (r, IMATH_INTERNAL_NAMESPACE::Euler<T>::XYZ);
+	IMATH_INTERNAL_NAMESPACE::Euler<T> e (eXYZ, rOrder);
+	r = e.toXYZVector ();
+    }
+}
+
+
+template <class T>
+void
+extractQuatForSHQT (const Matrix44<T> &rot, Quat<T> &q, void *)
+{
+    q = extractQuat (rot);
+}
+
+
+template <class T>
+size_t
+extractSHRTArray (const Matrix44<T> *src,
+		  Vec3<T> *s,
+		  Vec3<T> *h,
+		  Vec3<T> *r,
+		  Vec3<T> *t,
+		  size_t n,
+		  bool *valid = 0,
+		  typename Euler<T>::Order rOrder = Euler<T>::XYZ)
+{
+    //
+    // extractSHRT() with exc == false for each matrix.
+    //
+
+    return extractSHRArray (src, s, h, r, t, n, valid,
+			    &extractEulerForSHRT<T>, &rOrder);
+}
+
+
+template <class T>
+size_t
+extractSHQTArray (const Matrix44<T> *src,
+		  Vec3<T> *s,
+		  Vec3<T> *h,
+		  Quat<T> *q,
+		  Vec3<T> *t,
+		  size_t n,
+		  bool *valid = 0)
+{
+    //
+    // Like extractSHRTArray(), but with the rotation as a quaternion:
+    // extractQuat() of the matrix with scale and shear removed.
+    //
+
+    return extractSHRArray (src, s, h, q, t, n, valid,
+			    &extractQuatForSHQT<T>, 0);
+}
+
+
+template <class T, int N = 8>
+struct Matrix33Block
+{
+    //
+    // x[i][j][k] is element [i][j] of the k-th matrix in the block.
+    //
+
+    T           x[3][3][N];
+
+    enum {width = N};
+
+    //
+    // Load count (at most N) matrices; the remaining lanes are filled
+    // with the identity so the kernels can run on full blocks.
+    //
+
+    void        load (const Matrix33<T> *m, int count);
+    void        store (Matrix33<T> *m, int count) const;
+};
+
+
+template <class T, int N>
+void
+Matrix33Block<T,N>::load (const Matrix33<T> *m, int count)
+{
+    for (int k = 0; k < count; ++k)
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		x[i][j][k] = m[k][i][j];
+
+    for (int k = count; k < N; ++k)
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		x[i][j][k] = (i == j)? T (1): T (0);
+}
+
+
+template <class T, int N>
+void
+Matrix33Block<T,N>::store (Matrix33<T> *m, int count) const
+{
+    for (int k = 0; k < count; ++k)
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		m[k][i][j] = x[i][j][k];
+}
+
+
+template <class T>
+inline void
+jacobiRotationAngle (T zeta, bool skip, T &c, T &s)
+{
+    //
+    // The Jacobi rotation with tangent t = sign(zeta) /
+    // (|zeta| + sqrt(zeta^2 + 1)), the smaller root of
+    // t^2 + 2 zeta t - 1 = 0; c = 1, s = 0 if skip.
+    //
+
+    T az = IMATH_INTERNAL_NAMESPACE::abs (zeta);
+    T t = T (1) / (az + Math<T>::sqrt (az * az + 1));
+    t = (zeta < 0)? -t: t;
+    t = skip? T (0): t;
+
+    c = T (1) / Math<T>::sqrt (t * t + 1);
+    s = t * c;
+}
+
+
+template <int p, int q, int r, class T, int N>
+bool
+jacobiEigenRotation (Matrix33Block<T,N> &A, Matrix33Block<T,N> &V, T tol)
+{
+    //
+    // One rotation in the (p, q) plane, zeroing A[p][q] in every lane
+    // where it is not already negligible compared to the diagonal.
+    // A is symmetric; only its upper triangle (p < q) is kept up to
+    // date.  Returns whether any lane was rotated.
+    //
+
+    bool changed = false;
+
+    for (int k = 0; k < N; ++k)
+    {
+	const T apq = A.x[p][q][k];
+	const T app = A.x[p][p][k];
+	const T aqq = A.x[q][q][k];
+
+	const bool skip = IMATH_INTERNAL_NAMESPACE::abs (apq) <=
+			  tol * (IMATH_INTERNAL_NAMESPACE::abs (app) +
+				 IMATH_INTERNAL_NAMESPACE::abs (aqq)) ||
+			  apq == 0;
+
+	changed = changed || !skip;
+
+	const T safe = skip? T (1): apq;
+	T c, s;
+	jacobiRotationAngle ((aqq - app) / (2 * safe), skip, c, s);
+
+	const T t = skip? T (0): s / c;
+
+	A.x[p][p][k] = app - t * apq;
+	A.x[q][q][k] = aqq + t * apq;
+	A.x[p][q][k] = skip? apq: T (0);
+
+	//
+	// The entries coupling p and q to the third index r.
+	//
+
+	T &arp = (r < p)? A.x[r][p][k]: A.x[p][r][k];
+	T &arq = (r < q)? A.x[r][q][k]: A.x[q][r][k];
+	const T rp = arp;
+	const T rq = arq;
+
+	arp = c * rp - s * rq;
+	arq = s * rp + c * rq;
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    const T vp = V.x[i][p][k];
+	    const T vq = V.x[i][q][k];
+
+	    V.x[i][p][k] = c * vp - s * vq;
+	    V.x[i][q][k] = s * vp + c * vq;
+	}
+    }
+
+    return changed;
+}
+
+
+template <class T, int N>
+void
+jacobiEigenSolver (Matrix33Block<T,N> &A,
+		   T S[3][N],
+		   Matrix33Block<T,N> &V,
+		   T tol)
+{
+    //
+    // jacobiEigenSolver() for each lane: A = V * S * V^T for symmetric
+    // A, with the eigenvectors in the columns of V.  Cyclic Jacobi
+    // sweeps run until no lane needs another rotation.  As with the
+    // single-matrix solver, the eigenvalues are not sorted, and the
+    // upper triangle of A is zeroed.
+    //
+
+    for (int i = 0; i < 3; ++i)
+	for (int j = 0; j < 3; ++j)
+	    for (int k = 0; k < N; ++k)
+		V.x[i][j][k] = (i == j)? T (1): T (0);
+
+    const int maxSweeps = 20;
+
+    for (int sweep = 0; sweep < maxSweeps; ++sweep)
+    {
+	bool changed = jacobiEigenRotation<0, 1, 2> (A, V, tol);
+	changed = jacobiEigenRotation<0, 2, 1> (A, V, tol) || changed;
+	changed = jacobiEigenRotation<1, 2, 0> (A, V, tol) || changed;
+
+	if (!changed)
+	    break;
+    }
+
+    for (int i = 0; i < 3; ++i)
+	for (int k = 0; k < N; ++k)
+	    S[i][k] = A.x[i][i][k];
+
+    for (int k = 0; k < N; ++k)
+    {
+	A.x[0][1][k] = 0;
+	A.x[0][2][k] = 0;
+	A.x[1][2][k] = 0;
+    }
+}
+
+
+template <int p, int q, class T, int N>
+bool
+jacobiSVDRotation (Matrix33Block<T,N> &W, Matrix33Block<T,N> &V, T tol)
+{
+    //
+    // One-sided Jacobi: rotate columns p and q of W (and of V) to make
+    // them orthogonal, in every lane where they are not already.
+    //
+
+    bool changed = false;
+
+    for (int k = 0; k < N; ++k)
+    {
+	T alpha = 0, beta = 0, gamma = 0;
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    const T wp = W.x[i][p][k];
+	    const T wq = W.x[i][q][k];
+
+	    alpha += wp * wp;
+	    beta += wq * wq;
+	    gamma += wp * wq;
+	}
+
+	const bool skip = IMATH_INTERNAL_NAMESPACE::abs (gamma) <=
+			  tol * Math<T>::sqrt (alpha * beta) ||
+			  gamma == 0;
+
+	changed = changed || !skip;
+
+	const T safe = skip? T (1): gamma;
+	T c, s;
+	jacobiRotationAngle ((beta - alpha) / (2 * safe), skip, c, s);
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    const T wp = W.x[i][p][k];
+	    const T wq = W.x[i][q][k];
+
+	    W.x[i][p][k] = c * wp - s * wq;
+	    W.x[i][q][k] = s * wp + c * wq;
+
+	    const T vp = V.x[i][p][k];
+	    const T vq = V.x[i][q][k];
+
+	    V.x[i][p][k] = c * vp - s * vq;
+	    V.x[i][q][k] = s * vp + c * vq;
+	}
+    }
+
+    return changed;
+}
+
+
+template <int a, int b, class T, int N>
+void
+sortSVDColumns (Matrix33Block<T,N> &U, T S[3][N], Matrix33Block<T,N> &V)
+{
+    //
+    // Swap columns a and b (and singular values) in lanes where
+    // S[a] < S[b].
+    //
+
+    for (int k = 0; k < N; ++k)
+    {
+	const bool swap = S[a][k] < S[b][k];
+	const T sa = S[a][k];
+	const T sb = S[b][k];
+
+	S[a][k] = swap? sb: sa;
+	S[b][k] = swap? sa: sb;
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    const T ua = U.x[i][a][k], ub = U.x[i][b][k];
+	    const T va = V.x[i][a][k], vb = V.x[i][b][k];
+
+	    U.x[i][a][k] = swap? ub: ua;
+	    U.x[i][b][k] = swap? ua: ub;
+	    V.x[i][a][k] = swap? vb: va;
+	    V.x[i][b][k] = swap? va: vb;
+	}
+    }
+}
+
+
+template <class T, int N>
+void
+jacobiSVD (const Matrix33Block<T,N> &A,
+	   Matrix33Block<T,N> &U,
+	   T S[3][N],
+	   Matrix33Block<T,N> &V,
+	   T tol,
+	   bool forcePositiveDeterminant)
+{
+    //
+    // jacobiSVD() for each lane: A = U * S * V^T with U and V
+    // orthonormal and S positive and sorted from largest to smallest,
+    // except that with forcePositiveDeterminant the smallest value is
+    // negated (along with the last column of U) where needed to make
+    // U * V^T a rotation.
+    //
+    // Uses one-sided Jacobi rotations on the columns of A, which keeps
+    // the accuracy of small singular values.  Columns of U belonging to
+    // zero singular values are completed to an orthonormal basis.
+    //
+
+    U = A;
+
+    for (int i = 0; i < 3; ++i)
+	for (int j = 0; j < 3; ++j)
+	    for (int k = 0; k < N; ++k)
+		V.x[i][j][k] = (i == j)? T (1): T (0);
+
+    const int maxSweeps = 20;
+
+    for (int sweep = 0; sweep < maxSweeps; ++sweep)
+    {
+	bool changed = jacobiSVDRotation<0, 1> (U, V, tol);
+	changed = jacobiSVDRotation<0, 2> (U, V, tol) || changed;
+	changed = jacobiSVDRotation<1, 2> (U, V, tol) || changed;
+
+	if (!changed)
+	    break;
+    }
+
+    //
+    // The column lengths are the singular values.
+    //
+
+    for (int j = 0; j < 3; ++j)
+    {
+	for (int k = 0; k < N; ++k)
+	{
+	    S[j][k] = Math<T>::sqrt (U.x[0][j][k] * U.x[0][j][k] +
+				     U.x[1][j][k] * U.x[1][j][k] +
+				     U.x[2][j][k] * U.x[2][j][k]);
+	}
+    }
+
+    sortSVDColumns<0, 1> (U, S, V);
+    sortSVDColumns<0, 2> (U, S, V);
+    sortSVDColumns<1, 2> (U, S, V);
+
+    for (int k = 0; k < N; ++k)
+    {
+	//
+	// Normalize the columns of U.  A zero column is replaced: the
+	// first by the x axis, the second by a unit vector orthogonal
+	// to the first, and the third by the cross product of the two.
+	//
+
+	Vec3<T> u[3];
+
+	for (int j = 0; j < 3; ++j)
+	{
+	    const T sj = S[j][k];
+	    const T d = (sj > 0)? sj: T (1);
+
+	    u[j].setValue (U.x[0][j][k] / d, U.x[1][j][k] / d, U.x[2][j][k] / d);
+	}
+
+	const T small = S[0][k] * limits<T>::epsilon();
+
+	u[0] = (S[0][k] > 0)? u[0]: Vec3<T> (1, 0, 0);
+
+	const T ax = IMATH_INTERNAL_NAMESPACE::abs (u[0].x);
+	const T ay = IMATH_INTERNAL_NAMESPACE::abs (u[0].y);
+	const T az = IMATH_INTERNAL_NAMESPACE::abs (u[0].z);
+
+	const Vec3<T> axis = (ax <= ay && ax <= az)? Vec3<T> (1, 0, 0):
+			     (ay <= az)? Vec3<T> (0, 1, 0): Vec3<T> (0, 0, 1);
+
+	Vec3<T> perp = u[0] % axis;
+	perp /= perp.length();
+
+	u[1] = (S[1][k] > small && S[1][k] > 0)? u[1]: perp;
+
+	Vec3<T> third = u[0] % u[1];
+	u[2] = (S[2][k] > small && S[2][k] > 0)? u[2]: third;
+
+	//
+	// det(U) * det(V) < 0 means U * V^T is a reflection.
+	//
+
+	T detV = V.x[0][0][k] * (V.x[1][1][k] * V.x[2][2][k] - V.x[1][2][k] * V.x[2][1][k]) -
+		 V.x[0][1][k] * (V.x[1][0][k] * V.x[2][2][k] - V.x[1][2][k] * V.x[2][0][k]) +
+		 V.x[0][2][k] * (V.x[1][0][k] * V.x[2][1][k] - V.x[1][1][k] * V.x[2][0][k]);
+
+	T detU = u[0] ^ (u[1] % u[2]);
+
+	const bool flip = forcePositiveDeterminant && detU * detV < 0;
+	const T sign = flip? T (-1): T (1);
+
+	S[2][k] *= sign;
+	u[2] *= sign;
+
+	for (int i = 0; i < 3; ++i)
+	    for (int j = 0; j < 3; ++j)
+		U.x[i][j][k] = u[j][i];
+    }
+}
+
+
+template <class T>
+void
+jacobiEigenSolverArray (const Matrix33<T> *A,
+			Vec3<T> *S,
+			Matrix33<T> *V,
+			size_t n,
+			T tol = limits<T>::epsilon())
+{
+    const int N = Matrix33Block<T>::width;
+
+    Matrix33Block<T> ab, vb;
+    T s[3][N];
+
+    for (size_t i = 0; i < n; i += N)
+    {
+	const int count = (n - i < size_t (N))? int (n - i): N;
+
+	ab.load (A + i, count);
+	jacobiEigenSolver (ab, s, vb, tol);
+	vb.store (V + i, count);
+
+	for (int k = 0; k < count; ++k)
+	    S[i + k].setValue (s[0][k], s[1][k], s[2][k]);
+    }
+}
+
+
+template <class T>
+void
+jacobiSVDArray (const Matrix33<T> *A,
+		Matrix33<T> *U,
+		Vec3<T> *S,
+		Matrix33<T> *V,
+		size_t n,
+		T tol = limits<T>::epsilon(),
+		bool forcePositiveDeterminant = false)
+{
+    const int N = Matrix33Block<T>::width;
+
+    Matrix33Block<T> ab, ub, vb;
+    T s[3][N];
+
+    for (size_t i = 0; i < n; i += N)
+    {
+	const int count = (n - i < size_t (N))? int (n - i): N;
+
+	ab.load (A + i, count);
+	jacobiSVD (ab, ub, s, vb, tol, forcePositiveDeterminant);
+	ub.store (U + i, count);
+	vb.store (V + i, count);
+
+	for (int k = 0; k < count; ++k)
+	    S[i + k].setValue (s[0][k], s[1][k], s[2][k]);
+    }
+}
+
+
+template <class T>
+void
+procrustesRotationAndTranslationArray (const Vec3<T> *A,
+				       const Vec3<T> *B,
+				       const T *weights,
+				       const size_t *indices,
+				       const size_t *clusterStart,
+				       size_t numClusters,
+				       M44d *result,
+				       bool doScaling = false)
+{
+    //
+    // procrustesRotationAndTranslation() for many clusters of points
+    // at once.  Cluster c is made of entries clusterStart[c] up to
+    // clusterStart[c+1] (exclusive) of indices, which holds positions
+    // in A, B and weights; if indices is null, the entries are the
+    // positions themselves.  weights may be null for equal weights.
+    //
+    // The centroids and covariance matrices are accumulated in double
+    // precision, as in the single-cluster function, and the SVDs are
+    // solved in blocks.  Clusters with no points or no weight get the
+    // identity.
+    //
+
+    const int N = Matrix33Block<double>::width;
+
+    Matrix33Block<double> cb, ub, vb;
+    double s[3][N];
+    V3d aCenter[N], bCenter[N];
+    double scaleDenom[N];
+    bool empty[N];
+
+    for (size_t c0 = 0; c0 < numClusters; c0 += N)
+    {
+	const int count = (numClusters - c0 < size_t (N))?
+			  int (numClusters - c0): N;
+
+	for (int k = 0; k < N; ++k)
+	{
+	    for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+		    cb.x[i][j][k] = 0;
+
+	    aCenter[k] = bCenter[k] = V3d (0);
+	    scaleDenom[k] = 0;
+	    empty[k] = true;
+	}
+
+	for (int k = 0; k < count; ++k)
+	{
+	    const size_t begin = clusterStart[c0 + k];
+	    const size_t end = clusterStart[c0 + k + 1];
+
+	    double weightsSum = 0;
+	    V3d ac (0), bc (0);
+
+	    for (size_t e = begin; e < end; ++e)
+	    {
+		const size_t p = indices? indices[e]: e;
+		const double w = weights? double (weights[p]): 1.0;
+
+		ac += V3d (A[p]) * w;
+		bc += V3d (B[p]) * w;
+		weightsSum += w;
+	    }
+
+	    if (weightsSum == 0)
+		continue;
+
+	    ac /= weightsSum;
+	    bc /= weightsSum;
+
+	    M33d C (0.0);
+	    double norm2 = 0;
+
+	    for (size_t e = begin; e < end; ++e)
+	    {
+		const size_t p = indices? indices[e]: e;
+		const double w = weights? double (weights[p]): 1.0;
+		const V3d a = V3d (A[p]) - ac;
+		const V3d b = V3d (B[p]) - bc;
+
+		C += outerProduct (b, a) * w;
+		norm2 += w * a.length2();
+	    }
+
+	    for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+		    cb.x[i][j][k] = C[i][j];
+
+	    aCenter[k] = ac;
+	    bCenter[k] = bc;
+	    scaleDenom[k] = norm2;
+	    empty[k] = false;
+	}
+
+	jacobiSVD (cb, ub, s, vb, limits<double>::epsilon(), true);
+
+	for (int k = 0; k < count; ++k)
+	{
+	    M44d &m = result[c0 + k];
+
+	    if (empty[k])
+	    {
+		m.makeIdentity();
+		continue;
+	    }
+
+	    //
+	    // Qt = V * U^T is the rotation for row vectors, v' = v * Qt.
+	    //
+
+	    M33d Qt;
+
+	    for (int i = 0; i < 3; ++i)
+	    {
+		for (int j = 0; j < 3; ++j)
+		{
+		    Qt[i][j] = vb.x[i][0][k] * ub.x[j][0][k] +
+			       vb.x[i][1][k] * ub.x[j][1][k] +
+			       vb.x[i][2][k] * ub.x[j][2][k];
+		}
+	    }
+
+	    double sc = 1.0;
+
+	    if (doScaling && scaleDenom[k] != 0)
+		sc = (s[0][k] + s[1][k] + s[2][k]) / scaleDenom[k];
+
+	    const V3d translate = bCenter[k] - sc * aCenter[k] * Qt;
+
+	    m = M44d (sc * Qt[0][0], sc * Qt[0][1], sc * Qt[0][2], 0,
+		      sc * Qt[1][0], sc * Qt[1][1], sc * Qt[1][2], 0,
+		      sc * Qt[2][0], sc * Qt[2][1], sc * Qt[2][2], 0,
+		      translate.x, translate.y, translate.z, 1);
+	}
+    }
+}
+
+
+template <class T>
+void
+procrustesRotationAndTranslationArray (const Vec3<T> *A,
+				       const Vec3<T> *B,
+				       const size_t *indices,
+				       const size_t *clusterStart,
+				       size_t numClusters,
+				       M44d *result,
+				       bool doScaling = false)
+{
+    // Unweighted:
+    procrustesRotationAndTranslationArray (A, B, (const T *) 0, indices,
+					   clusterStart, numClusters,
+					   result, doScaling);
+}
+
+
+IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMATHMATRIXARRAY_H
@@ -0,0 +1,576 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef INCLUDED_IMATHQUATARRAY_H
+#define INCLUDED_IMATHQUATARRAY_H
+
+//---------------------------------------------------------------------------
+//
+//	Batched quaternion operations over structure-of-arrays storage:
+//	interpolation (slerp, nlerp, squad and the intermediate()
+//	tangents for spline()), renormalization, and conversion to and
+//	from matrices and Euler angles.
+//
+//	QuatSoA<T> points at four separate arrays holding the r, x, y and
+//	z components of n quaternions; it does not own them.  Input and
+//	output arrays may be the same.
+//
+//	Each element is computed with straight-line code, with the
+//	special cases of the single-quaternion functions (zero length,
+//	small angles) written as selects, so that the loops can be
+//	vectorized.  slerp, squad, intermediate, normalize and the matrix
+//	conversions give the same results as the Quat<T> functions;
+//	the Euler conversions agree with Euler<T> to rounding.
+//
+//	Contains:
+//
+//	struct QuatSoA<T>
+//
+//	void toSoA (const Quat<T> *src, const QuatSoA<T> &dst, size_t n)
+//	void fromSoA (const QuatSoA<T> &src, Quat<T> *dst, size_t n)
+//
+//	void normalizeArray (const QuatSoA<T> &q, size_t n)
+//
+//	void slerpArray (q1, q2, const T *t, out, n)
+//	void slerpShortestArcArray (q1, q2, const T *t, out, n)
+//	void nlerpArray (q1, q2, const T *t, out, n)
+//	void squadArray (q1, qa, qb, q2, const T *t, out, n)
+//	void intermediateArray (q0, q1, q2, out, n)
+//
+//	void toMatrix44Array (const QuatSoA<T> &q, Matrix44<T> *m, size_t n)
+//	void extractQuatArray (const Matrix44<T> *m, const QuatSoA<T> &q,
+//			       size_t n)
+//
+//	void eulerToQuatArray (const Vec3<T> *angles,
+//			       typename Euler<T>::Order order,
+//			       const QuatSoA<T> &q, size_t n)
+//	void quatToEulerArray (const QuatSoA<T> &q,
+//			       typename Euler<T>::Order order,
+//			       Vec3<T> *angles, size_t n)
+//
+//	Euler angles are in the order's own layout, as stored in an
+//	Euler<T> (Euler<T>::IJKLayout).
+//
+//---------------------------------------------------------------------------
+
+#include "ImathQuat.h"
+#include "ImathEuler.h"
+#include "ImathMatrix.h"
+#include "ImathLimits.h"
+#include "ImathMath.h"
+#include "ImathVec.h"
+#include "ImathNamespace.h"
+
+#include <stddef.h>
+
+IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+template <class T>
+struct QuatSoA
+{
+    T *		r;
+    T *		x;
+    T *		y;
+    T *		z;
+
+    QuatSoA (): r (0), x (0), y (0), z (0) {}
+    QuatSoA (T *rr, T *xx, T *yy, T *zz): r (rr), x (xx), y (yy), z (zz) {}
+
+    Quat<T>	get (size_t i) const
+		    {return Quat<T> (r[i], x[i], y[i], z[i]);}
+
+    void	set (size_t i, const Quat<T> &q) const
+		    {r[i] = q.r; x[i] = q.v.x; y[i] = q.v.y; z[i] = q.v.z;}
+};
+
+
+//------------------------------------------------------------------
+// Per-element versions of the branching Quat<T> functions, with the
+// branches replaced by selects.
+//------------------------------------------------------------------
+
+template <class T>
+inline T
+sinxOverXLane (T x)
+{
+    T s = Math<T>::sin (x) / x;
+    return (x * x < limits<T>::epsilon()) ? T (1) : s;
+}
+
+
+template <class T>
+inline Quat<T>
+normalizedLane (const Quat<T> &q)
+{
+    //
+    // Quat<T>::normalized()
+    //
+
+    T l = Math<T>::sqrt (q.r * q.r + (q.v ^ q.v));
+    T d = (l != 0) ? l : T (1);
+
+    return Quat<T> ((l != 0) ? q.r / d : T (1),
+		    (l != 0) ? q.v.x / d : T (0),
+		    (l != 0) ? q.v.y / d : T (0),
+		    (l != 0) ? q.v.z / d : T (0));
+}
+
+
+template <class T>
+inline Quat<T>
+slerpLane (const Quat<T> &q1, const Quat<T> &q2, T t)
+{
+    //
+    // slerp(): no flipping to the shortest arc.
+    //
+
+    Quat<T> d = q1 - q2;
+    T lengthD = Math<T>::sqrt (d ^ d);
+
+    Quat<T> sum = q1 + q2;
+    T lengthS = Math<T>::sqrt (sum ^ sum);
+
+    T a = 2 * Math<T>::atan2 (lengthD, lengthS);
+    T s = 1 - t;
+
+    Quat<T> q = sinxOverXLane (s * a) / sinxOverXLane (a) * s * q1 +
+		sinxOverXLane (t * a) / sinxOverXLane (a) * t * q2;
+
+    return normalizedLane (q);
+}
+
+
+template <class T>
+inline Quat<T>
+logLane (const Quat<T> &q)
+{
+    //
+    // Quat<T>::log(), for unit quaternions
+    //
+
+    T theta = Math<T>::acos (q.r < T (1) ? q.r : T (1));
+    T sintheta = Math<T>::sin (theta);
+
+    T k = (abs (sintheta) < 1 &&
+	   abs (theta) >= limits<T>::max() * abs (sintheta)) ?
+	  T (1) : theta / sintheta;
+
+    k = (theta == 0) ? T (1) : k;
+
+    return Quat<T> ((T) 0, q.v.x * k, q.v.y * k, q.v.z * k);
+}
+
+
+template <class T>
+inline Quat<T>
+expLane (const Quat<T> &q)
+{
+    //
+    // Quat<T>::exp(), for pure quaternions
+    //
+
+    T theta = q.v.length();
+    T sintheta = Math<T>::sin (theta);
+
+    T k = (abs (theta) < 1 &&
+	   abs (sintheta) >= limits<T>::max() * abs (theta)) ?
+	  T (1) : sintheta / theta;
+
+    T costheta = Math<T>::cos (theta);
+
+    return Quat<T> (costheta, q.v.x * k, q.v.y * k, q.v.z * k);
+}
+
+
+//---------------
+// Implementation
+//---------------
+
+template <class T>
+void
+toSoA (const Quat<T> *src, const QuatSoA<T> &dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	dst.set (i, src[i]);
+}
+
+
+template <class T>
+void
+fromSoA (const QuatSoA<T> &src, Quat<T> *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	dst[i] = src.get (i);
+}
+
+
+template <class T>
+void
+normalizeArray (const QuatSoA<T> &q, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	q.set (i, normalizedLane (q.get (i)));
+}
+
+
+template <class T>
+void
+slerpArray (const QuatSoA<T> &q1,
+	    const QuatSoA<T> &q2,
+	    const T *t,
+	    const QuatSoA<T> &out,
+	    size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	out.set (i, slerpLane (q1.get (i), q2.get (i), t[i]));
+}
+
+
+template <class T>
+void
+slerpShortestArcArray (const QuatSoA<T> &q1,
+		       const QuatSoA<T> &q2,
+		       const T *t,
+		       const QuatSoA<T> &out,
+		       size_t n)
+{
+    //
+    // slerpShortestArc(): q2 is negated when it is more than 90
+    // degrees away from q1 in 4D.
+    //
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Quat<T> a = q1.get (i);
+	Quat<T> b = q2.get (i);
+	T sign = ((a ^ b) >= 0) ? T (1) : T (-1);
+
+	out.set (i, slerpLane (a, sign * b, t[i]));
+    }
+}
+
+
+template <class T>
+void
+nlerpArray (const QuatSoA<T> &q1,
+	    const QuatSoA<T> &q2,
+	    const T *t,
+	    const QuatSoA<T> &out,
+	    size_t n)
+{
+    //
+    // Normalized linear interpolation along the shorter arc: cheaper
+    // than slerp, with the same path but non-uniform speed.  Good
+    // enough for small steps, such as between motion blur samples.
+    //
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Quat<T> a = q1.get (i);
+	Quat<T> b = q2.get (i);
+	T sign = ((a ^ b) >= 0) ? T (1) : T (-1);
+
+	out.set (i, normalizedLane ((1 - t[i]) * a + (sign * t[i]) * b));
+    }
+}
+
+
+template <class T>
+void
+squadArray (const QuatSoA<T> &q1,
+	    const QuatSoA<T> &qa,
+	    const QuatSoA<T> &qb,
+	    const QuatSoA<T> &q2,
+	    const T *t,
+	    const QuatSoA<T> &out,
+	    size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+	T ti = t[i];
+	Quat<T> r1 = slerpLane (q1.get (i), q2.get (i), ti);
+	Quat<T> r2 = slerpLane (qa.get (i), qb.get (i), ti);
+
+	out.set (i, slerpLane (r1, r2, 2 * ti * (1 - ti)));
+    }
+}
+
+
+template <class T>
+void
+intermediateArray (const QuatSoA<T> &q0,
+		   const QuatSoA<T> &q1,
+		   const QuatSoA<T> &q2,
+		   const QuatSoA<T> &out,
+		   size_t n)
+{
+    //
+    // intermediate(): the inner quadrangle points that squadArray()
+    // needs to reproduce spline().
+    //
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Quat<T> b = q1.get (i);
+	Quat<T> q1inv = b.inverse();
+	Quat<T> c1 = q1inv * q2.get (i);
+	Quat<T> c2 = q1inv * q0.get (i);
+	Quat<T> c3 = (T) (-0.25) * (logLane (c2) + logLane (c1));
+
+	out.set (i, normalizedLane (b * expLane (c3)));
+    }
+}
+
+
+template <class T>
+void
+toMatrix44Array (const QuatSoA<T> &q, Matrix44<T> *m, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	m[i] = q.get (i).toMatrix44();
+}
+
+
+template <class T>
+void
+extractQuatArray (const Matrix44<T> *m, const QuatSoA<T> &q, size_t n)
+{
+    //
+    // extractQuat() from ImathMatrixAlgo.h.  The positive trace case
+    // and the three largest-diagonal cases are all computed and the
+    // one extractQuat() would take is selected.
+    //
+
+    for (size_t e = 0; e < n; ++e)
+    {
+	const Matrix44<T> &mat = m[e];
+
+	T tr = mat[0][0] + mat[1][1] + mat[2][2];
+
+	//
+	// Trace > 0
+	//
+
+	T s = Math<T>::sqrt (tr + T(1.0));
+	T s2 = T(0.5) / s;
+
+	Quat<T> qt (s / T(2.0),
+		    (mat[1][2] - mat[2][1]) * s2,
+		    (mat[2][0] - mat[0][2]) * s2,
+		    (mat[0][1] - mat[1][0]) * s2);
+
+	//
+	// Largest diagonal element at i, with j and k following it.
+	//
+
+	Quat<T> qd[3];
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    int j = (i + 1) % 3;
+	    int k = (j + 1) % 3;
+
+	    T sd = Math<T>::sqrt ((mat[i][i] - (mat[j][j] + mat[k][k])) + T(1.0));
+	    T c[4];
+
+	    c[i] = sd * T(0.5);
+	    sd = (sd != T(0.0)) ? T(0.5) / sd : sd;
+
+	    c[3] = (mat[j][k] - mat[k][j]) * sd;
+	    c[j] = (mat[i][j] + mat[j][i]) * sd;
+	    c[k] = (mat[i][k] + mat[k][i]) * sd;
+
+	    qd[i] = Quat<T> (c[3], c[0], c[1], c[2]);
+	}
+
+	int i = (mat[1][1] > mat[0][0]) ? 1 : 0;
+	i = (mat[2][2] > mat[i][i]) ? 2 : i;
+
+	q.set (e, (tr > 0.0) ? qt : qd[i]);
+    }
+}
+
+
+template <class T>
+void
+eulerToQuatArray (const Vec3<T> *angles,
+		  typename Euler<T>::Order order,
+		  const QuatSoA<T> &q,
+		  size_t n)
+{
+    //
+    // Euler<T>::toQuat().  The order is decoded once; the loop is the
+    // trigonometry.
+    //
+
+    const Euler<T> e (order);
+    int i, j, k;
+    e.angleOrder (i, j, k);
+
+    const bool frameStatic = e.frameStatic();
+    const bool repeated = e.initialRepeated();
+    const T parity = e.parityEven() ? 1.0 : -1.0;
+
+    for (size_t a = 0; a < n; ++a)
+    {
+	Vec3<T> an = frameStatic ? angles[a] :
+		     Vec3<T> (angles[a].z, angles[a].y, angles[a].x);
+
+	an.y *= parity;
+
+	T ti = an.x*0.5;
+	T tj = an.y*0.5;
+	T th = an.z*0.5;
+	T ci = Math<T>::cos(ti);
+	T cj = Math<T>::cos(tj);
+	T ch = Math<T>::cos(th);
+	T si = Math<T>::sin(ti);
+	T sj = Math<T>::sin(tj);
+	T sh = Math<T>::sin(th);
+	T cc = ci*ch;
+	T cs = ci*sh;
+	T sc = si*ch;
+	T ss = si*sh;
+
+	Vec3<T> v;
+	T r;
+
+	if (repeated)
+	{
+	    v[i] = cj*(cs + sc);
+	    v[j] = sj*(cc + ss) * parity;
+	    v[k] = sj*(cs - sc);
+	    r    = cj*(cc - ss);
+	}
+	else
+	{
+	    v[i] = cj*sc - sj*cs;
+	    v[j] = (cj*ss + sj*cc) * parity;
+	    v[k] = cj*cs - sj*sc;
+	    r    = cj*cc + sj*ss;
+	}
+
+	q.set (a, Quat<T> (r, v));
+    }
+}
+
+
+template <class T>
+void
+quatToEulerArray (const QuatSoA<T> &q,
+		  typename Euler<T>::Order order,
+		  Vec3<T> *angles,
+		  size_t n)
+{
+    //
+    // Euler<T>::extract (const Quat<T> &).  Rather than building the
+    // rotation N that removes the first angle as a matrix, only the
+    // rows of N that are needed are formed: row i of N is row i of M,
+    // and rows j and k are rotated combinations of rows j and k of M.
+    //
+
+    const Euler<T> e (order);
+    int i, j, k;
+    e.angleOrder (i, j, k);
+
+    const bool frameStatic = e.frameStatic();
+    const bool repeated = e.initialRepeated();
+    const bool parityEven = e.parityEven();
+
+    //
+    // With p and q following i cyclically, a rotation by angle
+    // about axis i maps row p to  cos * p + sin * q, and row q to
+    // -sin * p + cos * q.  j is p for even parity and q for odd.
+    //
+
+    const int p = (i + 1) % 3;
+    const int pq = (i + 2) % 3;
+
+    for (size_t a = 0; a < n; ++a)
+    {
+	Matrix33<T> M = q.get (a).toMatrix33();
+	T x, y, z;
+
+	if (repeated)
+	    x = Math<T>::atan2 (M[j][i], M[k][i]);
+	else
+	    x = Math<T>::atan2 (M[j][k], M[k][k]);
+
+	T angle = parityEven ? -x : x;
+	T c = Math<T>::cos (angle);
+	T s = Math<T>::sin (angle);
+
+	Vec3<T> Np (c * M[p][0] + s * M[pq][0],
+		    c * M[p][1] + s * M[pq][1],
+		    c * M[p][2] + s * M[pq][2]);
+
+	Vec3<T> Nq (-s * M[p][0] + c * M[pq][0],
+		    -s * M[p][1] + c * M[pq][1],
+		    -s * M[p][2] + c * M[pq][2]);
+
+	const Vec3<T> &Nj = parityEven ? Np : Nq;
+	const Vec3<T> &Nk = parityEven ? Nq : Np;
+
+	if (repeated)
+	{
+	    T sy = Math<T>::sqrt (Nj[i]*Nj[i] + Nk[i]*Nk[i]);
+	    y = Math<T>::atan2 (sy, M[i][i]);
+	    z = Math<T>::atan2 (Nj[k], Nj[j]);
+	}
+	else
+	{
+	    T cy = Math<T>::sqrt (M[i][i]*M[i][i] + M[i][j]*M[i][j]);
+	    y = Math<T>::atan2 (-M[i][k], cy);
+	    z = Math<T>::atan2 (-Nj[i], Nj[j]);
+	}
+
+	if (!parityEven)
+	{
+	    x = -x;
+	    y = -y;
+	    z = -z;
+	}
+
+	angles[a] = frameStatic ? Vec3<T> (x, y, z) : Vec3<T> (z, y, x);
+    }
+}
+
+
+IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMATHQUATARRAY_H
@@ -44,10 +44,16 @@
 //
 //		class Rand32
 //		class Rand48
+//		class RandPhilox
 //		solidSphereRand()
 //		hollowSphereRand()
 //		gaussRand()
 //		gaussSphereRand()
+//		uniformRandFill()
+//		solidSphereRandFill()
+//		hollowSphereRandFill()
+//		gaussRandFill()
+//		gaussSphereRandFill()
 //
 //	Note: class Rand48() calls erand48() and nrand48(), which are not
 //	available on all operating systems.  For compatibility we include
@@ -58,6 +64,8 @@
 
 #include "ImathNamespace.h"
 #include "ImathExport.h"
+#include "ImathInt64.h"
+#include "ImathPlatform.h"
 
 #include <stdlib.h>
 #include <math.h>
@@ -182,6 +190,88 @@ class Rand48
 };
 
 
+//-----------------------------------------------------------------
+// Counter-based random-number generator (Philox4x32-10, Salmon et
+// al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011).
+//
+// Instead of stepping a state, each 128-bit block of output is a
+// function of the seed and the block's index, so any part of the
+// stream can be produced directly.  Filling an array in chunks on
+// several threads gives exactly the same values as filling it in
+// one call, whatever the number of threads or chunk sizes.
+//
+// The stream is a sequence of 32-bit words; word i is element
+// (i % 4) of block (i / 4).  The fill functions below take the
+// index of their first element, and the distribution functions use
+// one block per output element.
+//
+// RandPhilox can also be used like Rand32, stepping through the
+// stream with nexti() and nextf(), e.g. with solidSphereRand().
+//-----------------------------------------------------------------
+
+class RandPhilox
+{
+  public:
+
+    //------------
+    // Constructor
+    //------------
+
+    RandPhilox (Int64 seed = 0);
+
+
+    //------------------------------------------------------------
+    // Re-initialize with a given seed, and rewind to word 0
+    //------------------------------------------------------------
+
+    void		init (Int64 seed);
+
+
+    //----------------------------------------------------------
+    // Move the sequential position to word index of the stream
+    //----------------------------------------------------------
+
+    void		seek (Int64 index);
+
+
+    //-----------------------------------------------------------
+    // Get the next word in the sequence (range: [false, true]),
+    // (range: [0 ... 0xffffffff]), (range: [0 ... 1[) and
+    // (range [rangeMin ... rangeMax[)
+    //-----------------------------------------------------------
+
+    bool		nextb ();
+    unsigned int	nexti ();
+    float		nextf ();
+    float		nextf (float rangeMin, float rangeMax);
+
+
+    //---------------------------------------------
+    // Block number index of the stream, 4 words
+    //---------------------------------------------
+
+    void		block (Int64 index, unsigned int out[4]) const;
+
+
+    //------------------------------------------------------------
+    // Fill out[0] ... out[n-1] starting at element first of the
+    // stream: 32-bit words, floats in [0 ... 1[ (24 bits each, one
+    // word per element) or doubles in [0 ... 1[ (53 bits each, two
+    // words per element).
+    //------------------------------------------------------------
+
+    void		fill (Int64 first, unsigned int *out, size_t n) const;
+    void		fill (Int64 first, float *out, size_t n) const;
+    void		fill (Int64 first, double *out, size_t n) const;
+
+  private:
+
+    unsigned int	_key[2];
+    Int64		_index;
+    unsigned int	_buffer[4];
+};
+
+
 //------------------------------------------------------------
 // Return random points uniformly distributed in a sphere with
 // radius 1 around the origin (distance from origin <= 1).
@@ -223,6 +313,40 @@ Vec
 gaussSphereRand (Rand &rand);
 
 
+//------------------------------------------------------------------
+// Bulk versions of the above for RandPhilox.  Element i of out is
+// computed from block first + i of the stream alone, with closed
+// form transforms instead of rejection sampling, so the result does
+// not depend on how an array is split up.
+//
+// uniformRandFill() fills vectors of up to 4 dimensions with
+// components in [0 ... 1[, with 24 bits each.  solidSphereRandFill() and
+// hollowSphereRandFill() accept 2D and 3D vectors; for 2D vectors
+// they produce points in the unit disk and on the unit circle.
+// Uniform numbers for the transforms have 32 bits of precision.
+//------------------------------------------------------------------
+
+template <class Vec>
+void
+uniformRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n);
+
+template <class Vec>
+void
+solidSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n);
+
+template <class Vec>
+void
+hollowSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n);
+
+template <class T>
+void
+gaussRandFill (const RandPhilox &rand, Int64 first, T *out, size_t n);
+
+template <class Vec>
+void
+gaussSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n);
+
+
 //---------------------------------
 // erand48(), nrand48() and friends
 //---------------------------------
@@ -332,6 +456,191 @@ Rand48::nextf (double rangeMin, double rangeMax)
 }
 
 
+inline
+RandPhilox::RandPhilox (Int64 seed)
+{
+    init (seed);
+}
+
+
+inline void
+RandPhilox::init (Int64 seed)
+{
+    _key[0] = (unsigned int) (seed & 0xffffffff);
+    _key[1] = (unsigned int) ((seed >> 32) & 0xffffffff);
+    seek (0);
+}
+
+
+inline void
+RandPhilox::seek (Int64 index)
+{
+    _index = index;
+    block (_index >> 2, _buffer);
+}
+
+
+inline void
+RandPhilox::block (Int64 index, unsigned int out[4]) const
+{
+    //
+    // Ten rounds of Philox4x32, with the block index as the low two
+    // words of the counter.
+    //
+
+    unsigned int c0 = (unsigned int) (index & 0xffffffff);
+    unsigned int c1 = (unsigned int) ((index >> 32) & 0xffffffff);
+    unsigned int c2 = 0;
+    unsigned int c3 = 0;
+    unsigned int k0 = _key[0];
+    unsigned int k1 = _key[1];
+
+    for (int r = 0; r < 10; ++r)
+    {
+	Int64 p0 = Int64 (0xD2511F53) * c0;
+	Int64 p1 = Int64 (0xCD9E8D57) * c2;
+
+	unsigned int hi0 = (unsigned int) (p0 >> 32);
+	unsigned int lo0 = (unsigned int) (p0 & 0xffffffff);
+	unsigned int hi1 = (unsigned int) (p1 >> 32);
+	unsigned int lo1 = (unsigned int) (p1 & 0xffffffff);
+
+	c0 = hi1 ^ c1 ^ k0;
+	c1 = lo1;
+	c2 = hi0 ^ c3 ^ k1;
+	c3 = lo0;
+
+	k0 = (k0 + 0x9E3779B9) & 0xffffffff;
+	k1 = (k1 + 0xBB67AE85) & 0xffffffff;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+
+inline unsigned int
+RandPhilox::nexti ()
+{
+    unsigned int w = _buffer[_index & 3];
+
+    if ((++_index & 3) == 0)
+	block (_index >> 2, _buffer);
+
+    return w;
+}
+
+
+inline bool
+RandPhilox::nextb ()
+{
+    // Return the most significant bit.
+    return !!(nexti() & 2147483648UL);
+}
+
+
+inline float
+RandPhilox::nextf ()
+{
+    return float (nexti() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+inline float
+RandPhilox::nextf (float rangeMin, float rangeMax)
+{
+    float f = nextf();
+    return rangeMin * (1 - f) + rangeMax * f;
+}
+
+
+inline void
+RandPhilox::fill (Int64 first, unsigned int *out, size_t n) const
+{
+    unsigned int b[4];
+
+    //
+    // Leading words up to a block boundary
+    //
+
+    while (n > 0 && (first & 3) != 0)
+    {
+	block (first >> 2, b);
+	*out++ = b[first & 3];
+	++first;
+	--n;
+    }
+
+    //
+    // Whole blocks, written straight to out
+    //
+
+    Int64 index = first >> 2;
+
+    for (; n >= 4; n -= 4, out += 4, ++index)
+	block (index, out);
+
+    //
+    // Trailing words
+    //
+
+    if (n > 0)
+    {
+	block (index, b);
+
+	for (size_t i = 0; i < n; ++i)
+	    out[i] = b[i];
+    }
+}
+
+
+inline void
+RandPhilox::fill (Int64 first, float *out, size_t n) const
+{
+    const size_t chunk = 256;
+    unsigned int w[chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	fill (first, w, m);
+
+	for (size_t i = 0; i < m; ++i)
+	    out[i] = float (w[i] >> 8) * (1.0f / 16777216.0f);
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
+inline void
+RandPhilox::fill (Int64 first, double *out, size_t n) const
+{
+    const size_t chunk = 128;
+    unsigned int w[2 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	fill (2 * first, w, 2 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	{
+	    out[i] = (double (w[2 * i] >> 5) * 67108864.0 +
+		      double (w[2 * i + 1] >> 6)) * (1.0 / 9007199254740992.0);
+	}
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
 template <class Vec, class Rand>
 Vec
 solidSphereRand (Rand &rand)
@@ -396,6 +705,187 @@ gaussSphereRand (Rand &rand)
     return hollowSphereRand <Vec> (rand) * gaussRand (rand);
 }
 
+
+template <class Vec>
+void
+uniformRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n)
+{
+    typedef typename Vec::BaseType T;
+
+    const size_t chunk = 64;
+    unsigned int w[4 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	rand.fill (4 * first, w, 4 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	    for (unsigned int j = 0; j < Vec::dimensions(); ++j)
+		out[i][j] = T (double (w[4 * i + j] >> 8) * (1.0 / 16777216.0));
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
+template <class Vec>
+inline void
+hollowSphereFromBlock (const unsigned int *w, Vec &out)
+{
+    //
+    // 3D: z uniform in [-1, 1] and a uniform angle around z give a
+    // uniform distribution on the sphere.  2D: a uniform angle.
+    // Uses the first two words of the block.
+    //
+
+    typedef typename Vec::BaseType T;
+
+    double u = double (w[0]) * (1.0 / 4294967296.0);
+    double v = double (w[1]) * (1.0 / 4294967296.0);
+
+    if (Vec::dimensions() == 2)
+    {
+	double phi = 2 * M_PI * u;
+	out[0] = T (cos (phi));
+	out[1] = T (sin (phi));
+    }
+    else
+    {
+	double z = 1 - 2 * u;
+	double r = sqrt (1 - z * z);
+	double phi = 2 * M_PI * v;
+	out[0] = T (r * cos (phi));
+	out[1] = T (r * sin (phi));
+	out[2] = T (z);
+    }
+}
+
+
+template <class Vec>
+void
+hollowSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n)
+{
+    const size_t chunk = 64;
+    unsigned int w[4 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	rand.fill (4 * first, w, 4 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	    hollowSphereFromBlock (w + 4 * i, out[i]);
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
+template <class Vec>
+void
+solidSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n)
+{
+    //
+    // A point on the sphere (or circle), scaled by a radius whose
+    // distribution is proportional to r^2 (or r), taken from the
+    // third word of the same block.
+    //
+
+    typedef typename Vec::BaseType T;
+
+    const size_t chunk = 64;
+    unsigned int w[4 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	rand.fill (4 * first, w, 4 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	{
+	    hollowSphereFromBlock (w + 4 * i, out[i]);
+
+	    double u = double (w[4 * i + 2]) * (1.0 / 4294967296.0);
+	    double r = (Vec::dimensions() == 2)? sqrt (u): pow (u, 1.0 / 3.0);
+	    out[i] *= T (r);
+	}
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
+template <class T>
+void
+gaussRandFill (const RandPhilox &rand, Int64 first, T *out, size_t n)
+{
+    //
+    // Box-Muller transform of the first two words of each block.
+    //
+
+    const size_t chunk = 64;
+    unsigned int w[4 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	rand.fill (4 * first, w, 4 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	{
+	    double u = (double (w[4 * i]) + 1) * (1.0 / 4294967296.0);
+	    double v = double (w[4 * i + 1]) * (1.0 / 4294967296.0);
+	    out[i] = T (sqrt (-2 * log (u)) * cos (2 * M_PI * v));
+	}
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
+
+template <class Vec>
+void
+gaussSphereRandFill (const RandPhilox &rand, Int64 first, Vec *out, size_t n)
+{
+    //
+    // The direction comes from the first two words of each block, as
+    // in hollowSphereRandFill(); the Gaussian length from the other two.
+    //
+
+    typedef typename Vec::BaseType T;
+
+    const size_t chunk = 64;
+    unsigned int w[4 * chunk];
+
+    while (n > 0)
+    {
+	size_t m = (n < chunk)? n: chunk;
+	rand.fill (4 * first, w, 4 * m);
+
+	for (size_t i = 0; i < m; ++i)
+	{
+	    hollowSphereFromBlock (w + 4 * i, out[i]);
+
+	    double u = (double (w[4 * i + 2]) + 1) * (1.0 / 4294967296.0);
+	    double v = double (w[4 * i + 3]) * (1.0 / 4294967296.0);
+	    out[i] *= T (sqrt (-2 * log (u)) * cos (2 * M_PI * v));
+	}
+
+	first += m;
+	out += m;
+	n -= m;
+    }
+}
+
 IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
 
 #endif // INCLUDED_IMATHRANDOM_H
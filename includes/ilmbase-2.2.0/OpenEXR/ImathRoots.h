@@ -46,6 +46,7 @@
 #include "ImathMath.h"
 #include "ImathNamespace.h"
 #include <complex>
+#include <stddef.h>
 
 IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
 
@@ -88,6 +89,47 @@ template <class T> int	solveNormalizedCubic (T r, T s, T t, T x[3]);
 template <class T> int	solveCubic (T a, T b, T c, T d, T x[3]);
 
 
+//--------------------------------------------------------------------------
+// Solve n equations at once, with coefficients and results in separate
+// arrays (structure of arrays):
+//
+//   solveQuadraticArray (a, b, c, num, x0, x1, n)
+//   solveNormalizedCubicArray (r, s, t, num, x0, x1, x2, n)
+//   solveCubicArray (a, b, c, d, num, x0, x1, x2, n)
+//
+// For equation i, num[i] is set to the value the single-equation
+// function returns, and the solutions are stored in x0[i], x1[i] and
+// x2[i].  Outputs beyond the number of solutions are set to 0.
+//
+// Every case is evaluated for every equation and the results selected
+// afterwards, so the loops have no data-dependent branches and the
+// compiler can vectorize them.  This means intermediate results of the
+// cases not taken may be nan or infinity; do not enable floating-point
+// exceptions around these calls.
+//
+// The quadratic results are the same as solveQuadratic().  Cubics are
+// solved without complex numbers: with real cube roots when there is
+// one real solution, and with the trigonometric form when there are
+// three.  Solutions agree with solveNormalizedCubic() to rounding (a
+// single and a double solution may be returned in the other order),
+// except that the one-solution case is also correct when
+// -q/2 + sqrt(D) is negative or zero, where the principal complex cube
+// root used by solveNormalizedCubic() does not give a real solution.
+//--------------------------------------------------------------------------
+
+template <class T>
+void	solveQuadraticArray (const T *a, const T *b, const T *c,
+			     int *num, T *x0, T *x1, size_t n);
+
+template <class T>
+void	solveNormalizedCubicArray (const T *r, const T *s, const T *t,
+				   int *num, T *x0, T *x1, T *x2, size_t n);
+
+template <class T>
+void	solveCubicArray (const T *a, const T *b, const T *c, const T *d,
+			 int *num, T *x0, T *x1, T *x2, size_t n);
+
+
 //---------------
 // Implementation
 //---------------
@@ -214,6 +256,155 @@ solveCubic (T a, T b, T c, T d, T x[3])
     }
 }
 
+
+template <class T>
+inline void
+solveQuadraticLane (T a, T b, T c, int &num, T &x0, T &x1)
+{
+    //
+    // solveQuadratic() for one equation, as selects.
+    //
+
+    T D = b * b - 4 * a * c;
+    T s = Math<T>::sqrt (D > 0 ? D : T (0));
+    T q = -(b + (b > 0 ? 1 : -1) * s) / T(2);
+
+    T linear = -c / b;
+    T double0 = -b / (2 * a);
+    T two0 = q / a;
+    T two1 = c / q;
+
+    int nLinear = (b != 0) ? 1 : (c != 0 ? 0 : -1);
+    int nQuadratic = (D > 0) ? 2 : (D == 0 ? 1 : 0);
+
+    num = (a == 0) ? nLinear : nQuadratic;
+
+    x0 = (num < 1) ? T (0) :
+	 (a == 0) ? linear :
+	 (D > 0) ? two0 : double0;
+
+    x1 = (num == 2) ? two1 : T (0);
+}
+
+
+template <class T>
+inline void
+solveNormalizedCubicLane (T r, T s, T t, int &num, T &x0, T &x1, T &x2)
+{
+    //
+    // x*x*x + r*x*x + s*x + t == 0, reduced to y*y*y + p*y + q == 0
+    // with x = y - r/3, as in solveNormalizedCubic().
+    //
+
+    T p  = (3 * s - r * r) / 3;
+    T q  = 2 * r * r * r / 27 - r * s / 3 + t;
+    T p3 = p / 3;
+    T q2 = q / 2;
+    T D  = p3 * p3 * p3 + q2 * q2;
+    T shift = -r / 3;
+
+    //
+    // D > 0: one real solution u + v, with u the real cube root of
+    // -q/2 -/+ sqrt(D) (the sign chosen to avoid cancellation) and
+    // u * v == -p/3.
+    //
+
+    T sD = Math<T>::sqrt (D > 0 ? D : T (0));
+    T w = -(q2 + (q2 >= 0 ? sD : -sD));
+    T u = (w < 0 ? -1 : 1) * Math<T>::pow (w < 0 ? -w : w, T (1) / T (3));
+    T one0 = u + (u != 0 ? -p3 / u : T (0)) + shift;
+
+    //
+    // D < 0: three real solutions 2 m cos (theta/3 + 2 pi k/3), with
+    // m = sqrt(-p/3) and cos (theta) = -q/2 / m^3.
+    //
+
+    const T twoPiBy3 = T (2.09439510239319549230842892218633); // 2 pi / 3
+    T m = Math<T>::sqrt (p3 < 0 ? -p3 : T (0));
+    T m3 = m * m * m;
+    T cosTheta = (m3 > 0) ? -q2 / m3 : T (0);
+    cosTheta = cosTheta > 1 ? T (1) : (cosTheta < -1 ? T (-1) : cosTheta);
+    T theta = Math<T>::acos (cosTheta) / 3;
+
+    T three0 = 2 * m * Math<T>::cos (theta) + shift;
+    T three1 = 2 * m * Math<T>::cos (theta + twoPiBy3) + shift;
+    T three2 = 2 * m * Math<T>::cos (theta - twoPiBy3) + shift;
+
+    //
+    // D == 0: a single and a double solution 2c and -c, with c the
+    // cube root of -q/2, or a triple solution if p is 0 as well.
+    //
+
+    T cq = (q2 > 0 ? -1 : 1) * Math<T>::pow (q2 < 0 ? -q2 : q2, T (1) / T (3));
+    bool triple = (D == 0 && p3 == 0);
+
+    num = triple ? 1 : (D > 0 ? 1 : (D == 0 ? 2 : 3));
+
+    x0 = triple ? shift :
+	 (D > 0) ? one0 :
+	 (D == 0) ? 2 * cq + shift : three0;
+
+    x1 = triple ? shift :
+	 (D > 0) ? T (0) :
+	 (D == 0) ? -cq + shift : three1;
+
+    x2 = triple ? shift :
+	 (D < 0) ? three2 : T (0);
+}
+
+
+template <class T>
+void
+solveQuadraticArray (const T *a, const T *b, const T *c,
+		     int *num, T *x0, T *x1, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+	solveQuadraticLane (a[i], b[i], c[i], num[i], x0[i], x1[i]);
+}
+
+
+template <class T>
+void
+solveNormalizedCubicArray (const T *r, const T *s, const T *t,
+			   int *num, T *x0, T *x1, T *x2, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+	solveNormalizedCubicLane (r[i], s[i], t[i],
+				  num[i], x0[i], x1[i], x2[i]);
+    }
+}
+
+
+template <class T>
+void
+solveCubicArray (const T *a, const T *b, const T *c, const T *d,
+		 int *num, T *x0, T *x1, T *x2, size_t n)
+{
+    //
+    // As in solveCubic(), equations with a == 0 are solved as
+    // quadratics; both forms are computed and one is selected.
+    //
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	T ai = a[i];
+	T safeA = (ai != 0) ? ai : T (1);
+
+	int nq, nc;
+	T q0, q1, c0, c1, c2;
+
+	solveQuadraticLane (b[i], c[i], d[i], nq, q0, q1);
+	solveNormalizedCubicLane (b[i] / safeA, c[i] / safeA, d[i] / safeA,
+				  nc, c0, c1, c2);
+
+	num[i] = (ai == 0) ? nq : nc;
+	x0[i] = (ai == 0) ? q0 : c0;
+	x1[i] = (ai == 0) ? q1 : c1;
+	x2[i] = (ai == 0) ? T (0) : c2;
+    }
+}
+
 IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
 
 #endif // INCLUDED_IMATHROOTS_H
@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef INCLUDED_IMATHTRANSFORMARRAY_H
+#define INCLUDED_IMATHTRANSFORMARRAY_H
+
+//---------------------------------------------------------------------------
+//
+//	Array versions of Matrix44<T>::multVecMatrix() and multDirMatrix(),
+//	and of the box transforms in ImathBoxAlgo.h, for transforming many
+//	points, directions or bounds by the same matrix.
+//
+//	The matrix is inspected once per call rather than once per element,
+//	and affine matrices (last column 0 0 0 1) take a path without the
+//	homogeneous divide.  The loops are kept free of branches and calls
+//	so that the compiler can vectorize them.  Results are the same as
+//	calling the per-element functions.
+//
+//	Each function works on a contiguous range and elements are
+//	independent, so large arrays can be split into chunks and the chunks
+//	transformed in parallel; IlmThreadTransformArray.h does that on an
+//	IlmThread::ThreadPool.  src and dst may be the same array.
+//
+//	Contains:
+//
+//	bool isAffine (const Matrix44<T> &m)
+//
+//	void multVecMatrixArray (const Matrix44<T> &m,
+//				 const Vec3<S> *src, Vec3<S> *dst, size_t n)
+//
+//	void multDirMatrixArray (const Matrix44<T> &m,
+//				 const Vec3<S> *src, Vec3<S> *dst, size_t n)
+//
+//	void multVecMatrixArray (const Matrix44<T> &m,
+//				 const S *srcX, const S *srcY, const S *srcZ,
+//				 S *dstX, S *dstY, S *dstZ, size_t n)
+//
+//	void multDirMatrixArray (const Matrix44<T> &m,
+//				 const S *srcX, const S *srcY, const S *srcZ,
+//				 S *dstX, S *dstY, S *dstZ, size_t n)
+//
+//	void transformArray (const Matrix44<T> &m,
+//			     const Box<Vec3<S>> *src, Box<Vec3<S>> *dst,
+//			     size_t n)
+//
+//	void affineTransformArray (const Matrix44<T> &m,
+//				   const Box<Vec3<S>> *src, Box<Vec3<S>> *dst,
+//				   size_t n)
+//
+//---------------------------------------------------------------------------
+
+#include "ImathBoxAlgo.h"
+#include "ImathMatrix.h"
+#include "ImathVec.h"
+#include "ImathNamespace.h"
+
+#include <cstddef>
+
+IMATH_INTERNAL_NAMESPACE_HEADER_ENTER
+
+
+template <class T>
+inline bool
+isAffine (const Matrix44<T> &m)
+{
+    return m[0][3] == 0 && m[1][3] == 0 && m[2][3] == 0 && m[3][3] == 1;
+}
+
+
+template <class S, class T>
+void
+multVecMatrixArray (const Matrix44<T> &m,
+		    const S *srcX, const S *srcY, const S *srcZ,
+		    S *dstX, S *dstY, S *dstZ,
+		    size_t n)
+{
+    //
+    // Structure-of-arrays version of multVecMatrix().  The matrix
+    // elements are loaded once into locals so the loop body is
+    // straight-line arithmetic.
+    //
+
+    const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
+    const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
+    const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
+    const T m30 = m[3][0], m31 = m[3][1], m32 = m[3][2], m33 = m[3][3];
+
+    if (isAffine (m))
+    {
+	for (size_t i = 0; i < n; ++i)
+	{
+	    const S x = srcX[i], y = srcY[i], z = srcZ[i];
+
+	    dstX[i] = S (x * m00 + y * m10 + z * m20 + m30);
+	    dstY[i] = S (x * m01 + y * m11 + z * m21 + m31);
+	    dstZ[i] = S (x * m02 + y * m12 + z * m22 + m32);
+	}
+    }
+    else
+    {
+	for (size_t i = 0; i < n; ++i)
+	{
+	    const S x = srcX[i], y = srcY[i], z = srcZ[i];
+
+	    const S a = S (x * m00 + y * m10 + z * m20 + m30);
+	    const S b = S (x * m01 + y * m11 + z * m21 + m31);
+	    const S c = S (x * m02 + y * m12 + z * m22 + m32);
+	    const S w = S (x * m03 + y * m13 + z * m23 + m33);
+
+	    dstX[i] = a / w;
+	    dstY[i] = b / w;
+	    dstZ[i] = c / w;
+	}
+    }
+}
+
+
+template <class S, class T>
+void
+multDirMatrixArray (const Matrix44<T> &m,
+		    const S *srcX, const S *srcY, const S *srcZ,
+		    S *dstX, S *dstY, S *dstZ,
+		    size_t n)
+{
+    const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	const S x = srcX[i], y = srcY[i], z = srcZ[i];
+
+	dstX[i] = S (x * m00 + y * m10 + z * m20);
+	dstY[i] = S (x * m01 + y * m11 + z * m21);
+	dstZ[i] = S (x * m02 + y * m12 + z * m22);
+    }
+}
+
+
+template <class S, class T>
+void
+multVecMatrixArray (const Matrix44<T> &m,
+		    const Vec3<S> *src,
+		    Vec3<S> *dst,
+		    size_t n)
+{
+    //
+    // Array-of-structures version.  Vec3<S> is three packed S values,
+    // so this is the SoA loop with a stride of three.
+    //
+
+    const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
+    const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
+    const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
+    const T m30 = m[3][0], m31 = m[3][1], m32 = m[3][2], m33 = m[3][3];
+
+    if (isAffine (m))
+    {
+	for (size_t i = 0; i < n; ++i)
+	{
+	    const S x = src[i].x, y = src[i].y, z = src[i].z;
+
+	    dst[i].x = S (x * m00 + y * m10 + z * m20 + m30);
+	    dst[i].y = S (x * m01 + y * m11 + z * m21 + m31);
+	    dst[i].z = S (x * m02 + y * m12 + z * m22 + m32);
+	}
+    }
+    else
+    {
+	for (size_t i = 0; i < n; ++i)
+	{
+	    const S x = src[i].x, y = src[i].y, z = src[i].z;
+
+	    const S a = S (x * m00 + y * m10 + z * m20 + m30);
+	    const S b = S (x * m01 + y * m11 + z * m21 + m31);
+	    const S c = S (x * m02 + y * m12 + z * m22 + m32);
+	    const S w = S (x * m03 + y * m13 + z * m23 + m33);
+
+	    dst[i].x = a / w;
+	    dst[i].y = b / w;
+	    dst[i].z = c / w;
+	}
+    }
+}
+
+
+template <class S, class T>
+void
+multDirMatrixArray (const Matrix44<T> &m,
+		    const Vec3<S> *src,
+		    Vec3<S> *dst,
+		    size_t n)
+{
+    const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+    const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+    const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	const S x = src[i].x, y = src[i].y, z = src[i].z;
+
+	dst[i].x = S (x * m00 + y * m10 + z * m20);
+	dst[i].y = S (x * m01 + y * m11 + z * m21);
+	dst[i].z = S (x * m02 + y * m12 + z * m22);
+    }
+}
+
+
+template <class S, class T>
+void
+affineTransformArray (const Matrix44<T> &m,
+		      const Box< Vec3<S> > *src,
+		      Box< Vec3<S> > *dst,
+		      size_t n)
+{
+    //
+    // Array version of affineTransform(), using the same Graphics Gems
+    // method: each output extent is the translation plus, per input
+    // axis, the smaller (or larger) of the scaled min and max.  The
+    // comparisons are written as selects rather than branches.
+    //
+    // Empty and infinite boxes are passed through unchanged, as in
+    // affineTransform().
+    //
+
+    S mm[4][3];
+
+    for (int j = 0; j < 4; ++j)
+	for (int i = 0; i < 3; ++i)
+	    mm[j][i] = (S) m[j][i];
+
+    for (size_t k = 0; k < n; ++k)
+    {
+	const Box< Vec3<S> > &box = src[k];
+
+	if (box.isEmpty() || box.isInfinite())
+	{
+	    dst[k] = box;
+	    continue;
+	}
+
+	Vec3<S> newMin, newMax;
+
+	for (int i = 0; i < 3; ++i)
+	{
+	    S lo = mm[3][i];
+	    S hi = mm[3][i];
+
+	    for (int j = 0; j < 3; ++j)
+	    {
+		const S a = mm[j][i] * box.min[j];
+		const S b = mm[j][i] * box.max[j];
+
+		lo += (a < b)? a: b;
+		hi += (a < b)? b: a;
+	    }
+
+	    newMin[i] = lo;
+	    newMax[i] = hi;
+	}
+
+	dst[k].min = newMin;
+	dst[k].max = newMax;
+    }
+}
+
+
+template <class S, class T>
+void
+transformArray (const Matrix44<T> &m,
+		const Box< Vec3<S> > *src,
+		Box< Vec3<S> > *dst,
+		size_t n)
+{
+    //
+    // Array version of transform().  Affine matrices go through
+    // affineTransformArray(); projective ones go through transform(),
+    // which transforms the eight corners of each box.  (The overload
+    // of transform() with a result argument isn't used because it
+    // extends, rather than replaces, the result box.)
+    //
+
+    if (isAffine (m))
+    {
+	affineTransformArray (m, src, dst, n);
+	return;
+    }
+
+    for (size_t k = 0; k < n; ++k)
+	dst[k] = transform (src[k], m);
+}
+
+
+IMATH_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMATHTRANSFORMARRAY_H
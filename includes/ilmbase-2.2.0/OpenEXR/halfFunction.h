@@ -59,7 +59,17 @@
 //
 //	The tabulated function can then be evaluated quickly for arbitrary
 //	half values by calling the the halfFunction object's operator()
-//	method.
+//	method, or for whole arrays of half values by calling apply().
+//
+//	Tabulating an expensive function takes a while.  To spread that
+//	work over several threads, construct the halfFunction with
+//	halfFunction<T>::DEFERRED in place of the function; this fills in
+//	everything except the values of the function itself.  Then call
+//	evaluate() with the function for subranges of the 65536 bit
+//	patterns; calls for disjoint ranges can run concurrently.  The
+//	table is complete when [0, 65536) has been covered.
+//	IlmThreadHalfFunction.h has functions that do this, and split
+//	apply() into chunks, on an IlmThread::ThreadPool.
 //
 //	Example:
 //
@@ -78,6 +88,13 @@
 //	    half x = hsin (1);
 //	    half y = hsqrt (3.5);
 //
+//	    hsin.apply (pixels, result, numPixels);
+//
+//	    halfFunction<half> hexp (halfFunction<half>::DEFERRED);
+//
+//	    for (int i = 0; i < 16; ++i)		// one range per task
+//		hexp.evaluate (exp, i << 12, (i + 1) << 12);
+//
 //---------------------------------------------------------------------------
 
 #ifndef _HALF_FUNCTION_H_
@@ -92,6 +109,7 @@
 #endif
 
 #include <float.h>
+#include <stddef.h>
 
 
 template <class T>
@@ -112,6 +130,16 @@ class halfFunction
 		  T negInfValue  = 0,
 		  T nanValue     = 0);
 
+    enum Deferred {DEFERRED};
+
+    halfFunction (Deferred,
+		  half domainMin = -HALF_MAX,
+		  half domainMax =  HALF_MAX,
+		  T defaultValue = 0,
+		  T posInfValue  = 0,
+		  T negInfValue  = 0,
+		  T nanValue     = 0);
+
 #ifndef ILMBASE_HAVE_LARGE_STACK
     ~halfFunction () { delete [] _lut; }    
 #endif
@@ -122,8 +150,32 @@ class halfFunction
 
     T		operator () (half x) const;
 
+    //-------------------------------------------------------------
+    // Bulk evaluation: y[i] = (*this) (x[i]) for i in [0, n).
+    // x and y may be the same array if T is half.
+    //-------------------------------------------------------------
+
+    void	apply (const half x[], T y[], size_t n) const;
+
+    //-------------------------------------------------------------
+    // Deferred construction: evaluate f for the finite values in
+    // the domain whose bit patterns are in [first, last).  The
+    // range is clamped to [0, 65536).
+    //-------------------------------------------------------------
+
+    template <class Function>
+    void	evaluate (Function f, int first = 0, int last = 1 << 16);
+
   private:
 
+    void	init (T defaultValue,
+		      T posInfValue,
+		      T negInfValue,
+		      T nanValue);
+
+    half	_domainMin;
+    half	_domainMax;
+
 #ifdef ILMBASE_HAVE_LARGE_STACK
     T		_lut[1 << 16];
 #else
@@ -144,7 +196,36 @@ halfFunction<T>::halfFunction (Function f,
 			       T defaultValue,
 			       T posInfValue,
 			       T negInfValue,
-			       T nanValue)
+			       T nanValue):
+    _domainMin (domainMin),
+    _domainMax (domainMax)
+{
+    init (defaultValue, posInfValue, negInfValue, nanValue);
+    evaluate (f);
+}
+
+
+template <class T>
+halfFunction<T>::halfFunction (Deferred,
+			       half domainMin,
+			       half domainMax,
+			       T defaultValue,
+			       T posInfValue,
+			       T negInfValue,
+			       T nanValue):
+    _domainMin (domainMin),
+    _domainMax (domainMax)
+{
+    init (defaultValue, posInfValue, negInfValue, nanValue);
+}
+
+
+template <class T>
+void
+halfFunction<T>::init (T defaultValue,
+		       T posInfValue,
+		       T negInfValue,
+		       T nanValue)
 {
 #ifndef ILMBASE_HAVE_LARGE_STACK
     _lut = new T[1<<16];
@@ -160,9 +241,29 @@ halfFunction<T>::halfFunction (Function f,
 	    _lut[i] = nanValue;
 	else if (x.isInfinity())
 	    _lut[i] = x.isNegative()? negInfValue: posInfValue;
-	else if (x < domainMin || x > domainMax)
-	    _lut[i] = defaultValue;
 	else
+	    _lut[i] = defaultValue;
+    }
+}
+
+
+template <class T>
+template <class Function>
+void
+halfFunction<T>::evaluate (Function f, int first, int last)
+{
+    if (first < 0)
+	first = 0;
+
+    if (last > (1 << 16))
+	last = 1 << 16;
+
+    for (int i = first; i < last; i++)
+    {
+	half x;
+	x.setBits (i);
+
+	if (x.isFinite() && !(x < _domainMin || x > _domainMax))
 	    _lut[i] = f (x);
     }
 }
@@ -176,4 +277,23 @@ halfFunction<T>::operator () (half x) const
 }
 
 
+template <class T>
+void
+halfFunction<T>::apply (const half x[], T y[], size_t n) const
+{
+    //
+    // The table pointer is copied so that stores to y cannot appear
+    // to change it, leaving a tight loop of independent lookups.  x
+    // and y are read and written in order, so the hardware prefetches
+    // them; for most functions the lookups hit a small part of the
+    // table that stays in cache.
+    //
+
+    const T *lut = _lut;
+
+    for (size_t i = 0; i < n; i++)
+	y[i] = lut[x[i].bits()];
+}
+
+
 #endif
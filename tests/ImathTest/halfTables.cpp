@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+//-----------------------------------------------------------------------------
+//
+//	Writes toFloat.h and eLut.h, the tables of half.cpp, into the
+//	directory given on the command line; libraryFunctions.cpp
+//	includes them.  This is what IlmBase's toFloat.cpp and eLut.cpp
+//	do when the Half library is built.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+//
+// The float with the same value as half h, as an unsigned int.
+//
+
+unsigned int
+halfToFloat (unsigned short h)
+{
+    unsigned int s = (h >> 15) & 0x00000001;
+    int e = (h >> 10) & 0x0000001f;
+    unsigned int m = h & 0x000003ff;
+
+    if (e == 0)
+    {
+	if (m == 0)
+	{
+	    //
+	    // Plus or minus zero
+	    //
+
+	    return s << 31;
+	}
+	else
+	{
+	    //
+	    // Denormalized number -- renormalize it
+	    //
+
+	    while (!(m & 0x00000400))
+	    {
+		m <<= 1;
+		e -= 1;
+	    }
+
+	    e += 1;
+	    m &= ~0x00000400;
+	}
+    }
+    else if (e == 31)
+    {
+	//
+	// Positive or negative infinity, or NAN
+	//
+
+	return (s << 31) | 0x7f800000 | (m << 13);
+    }
+
+    //
+    // Normalized number
+    //
+
+    e = e + (127 - 15);
+    m = m << 13;
+
+    return (s << 31) | (e << 23) | m;
+}
+
+
+bool
+writeToFloat (const string &path)
+{
+    FILE *f = fopen (path.c_str(), "w");
+
+    if (!f)
+	return false;
+
+    fprintf (f, "//\n// This is an automatically generated file.\n"
+		"// Do not edit.\n//\n\n{\n");
+
+    const int iMax = (1 << 16);
+
+    for (int i = 0; i < iMax; i++)
+    {
+	if ((i % 4) == 0)
+	    fprintf (f, "    ");
+
+	fprintf (f, "{0x%08x}, ", halfToFloat ((unsigned short) i));
+
+	if ((i % 4) == 3)
+	    fprintf (f, "\n");
+    }
+
+    fprintf (f, "};\n");
+    return fclose (f) == 0;
+}
+
+
+bool
+writeELut (const string &path)
+{
+    FILE *f = fopen (path.c_str(), "w");
+
+    if (!f)
+	return false;
+
+    fprintf (f, "//\n// This is an automatically generated file.\n"
+		"// Do not edit.\n//\n\n{\n");
+
+    const int tableSize = 1 << 9;
+
+    for (int i = 0; i < tableSize; i++)
+    {
+	if ((i % 8) == 0)
+	    fprintf (f, "    ");
+
+	//
+	// The biased exponent of half for a float with sign and
+	// exponent bits i, or 0 where convert() has to handle it.
+	//
+
+	int e = (i & 0x0ff) - (127 - 15);
+
+	if (e <= 0 || e >= 30)
+	    fprintf (f, "%5d, ", 0);
+	else if (i & 0x100)
+	    fprintf (f, "%5d, ", (e << 10) | 0x8000);
+	else
+	    fprintf (f, "%5d, ", e << 10);
+
+	if ((i % 8) == 7)
+	    fprintf (f, "\n");
+    }
+
+    fprintf (f, "};\n");
+    return fclose (f) == 0;
+}
+
+} // namespace
+
+
+int
+main (int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+	fprintf (stderr, "usage: %s outputDirectory\n", argv[0]);
+	return 1;
+    }
+
+    string dir = argv[1];
+
+    if (!writeToFloat (dir + "/toFloat.h") || !writeELut (dir + "/eLut.h"))
+    {
+	fprintf (stderr, "%s: cannot write the tables in %s\n",
+		 argv[0], dir.c_str());
+	return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,303 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+//-----------------------------------------------------------------------------
+//
+//	The functions and tables of the compiled Half and Imath libraries
+//	that the tests use, for platforms other than the one libs/ was
+//	built for.  They are copies of the IlmBase 2.2 sources (half.cpp
+//	and ImathColorAlgo.cpp), with the tables written at build time by
+//	halfTables.cpp.
+//
+//-----------------------------------------------------------------------------
+
+#include "half.h"
+#include "ImathColorAlgo.h"
+
+
+//-------------------------------------------------------------
+// Lookup tables for half-to-float and float-to-half conversion
+//-------------------------------------------------------------
+
+HALF_EXPORT const half::uif half::_toFloat[1 << 16] =
+    #include "toFloat.h"
+HALF_EXPORT const unsigned short half::_eLut[1 << 9] =
+    #include "eLut.h"
+
+
+//-----------------------------------------------
+// Overflow handler for float-to-half conversion;
+// generates a hardware floating-point overflow,
+// which may be trapped by the operating system.
+//-----------------------------------------------
+
+HALF_EXPORT float
+half::overflow ()
+{
+    volatile float f = 1e10;
+
+    for (int i = 0; i < 10; i++)
+	f *= f;				// this will overflow before
+					// the for loop terminates
+    return f;
+}
+
+
+//-----------------------------------------------------
+// Float-to-half conversion -- general case, including
+// zeroes, denormalized numbers and exponent overflows.
+//-----------------------------------------------------
+
+HALF_EXPORT short
+half::convert (int i)
+{
+    //
+    // Disassemble i into the sign (s), the exponent (e), and the
+    // significand (m) of the corresponding half, rebiasing the
+    // exponent from 127 to 15.
+    //
+
+    int s =  (i >> 16) & 0x00008000;
+    int e = ((i >> 23) & 0x000000ff) - (127 - 15);
+    int m =   i        & 0x007fffff;
+
+    if (e <= 0)
+    {
+	if (e < -10)
+	{
+	    //
+	    // The magnitude of the float is less than HALF_MIN; it
+	    // converts to a signed zero.
+	    //
+
+	    return s;
+	}
+
+	//
+	// A denormalized half; round the significand to the nearest
+	// multiple of 2^-24, with ties going to even.
+	//
+
+	m = m | 0x00800000;
+
+	int t = 14 - e;
+	int a = (1 << (t - 1)) - 1;
+	int b = (m >> t) & 1;
+
+	m = (m + a + b) >> t;
+
+	return s | m;
+    }
+    else if (e == 0xff - (127 - 15))
+    {
+	if (m == 0)
+	{
+	    //
+	    // Infinity
+	    //
+
+	    return s | 0x7c00;
+	}
+	else
+	{
+	    //
+	    // NAN; keep the high bits of the significand, but make
+	    // sure that at least one bit is set.
+	    //
+
+	    m >>= 13;
+	    return s | 0x7c00 | m | (m == 0);
+	}
+    }
+    else
+    {
+	//
+	// A normalized half; round the significand, with ties
+	// going to even.
+	//
+
+	m = m + 0x00000fff + ((m >> 13) & 1);
+
+	if (m & 0x00800000)
+	{
+	    m =  0;		// overflow in significand,
+	    e += 1;		// adjust exponent
+	}
+
+	if (e > 30)
+	{
+	    overflow ();	// Cause a hardware floating point overflow;
+	    return s | 0x7c00;	// if this returns, the half becomes an
+	}			// infinity with the same sign as f.
+
+	return s | (e << 10) | (m >> 13);
+    }
+}
+
+
+IMATH_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+Vec3<double>
+hsv2rgb_d(const Vec3<double> &hsv)
+{
+    double hue = hsv.x;
+    double sat = hsv.y;
+    double val = hsv.z;
+
+    double x = 0.0, y = 0.0, z = 0.0;
+    
+    if (hue == 1) hue = 0;
+    else hue *= 6;
+
+    int i = int(Math<double>::floor(hue));
+    double f = hue-i;
+    double p = val*(1-sat);
+    double q = val*(1-(sat*f));
+    double t = val*(1-(sat*(1-f)));
+
+    switch (i) 
+    {
+      case 0: x = val; y = t; z = p; break;
+      case 1: x = q; y = val; z = p; break;
+      case 2: x = p; y = val; z = t; break;
+      case 3: x = p; y = q; z = val; break;
+      case 4: x = t; y = p; z = val; break;
+      case 5: x = val; y = p; z = q; break;
+    }
+
+    return Vec3<double>(x,y,z);
+}
+
+
+Color4<double>	
+hsv2rgb_d(const Color4<double> &hsv)
+{
+    double hue = hsv.r;
+    double sat = hsv.g;
+    double val = hsv.b;
+
+    double r = 0.0, g = 0.0, b = 0.0;
+    
+    if (hue == 1) hue = 0;
+    else hue *= 6;
+
+    int i = int(Math<double>::floor(hue));
+    double f = hue-i;
+    double p = val*(1-sat);
+    double q = val*(1-(sat*f));
+    double t = val*(1-(sat*(1-f)));
+
+    switch (i) 
+    {
+      case 0: r = val; g = t; b = p; break;
+      case 1: r = q; g = val; b = p; break;
+      case 2: r = p; g = val; b = t; break;
+      case 3: r = p; g = q; b = val; break;
+      case 4: r = t; g = p; b = val; break;
+      case 5: r = val; g = p; b = q; break;
+    }
+
+    return Color4<double>(r,g,b,hsv.a);
+}
+
+
+
+Vec3<double>
+rgb2hsv_d(const Vec3<double> &c)
+{
+    const double &x = c.x;
+    const double &y = c.y;
+    const double &z = c.z;
+
+    double max	 = (x > y) ? ((x > z) ? x : z) : ((y > z) ? y : z);
+    double min	 = (x < y) ? ((x < z) ? x : z) : ((y < z) ? y : z);
+    double range = max - min;
+    double val	 = max;
+    double sat	 = 0;
+    double hue	 = 0;
+    
+    if (max != 0)   sat = range/max;
+    
+    if (sat != 0) 
+    {
+	double h;
+	
+	if      (x == max)	h =     (y - z) / range;
+	else if (y == max)	h = 2 + (z - x) / range;
+	else			h = 4 + (x - y) / range;
+
+	hue = h/6.;
+	    
+	if (hue < 0.)
+	    hue += 1.0;
+    }
+    return Vec3<double>(hue,sat,val);
+}
+
+
+Color4<double>
+rgb2hsv_d(const Color4<double> &c)
+{
+    const double &r = c.r;
+    const double &g = c.g;
+    const double &b = c.b;
+
+    double max	 = (r > g) ? ((r > b) ? r : b) : ((g > b) ? g : b);
+    double min	 = (r < g) ? ((r < b) ? r : b) : ((g < b) ? g : b);
+    double range = max - min;
+    double val	 = max;
+    double sat	 = 0;
+    double hue	 = 0;
+    
+    if (max != 0)   sat = range/max;
+    
+    if (sat != 0) 
+    {
+	double h;
+	
+	if      (r == max)	h =     (g - b) / range;
+	else if (g == max)	h = 2 + (b - r) / range;
+	else			h = 4 + (r - g) / range;
+
+	hue = h/6.;
+	    
+	if (hue < 0.)
+	    hue += 1.0;
+    }
+    return Color4<double>(hue,sat,val,c.a);
+}
+
+
+IMATH_INTERNAL_NAMESPACE_SOURCE_EXIT
@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <testColorAlgoArray.h>
+#include "ImathColorAlgoArray.h"
+#include "ImathRandom.h"
+#include "half.h"
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <assert.h>
+
+
+using namespace std;
+using namespace IMATH_INTERNAL_NAMESPACE;
+
+namespace {
+
+//
+// The array functions must give the same bits as the single-color
+// functions, so results are compared with memcmp(); this also makes
+// nan results compare equal.
+//
+
+template <class C>
+bool
+same (const C &a, const C &b)
+{
+    return memcmp (&a, &b, sizeof (C)) == 0;
+}
+
+
+//
+// half has an assignment operator but no copy constructor, and copying
+// one is deprecated in C++11, so half channels are copied by their bits.
+//
+
+template <class T>
+void
+copyChannel (const T &from, T &to)
+{
+    to = from;
+}
+
+
+void
+copyChannel (const half &from, half &to)
+{
+    to.setBits (from.bits());
+}
+
+
+//
+// Compares planes against the channels of a Vec3<T>.
+//
+
+template <class T>
+bool
+same (const T &x, const T &y, const T &z, const Vec3<T> &v)
+{
+    return same (x, v.x) && same (y, v.y) && same (z, v.z);
+}
+
+
+//
+// Channel values: 0 and 1 (or the integer maximum) often, to hit the
+// hue == 1 and zero saturation cases; otherwise, for floating-point
+// types, values slightly outside [0, 1] as well unless clamp is set.
+//
+
+template <class T>
+T
+randomChannel (Rand32 &rand, bool clamp)
+{
+    unsigned int k = rand.nexti() % 10;
+
+    if (limits<T>::isIntegral())
+    {
+	if (k == 0)
+	    return T (0);
+
+	if (k == 1)
+	    return limits<T>::max();
+
+	return T (rand.nexti() % (unsigned int) (limits<T>::max() + 1));
+    }
+
+    if (k == 0)
+	return T (0);
+
+    if (k == 1)
+	return T (1);
+
+    double f = rand.nexti() / 4294967296.0;
+    return T (float (clamp ? f : f * 1.2 - 0.1));
+}
+
+
+template <class T>
+void
+testHsv (size_t n)
+{
+    Rand32 rand (1);
+    vector< Vec3<T> > a (n), b (n);
+    vector< Color4<T> > c (n), d (n);
+    vector<T> p0 (n), p1 (n), p2 (n), q0 (n), q1 (n), q2 (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	a[i] = Vec3<T> (randomChannel<T> (rand, false),
+			randomChannel<T> (rand, false),
+			randomChannel<T> (rand, false));
+
+	//
+	// Two equal channels, for the ties in rgb2hsv().
+	//
+
+	if (i % 9 == 0)
+	    copyChannel (a[i].x, a[i].y);
+
+	copyChannel (a[i].x, c[i].r);
+	copyChannel (a[i].y, c[i].g);
+	copyChannel (a[i].z, c[i].b);
+	c[i].a = randomChannel<T> (rand, false);
+
+	copyChannel (a[i].x, p0[i]);
+	copyChannel (a[i].y, p1[i]);
+	copyChannel (a[i].z, p2[i]);
+    }
+
+    hsv2rgbArray (&a[0], &b[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (b[i], hsv2rgb (a[i])));
+
+    rgb2hsvArray (&a[0], &b[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (b[i], rgb2hsv (a[i])));
+
+    hsv2rgbArray (&c[0], &d[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (d[i], hsv2rgb (c[i])));
+
+    rgb2hsvArray (&c[0], &d[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (d[i], rgb2hsv (c[i])));
+
+    hsv2rgbPlanes (&p0[0], &p1[0], &p2[0], &q0[0], &q1[0], &q2[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (q0[i], q1[i], q2[i], hsv2rgb (a[i])));
+
+    rgb2hsvPlanes (&p0[0], &p1[0], &p2[0], &q0[0], &q1[0], &q2[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (q0[i], q1[i], q2[i], rgb2hsv (a[i])));
+
+    //
+    // In place
+    //
+
+    b = a;
+    hsv2rgbArray (&b[0], &b[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (b[i], hsv2rgb (a[i])));
+
+    d = c;
+    rgb2hsvArray (&d[0], &d[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (d[i], rgb2hsv (c[i])));
+
+    q0 = p0;
+    q1 = p1;
+    q2 = p2;
+    rgb2hsvPlanes (&q0[0], &q1[0], &q2[0], &q0[0], &q1[0], &q2[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (same (q0[i], q1[i], q2[i], rgb2hsv (a[i])));
+}
+
+
+template <class T>
+void
+testPacked (size_t n)
+{
+    //
+    // rgb2packed() converts floating-point channels to unsigned
+    // integers, so they have to be in [0, 1].
+    //
+
+    Rand32 rand (2);
+    vector< Vec3<T> > a (n), b (n);
+    vector< Color4<T> > c (n), d (n);
+    vector<PackedColor> packed (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	a[i] = Vec3<T> (randomChannel<T> (rand, true),
+			randomChannel<T> (rand, true),
+			randomChannel<T> (rand, true));
+
+	copyChannel (a[i].x, c[i].r);
+	copyChannel (a[i].y, c[i].g);
+	copyChannel (a[i].z, c[i].b);
+	c[i].a = randomChannel<T> (rand, true);
+    }
+
+    rgb2packedArray (&a[0], &packed[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (packed[i] == rgb2packed (a[i]));
+
+    packed2rgbArray (&packed[0], &b[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<T> x;
+	packed2rgb (packed[i], x);
+	assert (same (b[i], x));
+    }
+
+    rgb2packedArray (&c[0], &packed[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (packed[i] == rgb2packed (c[i]));
+
+    packed2rgbArray (&packed[0], &d[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Color4<T> x;
+	packed2rgb (packed[i], x);
+	assert (same (d[i], x));
+    }
+}
+
+
+template <class T>
+void
+testColorAlgoArrayT (const char *type)
+{
+    cout << "  " << type << endl;
+
+    const size_t n = 20000;
+
+    testHsv<T> (n);
+    testPacked<T> (n);
+}
+
+} // namespace
+
+
+void
+testColorAlgoArray ()
+{
+    cout << "Testing functions in ImathColorAlgoArray.h" << endl;
+
+    testColorAlgoArrayT<float> ("float");
+    testColorAlgoArrayT<double> ("double");
+    testColorAlgoArrayT<half> ("half");
+    testColorAlgoArrayT<unsigned char> ("unsigned char");
+    testColorAlgoArrayT<unsigned short> ("unsigned short");
+
+    cout << "ok\n" << endl;
+}
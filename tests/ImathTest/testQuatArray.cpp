@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <testQuatArray.h>
+#include "ImathQuatArray.h"
+#include "ImathMatrixAlgo.h"
+#include "ImathRandom.h"
+#include "ImathFun.h"
+#include <iostream>
+#include <vector>
+#include <assert.h>
+
+
+using namespace std;
+using namespace IMATH_INTERNAL_NAMESPACE;
+
+namespace {
+
+//
+// A QuatSoA<T> together with the arrays it points at.
+//
+
+template <class T>
+struct QuatArrays
+{
+    vector<T> r, x, y, z;
+
+    QuatArrays (size_t n): r (n), x (n), y (n), z (n) {}
+
+    QuatSoA<T>	soa () {return QuatSoA<T> (&r[0], &x[0], &y[0], &z[0]);}
+};
+
+
+//
+// Rand32::nextf() is compiled into the Imath library; the tests only
+// use the inline parts of the headers.
+//
+
+double
+randomFloat (Rand32 &rand, double lo, double hi)
+{
+    return lo + (hi - lo) * (rand.nexti() / 4294967296.0);
+}
+
+
+template <class T>
+Vec3<T>
+randomAngles (Rand32 &rand)
+{
+    return Vec3<T> (randomFloat (rand, -3.3, 3.3),
+		    randomFloat (rand, -3.3, 3.3),
+		    randomFloat (rand, -3.3, 3.3));
+}
+
+
+template <class T>
+Quat<T>
+randomQuat (Rand32 &rand)
+{
+    Vec3<T> a = randomAngles<T> (rand);
+    return Euler<T> (a.x, a.y, a.z).toQuat();
+}
+
+
+template <class T>
+void
+testInterpolation (size_t n)
+{
+    cout << "  interpolation" << endl;
+
+    Rand32 rand (1);
+    vector< Quat<T> > q0 (n), q1 (n), q2 (n), q3 (n), result (n);
+    vector<T> t (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	q0[i] = randomQuat<T> (rand);
+	q1[i] = randomQuat<T> (rand);
+	q2[i] = randomQuat<T> (rand);
+	q3[i] = randomQuat<T> (rand);
+	t[i] = randomFloat (rand, 0, 1);
+    }
+
+    //
+    // Equal and opposite quaternions, for the small-angle and the
+    // shortest-arc cases.
+    //
+
+    q1[3] = q0[3];
+    q1[4] = -q0[4];
+
+    QuatArrays<T> a0 (n), a1 (n), a2 (n), a3 (n), out (n);
+    toSoA (&q0[0], a0.soa(), n);
+    toSoA (&q1[0], a1.soa(), n);
+    toSoA (&q2[0], a2.soa(), n);
+    toSoA (&q3[0], a3.soa(), n);
+
+    slerpArray (a0.soa(), a1.soa(), &t[0], out.soa(), n);
+    fromSoA (out.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == slerp (q0[i], q1[i], t[i]));
+
+    slerpShortestArcArray (a0.soa(), a1.soa(), &t[0], out.soa(), n);
+    fromSoA (out.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == slerpShortestArc (q0[i], q1[i], t[i]));
+
+    squadArray (a0.soa(), a1.soa(), a2.soa(), a3.soa(),
+		&t[0], out.soa(), n);
+    fromSoA (out.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == squad (q0[i], q1[i], q2[i], q3[i], t[i]));
+
+    intermediateArray (a0.soa(), a1.soa(), a2.soa(), out.soa(), n);
+    fromSoA (out.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == intermediate (q0[i], q1[i], q2[i]));
+
+    //
+    // nlerp has no Quat<T> counterpart; its results must be unit
+    // quaternions on the shorter arc between q0 and q1.
+    //
+
+    nlerpArray (a0.soa(), a1.soa(), &t[0], out.soa(), n);
+    fromSoA (out.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	assert (equalWithAbsError (result[i].length(), T (1),
+				   10 * limits<T>::epsilon()));
+
+	Quat<T> s = slerpShortestArc (q0[i], q1[i], t[i]);
+	assert ((result[i] ^ s) > 0);
+    }
+
+    //
+    // A zero quaternion normalizes to the identity.
+    //
+
+    q0[0] = Quat<T> (0, 0, 0, 0);
+    toSoA (&q0[0], a0.soa(), n);
+    normalizeArray (a0.soa(), n);
+    fromSoA (a0.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == q0[i].normalized());
+}
+
+
+template <class T>
+void
+testMatrices (size_t n)
+{
+    cout << "  conversion to and from matrices" << endl;
+
+    Rand32 rand (2);
+    vector< Quat<T> > q (n), result (n);
+    vector< Matrix44<T> > m (n);
+
+    for (size_t i = 0; i < n; ++i)
+	q[i] = randomQuat<T> (rand);
+
+    QuatArrays<T> a (n);
+    toSoA (&q[0], a.soa(), n);
+    toMatrix44Array (a.soa(), &m[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (m[i] == q[i].toMatrix44());
+
+    //
+    // Matrices from Euler angles as well, so that all four cases of
+    // extractQuat() come up.
+    //
+
+    for (size_t i = 0; i < n; i += 3)
+    {
+	Vec3<T> an = randomAngles<T> (rand);
+	m[i] = Euler<T> (an.x, an.y, an.z).toMatrix44();
+    }
+
+    extractQuatArray (&m[0], a.soa(), n);
+    fromSoA (a.soa(), &result[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (result[i] == extractQuat (m[i]));
+}
+
+
+template <class T>
+void
+testEuler (size_t n, T e)
+{
+    cout << "  conversion to and from Euler angles" << endl;
+
+    const typename Euler<T>::Order orders[] =
+    {
+	Euler<T>::XYZ, Euler<T>::XZY, Euler<T>::YZX, Euler<T>::YXZ,
+	Euler<T>::ZXY, Euler<T>::ZYX,
+	Euler<T>::XZX, Euler<T>::XYX, Euler<T>::YXY, Euler<T>::YZY,
+	Euler<T>::ZYZ, Euler<T>::ZXZ,
+	Euler<T>::XYZr, Euler<T>::XZYr, Euler<T>::YZXr, Euler<T>::YXZr,
+	Euler<T>::ZXYr, Euler<T>::ZYXr,
+	Euler<T>::XZXr, Euler<T>::XYXr, Euler<T>::YXYr, Euler<T>::YZYr,
+	Euler<T>::ZYZr, Euler<T>::ZXZr
+    };
+
+    Rand32 rand (3);
+    vector< Vec3<T> > angles (n), result (n);
+    vector< Quat<T> > q (n);
+    QuatArrays<T> a (n);
+
+    for (size_t o = 0; o < sizeof (orders) / sizeof (orders[0]); ++o)
+    {
+	typename Euler<T>::Order order = orders[o];
+
+	for (size_t i = 0; i < n; ++i)
+	    angles[i] = randomAngles<T> (rand);
+
+	eulerToQuatArray (&angles[0], order, a.soa(), n);
+	fromSoA (a.soa(), &q[0], n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+	    Euler<T> x (angles[i], order, Euler<T>::IJKLayout);
+	    Quat<T> s = x.toQuat();
+
+	    for (int j = 0; j < 4; ++j)
+		assert (equalWithAbsError (q[i][j], s[j], e));
+	}
+
+	quatToEulerArray (a.soa(), order, &result[0], n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+	    Euler<T> x (order);
+	    x.extract (q[i]);
+
+	    assert (equalWithAbsError (result[i].x, x.x, e) &&
+		    equalWithAbsError (result[i].y, x.y, e) &&
+		    equalWithAbsError (result[i].z, x.z, e));
+	}
+    }
+}
+
+
+template <class T>
+void
+testQuatArrayT (T e)
+{
+    const size_t n = 2000;
+
+    testInterpolation<T> (n);
+    testMatrices<T> (n);
+    testEuler<T> (n, e);
+}
+
+} // namespace
+
+
+void
+testQuatArray ()
+{
+    cout << "Testing functions in ImathQuatArray.h" << endl;
+
+    cout << " float" << endl;
+    testQuatArrayT<float> (1e-5f);
+
+    cout << " double" << endl;
+    testQuatArrayT<double> (1e-12);
+
+    cout << "ok\n" << endl;
+}
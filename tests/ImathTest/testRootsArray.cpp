@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <testRootsArray.h>
+#include "ImathRoots.h"
+#include "ImathRandom.h"
+#include "ImathFun.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <assert.h>
+
+
+using namespace std;
+using namespace IMATH_INTERNAL_NAMESPACE;
+
+namespace {
+
+//
+// Residual of x as a solution of a*x^3 + b*x^2 + c*x + d == 0,
+// relative to the size of the coefficients and of x.
+//
+
+double
+cubicResidual (double a, double b, double c, double d, double x)
+{
+    double s = fabs (a) + fabs (b) + fabs (c) + fabs (d);
+    double m = max (1.0, fabs (x));
+    return fabs (((a * x + b) * x + c) * x + d) / (s * m * m * m);
+}
+
+
+void
+randomCoefficients (int n,
+		    vector<double> &a,
+		    vector<double> &b,
+		    vector<double> &c,
+		    vector<double> &d)
+{
+    Rand32 rand (1);
+
+    a.resize (n);
+    b.resize (n);
+    c.resize (n);
+    d.resize (n);
+
+    for (int i = 0; i < n; ++i)
+    {
+	//
+	// Coefficients on a grid of 0.01, so that the degenerate
+	// cases (zero leading coefficients, zero discriminant)
+	// come up as well.
+	//
+
+	a[i] = (int (rand.nexti() % 2001) - 1000) / 100.0;
+	b[i] = (int (rand.nexti() % 2001) - 1000) / 100.0;
+	c[i] = (int (rand.nexti() % 2001) - 1000) / 100.0;
+	d[i] = (int (rand.nexti() % 2001) - 1000) / 100.0;
+
+	if (i % 50 == 0)
+	    a[i] = 0;
+
+	if (i % 77 == 0)
+	    b[i] = 0;
+    }
+
+    //
+    // 0 == 0, 1 == 0 and x*x + 2*x + 1 == 0
+    //
+
+    a[1] = 0; b[1] = 0; c[1] = 0;
+    a[2] = 0; b[2] = 0; c[2] = 1;
+    a[3] = 1; b[3] = 2; c[3] = 1;
+}
+
+
+void
+testQuadratic (const vector<double> &a,
+	       const vector<double> &b,
+	       const vector<double> &c)
+{
+    cout << "  solveQuadraticArray() against solveQuadratic()" << endl;
+
+    size_t n = a.size();
+    vector<int> num (n);
+    vector<double> x0 (n), x1 (n);
+
+    solveQuadraticArray (&a[0], &b[0], &c[0], &num[0], &x0[0], &x1[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	double x[2] = {0, 0};
+	int m = solveQuadratic (a[i], b[i], c[i], x);
+
+	assert (num[i] == m);
+	assert (m < 1 || x0[i] == x[0]);
+	assert (m < 2 || x1[i] == x[1]);
+    }
+}
+
+
+void
+testCubic (const vector<double> &a,
+	   const vector<double> &b,
+	   const vector<double> &c,
+	   const vector<double> &d)
+{
+    cout << "  solveCubicArray() against solveCubic()" << endl;
+
+    const double e = 1e-9;
+
+    size_t n = a.size();
+    vector<int> num (n);
+    vector<double> x0 (n), x1 (n), x2 (n);
+
+    solveCubicArray (&a[0], &b[0], &c[0], &d[0],
+		     &num[0], &x0[0], &x1[0], &x2[0], n);
+
+    int scalarWrong = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	double xa[3] = {x0[i], x1[i], x2[i]};
+
+	for (int k = 0; k < num[i]; ++k)
+	    assert (cubicResidual (a[i], b[i], c[i], d[i], xa[k]) < e);
+
+	double x[3];
+	int m = solveCubic (a[i], b[i], c[i], d[i], x);
+
+	assert (num[i] == m);
+
+	//
+	// Where every scalar solution is good, the batch solutions
+	// must match them.  solveNormalizedCubic() takes the principal
+	// complex cube root of -q/2 + sqrt(D), which is not real when
+	// that is negative, so in the one-solution case it can return
+	// something that is not a solution at all; count those.
+	//
+
+	bool scalarOk = true;
+
+	for (int k = 0; k < m; ++k)
+	    if (!(cubicResidual (a[i], b[i], c[i], d[i], x[k]) < e))
+		scalarOk = false;
+
+	if (!scalarOk)
+	{
+	    assert (m == 1);
+	    ++scalarWrong;
+	    continue;
+	}
+
+	//
+	// With a double solution (D == 0) solveNormalizedCubic() may
+	// return the two solutions in either order, so compare sorted.
+	//
+
+	sort (xa, xa + m);
+	sort (x, x + m);
+
+	for (int k = 0; k < m; ++k)
+	    assert (equalWithRelError (xa[k], x[k], 1e-7) ||
+		    equalWithAbsError (xa[k], x[k], 1e-7));
+    }
+
+    cout << "    solveCubic() gave a wrong solution for "
+	 << scalarWrong << " of " << n << " equations" << endl;
+}
+
+
+template <class T>
+void
+testNormalizedCubic ()
+{
+    cout << "  solveNormalizedCubicArray() where "
+	    "-q/2 + sqrt(D) is not positive" << endl;
+
+    //
+    // x*x*x + 1 == 0: -q/2 + sqrt(D) == 0, and the scalar
+    // solver divides by a zero cube root.
+    //
+
+    T r[2] = {0, 0};
+    T s[2] = {0, -3};
+    T t[2] = {1, 3};
+    int num[2];
+    T x0[2], x1[2], x2[2];
+
+    solveNormalizedCubicArray (r, s, t, num, x0, x1, x2, 2);
+
+    assert (num[0] == 1);
+    assert (x0[0] == -1);
+    assert (x1[0] == 0 && x2[0] == 0);
+
+    //
+    // x*x*x - 3*x + 3 == 0: -q/2 + sqrt(D) < 0, the one real
+    // solution is -cbrt((3 + sqrt(5)) / 2) - cbrt((3 - sqrt(5)) / 2).
+    //
+
+    T y = -(T) (cbrt ((3 + sqrt (5.0)) / 2) + cbrt ((3 - sqrt (5.0)) / 2));
+
+    assert (num[1] == 1);
+    assert (equalWithRelError (x0[1], y, T (1e-5)));
+
+    T sx[3];
+    int m = solveNormalizedCubic (r[1], s[1], t[1], sx);
+
+    cout << "    solveNormalizedCubic() gives " << m << " solution(s), "
+	 << sx[0] << " (expected " << y << ")" << endl;
+}
+
+} // namespace
+
+
+void
+testRootsArray ()
+{
+    cout << "Testing the array functions in ImathRoots.h" << endl;
+
+    vector<double> a, b, c, d;
+    randomCoefficients (100000, a, b, c, d);
+
+    testQuadratic (a, b, c);
+    testCubic (a, b, c, d);
+    testNormalizedCubic<float> ();
+    testNormalizedCubic<double> ();
+
+    cout << "ok\n" << endl;
+}
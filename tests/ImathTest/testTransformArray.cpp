@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2002-2012, Industrial Light & Magic, a division of Lucas
+// Digital Ltd. LLC
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+// *       Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// *       Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+// *       Neither the name of Industrial Light & Magic nor the names of
+// its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+///////////////////////////////////////////////////////////////////////////
+
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <testTransformArray.h>
+#include "ImathTransformArray.h"
+#include "ImathBoxAlgo.h"
+#include "ImathRandom.h"
+#include "ImathFun.h"
+#include <iostream>
+#include <vector>
+#include <assert.h>
+
+
+using namespace std;
+using namespace IMATH_INTERNAL_NAMESPACE;
+
+namespace {
+
+//
+// Rand32::nextf() is compiled into the Imath library; the tests only
+// use the inline parts of the headers.
+//
+
+double
+randomFloat (Rand32 &rand, double lo, double hi)
+{
+    return lo + (hi - lo) * (rand.nexti() / 4294967296.0);
+}
+
+
+template <class S>
+Vec3<S>
+randomVec (Rand32 &rand)
+{
+    return Vec3<S> (randomFloat (rand, -10, 10),
+		    randomFloat (rand, -10, 10),
+		    randomFloat (rand, -10, 10));
+}
+
+
+template <class T>
+Matrix44<T>
+randomAffine (Rand32 &rand)
+{
+    Matrix44<T> m;
+
+    for (int j = 0; j < 4; ++j)
+	for (int i = 0; i < 3; ++i)
+	    m[j][i] = randomFloat (rand, -2, 2);
+
+    return m;
+}
+
+
+template <class T>
+Matrix44<T>
+randomProjective (Rand32 &rand)
+{
+    //
+    // The points are within 10 units of the origin, so w stays
+    // between 0.7 and 1.3.
+    //
+
+    Matrix44<T> m = randomAffine<T> (rand);
+
+    for (int j = 0; j < 3; ++j)
+	m[j][3] = randomFloat (rand, -0.01, 0.01);
+
+    return m;
+}
+
+
+template <class S>
+bool
+equal (const Vec3<S> &a, const Vec3<S> &b, S e)
+{
+    return a.equalWithRelError (b, e);
+}
+
+
+template <class S>
+bool
+equal (const Box< Vec3<S> > &a, const Box< Vec3<S> > &b, S e)
+{
+    return equal (a.min, b.min, e) && equal (a.max, b.max, e);
+}
+
+
+template <class S, class T>
+void
+testVectors (const Matrix44<T> &m, size_t n, S e)
+{
+    Rand32 rand (1);
+    vector< Vec3<S> > src (n), dst (n);
+    vector<S> srcX (n), srcY (n), srcZ (n), dstX (n), dstY (n), dstZ (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	src[i] = randomVec<S> (rand);
+	srcX[i] = src[i].x;
+	srcY[i] = src[i].y;
+	srcZ[i] = src[i].z;
+    }
+
+    //
+    // Arrays of structures
+    //
+
+    multVecMatrixArray (m, &src[0], &dst[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<S> v;
+	m.multVecMatrix (src[i], v);
+	assert (equal (dst[i], v, e));
+    }
+
+    multDirMatrixArray (m, &src[0], &dst[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<S> v;
+	m.multDirMatrix (src[i], v);
+	assert (equal (dst[i], v, e));
+    }
+
+    //
+    // Structures of arrays
+    //
+
+    multVecMatrixArray (m, &srcX[0], &srcY[0], &srcZ[0],
+			&dstX[0], &dstY[0], &dstZ[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<S> v;
+	m.multVecMatrix (src[i], v);
+	assert (equal (Vec3<S> (dstX[i], dstY[i], dstZ[i]), v, e));
+    }
+
+    multDirMatrixArray (m, &srcX[0], &srcY[0], &srcZ[0],
+			&dstX[0], &dstY[0], &dstZ[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<S> v;
+	m.multDirMatrix (src[i], v);
+	assert (equal (Vec3<S> (dstX[i], dstY[i], dstZ[i]), v, e));
+    }
+
+    //
+    // In place
+    //
+
+    dst = src;
+    multVecMatrixArray (m, &dst[0], &dst[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	Vec3<S> v;
+	m.multVecMatrix (src[i], v);
+	assert (equal (dst[i], v, e));
+    }
+}
+
+
+template <class S, class T>
+void
+testBoxes (const Matrix44<T> &m, size_t n, S e)
+{
+    Rand32 rand (2);
+    vector< Box< Vec3<S> > > src (n), dst (n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+	src[i].extendBy (randomVec<S> (rand));
+	src[i].extendBy (randomVec<S> (rand));
+    }
+
+    //
+    // Empty, infinite and flat boxes
+    //
+
+    src[0].makeEmpty();
+    src[1].makeInfinite();
+    src[2].max.y = src[2].min.y;
+
+    transformArray (m, &src[0], &dst[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (equal (dst[i], transform (src[i], m), e));
+
+    if (isAffine (m))
+    {
+	affineTransformArray (m, &src[0], &dst[0], n);
+
+	for (size_t i = 0; i < n; ++i)
+	    assert (equal (dst[i], affineTransform (src[i], m), e));
+    }
+
+    dst = src;
+    transformArray (m, &dst[0], &dst[0], n);
+
+    for (size_t i = 0; i < n; ++i)
+	assert (equal (dst[i], transform (src[i], m), e));
+}
+
+
+template <class S, class T>
+void
+testTransformArrayT (S e)
+{
+    const size_t n = 1000;
+    Rand32 rand (3);
+
+    cout << "  affine" << endl;
+
+    Matrix44<T> affine = randomAffine<T> (rand);
+    assert (isAffine (affine));
+
+    testVectors<S> (affine, n, e);
+    testBoxes<S> (affine, n, e);
+    testVectors<S> (Matrix44<T>(), n, e);
+    testBoxes<S> (Matrix44<T>(), n, e);
+
+    cout << "  projective" << endl;
+
+    Matrix44<T> projective = randomProjective<T> (rand);
+    assert (!isAffine (projective));
+
+    testVectors<S> (projective, n, e);
+    testBoxes<S> (projective, n, e);
+}
+
+} // namespace
+
+
+void
+testTransformArray ()
+{
+    cout << "Testing functions in ImathTransformArray.h" << endl;
+
+    cout << " float vectors, float matrices" << endl;
+    testTransformArrayT<float, float> (1e-6f);
+
+    cout << " float vectors, double matrices" << endl;
+    testTransformArrayT<float, double> (1e-6f);
+
+    cout << " double vectors, double matrices" << endl;
+    testTransformArrayT<double, double> (1e-14);
+
+    cout << "ok\n" << endl;
+}